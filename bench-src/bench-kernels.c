@@ -0,0 +1,416 @@
+/**
+ * @file bench-kernels.c
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 15:40
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * @section DESCRIPTION
+ * Micro-benchmark of the image processing kernels. Each kernel is run
+ * alone on every input image (and on synthetic frames), after some
+ * warm-up runs, and the median and 95th percentile of the wall time of
+ * the repetitions are reported, together with the throughput in
+ * megapixels per second.
+ *
+ * Usage: bench-kernels [-m mask] [-w warm-up] [-r repetitions]
+ * [-p threads] [-s widthxheight]... [image.jpg]...
+ */
+#define _POSIX_C_SOURCE 200112L
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include<unistd.h>
+#include"imageio.h"
+#include"imageinfo.h"
+#include"parallel.h"
+#include"segment.h"
+
+#define MAXREPS 1000
+#define MAXFRAMES 16
+#define NAMELEN 64
+
+/*
+ * Segmentation parameters of the sample configuration file
+ */
+#define RBTRESH 0.95
+#define NEIGHBS 5
+#define VOTESFL 12
+
+/*
+ * Everything a kernel needs: the input file, the mask and the results of
+ * the previous stages
+ */
+typedef struct {
+    char           *fname;
+    char           *pngname;
+    int             width, height;
+    SkyMask        *sm;
+    SegParams      *sp;
+    unsigned int  **cut;
+    unsigned int  **seg;
+    unsigned int  **conv;
+} BenchData;
+
+/*
+ * A kernel returns the image it builds (freed out of the timing), or NULL
+ */
+typedef unsigned int **(*Kernel) (BenchData * bd);
+
+static int      warmups = 1;
+static int      reps = 7;
+
+/*
+ * Wall clock time in seconds
+ */
+static double
+now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1E-9;
+}
+
+static int
+cmpTimes(const void *a, const void *b)
+{
+    double          x = *(const double *) a, y = *(const double *) b;
+
+    return (x < y) ? -1 : (x > y);
+}
+
+/*
+ * Runs a kernel warmups + reps times and prints the statistics of the
+ * last reps runs. mpixels is the size of its input, 0 if the throughput
+ * makes no sense.
+ */
+static void
+timeKernel(const char *label, const char *name, Kernel k, BenchData * bd,
+           double mpixels)
+{
+    double          t[MAXREPS], t0, median, p95;
+    unsigned int  **out;
+    int             r;
+
+    for (r = 0; r < warmups; r++)
+        freeImage(k(bd));
+    for (r = 0; r < reps; r++) {
+        t0 = now();
+        out = k(bd);
+        t[r] = now() - t0;
+        /*
+         * the output is released out of the measured time
+         */
+        freeImage(out);
+    }
+    qsort(t, reps, sizeof(double), cmpTimes);
+    median = (reps % 2) ? t[reps / 2] : (t[reps / 2 - 1] + t[reps / 2]) / 2;
+    p95 = t[(95 * reps + 99) / 100 - 1];
+    printf("%-20s %-16s %10.2f %10.2f", label, name, median * 1000,
+           p95 * 1000);
+    if (mpixels > 0)
+        printf(" %10.1f\n", mpixels / median);
+    else
+        printf(" %10s\n", "-");
+}
+
+static unsigned int **
+benchReadJPG(BenchData * bd)
+{
+    int             w, h;
+
+    return readJPGImage(bd->fname, &w, &h);
+}
+
+static unsigned int **
+benchReadPNG(BenchData * bd)
+{
+    int             w, h;
+
+    return readPNGImage(bd->pngname, &w, &h);
+}
+
+static unsigned int **
+benchReadAndCut(BenchData * bd)
+{
+    int             w, h;
+
+    return readAndCut(bd->fname, bd->sm, &w, &h);
+}
+
+static unsigned int **
+benchFilterRB(BenchData * bd)
+{
+    return filterRB(bd->sp->rbtreshold, bd->cut, bd->sm);
+}
+
+static unsigned int **
+benchConvolution(BenchData * bd)
+{
+    return convolution(bd->sp->neighbsize, bd->sp->votes2flip, bd->seg,
+                       bd->sm);
+}
+
+static unsigned int **
+benchCCI(BenchData * bd)
+{
+    CCIResult       ccr;
+
+    cloudcoverindex(bd->conv, bd->sm, &ccr);
+    return NULL;
+}
+
+/*
+ * The fused path of the program: box decoding and single pass
+ * segmentation
+ */
+static unsigned int **
+benchSegmentRegion(BenchData * bd)
+{
+    JPGReader      *jr;
+    PlanarImage    *reg;
+    CCIResult       ccr;
+    int             w, h;
+
+    jr = openJPGReader(bd->fname, &w, &h);
+    if (jr == NULL)
+        return NULL;
+    reg = readMaskRegion(jr, w, h, bd->sm, NULL);
+    closeJPGReader(jr);
+    if (reg != NULL) {
+        segmentRegion(reg, bd->sm, bd->sp, NULL, NULL, &ccr);
+        freePlanarImage(reg);
+    }
+    return NULL;
+}
+
+static unsigned int **
+benchWritePNG(BenchData * bd)
+{
+    writePNGImage(bd->cut, bd->pngname, bd->sm->width, bd->sm->height);
+    return NULL;
+}
+
+static unsigned int **
+benchImgInfo(BenchData * bd)
+{
+    ImageInfo       imin;
+    CamAndShotInfo  casi;
+
+    if (getImgInfo(bd->fname, 0.0, "UTC-06:00", &imin, &casi) == 1)
+        freeImgInfo(&imin, &casi);
+    return NULL;
+}
+
+/*
+ * Synthetic frame of a sky with clouds: a blue gradient, soft white
+ * blobs and some noise, deterministic so the runs can be compared
+ */
+static int
+syntheticFrame(char *fname, int width, int height)
+{
+    unsigned int  **img = newImage(width, height);
+    unsigned long   seed = 12345;
+    double          cx[8], cy[8], rr[8], c, d;
+    int             i, j, k, r, g, b, res;
+
+    if (img == NULL)
+        return 0;
+    for (k = 0; k < 8; k++) {
+        seed = seed * 1103515245 + 12345;
+        cx[k] = (seed >> 16) % width;
+        seed = seed * 1103515245 + 12345;
+        cy[k] = (seed >> 16) % height;
+        seed = seed * 1103515245 + 12345;
+        rr[k] = height / 16 + (seed >> 16) % (height / 6 + 1);
+    }
+    for (i = 0; i < height; i++)
+        for (j = 0; j < width; j++) {
+            c = 0;
+            for (k = 0; k < 8; k++) {
+                d = ((j - cx[k]) * (j - cx[k]) + (i - cy[k]) * (i - cy[k]))
+                    / (rr[k] * rr[k]);
+                if (d < 1)
+                    c += 1 - d;
+            }
+            if (c > 1)
+                c = 1;
+            seed = seed * 1103515245 + 12345;
+            b = 150 + 100 * i / height;
+            r = 40 + (int) (c * (b - 40)) + (int) ((seed >> 16) % 16);
+            g = (r + b) / 2;
+            img[i][j] = 0XFF000000 | ((r > 255 ? 255 : r) << 16) |
+                (g << 8) | b;
+        }
+    res = writeJPGImage(img, fname, width, height);
+    freeImage(img);
+    return res == 1;
+}
+
+/*
+ * Runs all the kernels on an image
+ */
+static void
+benchImage(char *fname, const char *label, SkyMask * sm, SegParams * sp,
+           int withinfo)
+{
+    BenchData       bd;
+    JPGReader      *jr;
+    char            pngname[NAMELEN];
+    double          impix, mskpix;
+    int             w, h;
+
+    jr = openJPGReader(fname, &w, &h);
+    if (jr == NULL) {
+        fprintf(stderr, "%s: unreadable image\n", fname);
+        return;
+    }
+    closeJPGReader(jr);
+    sprintf(pngname, "bench-%d.png", (int) getpid());
+    bd.fname = fname;
+    bd.pngname = pngname;
+    bd.width = w;
+    bd.height = h;
+    bd.sm = sm;
+    bd.sp = sp;
+    bd.cut = readAndCut(fname, sm, &w, &h);
+    if (bd.cut == NULL) {
+        fprintf(stderr, "%s: smaller than the mask\n", fname);
+        return;
+    }
+    bd.seg = filterRB(sp->rbtreshold, bd.cut, sm);
+    bd.conv = convolution(sp->neighbsize, sp->votes2flip, bd.seg, sm);
+    writePNGImage(bd.cut, pngname, sm->width, sm->height);
+
+    impix = bd.width * (double) bd.height / 1E6;
+    mskpix = sm->width * (double) sm->height / 1E6;
+    timeKernel(label, "readJPGImage", benchReadJPG, &bd, impix);
+    timeKernel(label, "readPNGImage", benchReadPNG, &bd, mskpix);
+    timeKernel(label, "readAndCut", benchReadAndCut, &bd, impix);
+    timeKernel(label, "filterRB", benchFilterRB, &bd, mskpix);
+    timeKernel(label, "convolution", benchConvolution, &bd, mskpix);
+    timeKernel(label, "cloudcoverindex", benchCCI, &bd, mskpix);
+    timeKernel(label, "segmentRegion", benchSegmentRegion, &bd, impix);
+    timeKernel(label, "writePNGImage", benchWritePNG, &bd, mskpix);
+    if (withinfo)
+        timeKernel(label, "getImgInfo", benchImgInfo, &bd, 0);
+
+    remove(pngname);
+    freeImage(bd.cut);
+    freeImage(bd.seg);
+    freeImage(bd.conv);
+}
+
+static void
+usage()
+{
+    fprintf(stderr, "Usage: bench-kernels [-m mask] [-w warm-up] ");
+    fprintf(stderr, "[-r repetitions] [-p threads] [-s widthxheight]... ");
+    fprintf(stderr, "[image.jpg]...\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    SkyMask         sm;
+    SegParams       sp;
+    char           *mask = "../etc/msk-sqr-png-transp.png";
+    char            label[NAMELEN];
+    char            fname[NAMELEN];
+    int             sw[MAXFRAMES], sh[MAXFRAMES];
+    int             nframes = 0, threads = 1;
+    int             opt, k;
+    char           *base;
+
+    while ((opt = getopt(argc, argv, "m:w:r:p:s:")) != -1) {
+        switch (opt) {
+        case 'm':
+            mask = optarg;
+            break;
+        case 'w':
+            warmups = atoi(optarg);
+            break;
+        case 'r':
+            reps = atoi(optarg);
+            break;
+        case 'p':
+            threads = atoi(optarg);
+            if (threads == 0)
+                threads = numProcessors();
+            break;
+        case 's':
+            if ((nframes == MAXFRAMES) ||
+                (sscanf(optarg, "%dx%d", sw + nframes, sh + nframes) != 2) ||
+                (sw[nframes] < 1) || (sh[nframes] < 1)) {
+                usage();
+                return 1;
+            }
+            nframes++;
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+    if ((warmups < 0) || (reps < 1) || (reps > MAXREPS) || (threads < 1) ||
+        (threads > MAXTHREADS)) {
+        usage();
+        return 1;
+    }
+    if (!loadSkyMask(mask, threads, &sm)) {
+        fprintf(stderr, "%s: unreadable mask\n", mask);
+        return 1;
+    }
+    sp.rbtreshold = RBTRESH;
+    sp.neighbsize = NEIGHBS;
+    sp.votes2flip = VOTESFL;
+    compileClassifier(&sp);
+
+    printf("# mask %dx%d, %d thread(s), %d warm-up run(s), ", sm.width,
+           sm.height, threads, warmups);
+    printf("%d repetition(s)\n", reps);
+    printf("%-20s %-16s %10s %10s %10s\n", "# image", "kernel", "median ms",
+           "p95 ms", "MPixel/s");
+    for (k = optind; k < argc; k++) {
+        base = strrchr(argv[k], '/');
+        base = (base != NULL) ? base + 1 : argv[k];
+        sprintf(label, "%.*s", NAMELEN - 1, base);
+        benchImage(argv[k], label, &sm, &sp, 1);
+    }
+    for (k = 0; k < nframes; k++) {
+        sprintf(fname, "synth-%d.jpg", (int) getpid());
+        sprintf(label, "synth-%dx%d", sw[k], sh[k]);
+        if (syntheticFrame(fname, sw[k], sh[k]))
+            benchImage(fname, label, &sm, &sp, 0);
+        else
+            fprintf(stderr, "%s: cannot be written\n", label);
+        remove(fname);
+    }
+    freeSkyMask(&sm);
+    return 0;
+}
+
+/*
+ * bench-kernels.c ends here
+ */
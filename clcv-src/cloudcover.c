@@ -36,27 +36,56 @@
 #include<stdlib.h>
 #include<unistd.h>
 #include<ctype.h>
+#include<getopt.h>
+#include<dirent.h>
+#include<errno.h>
+#include<signal.h>
+#include<sys/inotify.h>
+#include<sys/resource.h>
+#include<pthread.h>
 #include<expat.h>
 #include"imageio.h"
 #include"geoinfo.h"
 #include"imageinfo.h"
 #include"timedate.h"
+#include"parallel.h"
+#include"segment.h"
+#include"metrics.h"
+#include"records.h"
+#include"rescache.h"
 #include"cloudcover.h"
 
 /* Command line input params */
 
-/* Image input filename */
+/* Image input filename (first input image) */
 char              *infname;
 
 /* Configuration XML filename */
 char              *cffname;
 
-/* Trimmed image filename */
+/* Trimmed image filename (directory in batch mode) */
 char              *trfname;
 
-/* Segmented image filename */
+/* Segmented image filename (directory in batch mode) */
 char              *sgfname;
 
+/* List of input image files */
+char             **inputs = NULL;
+int                ninputs = 0;
+int                maxinputs = 0;
+
+/* Batch mode: more than one image, or images given by list or directory */
+int                batch = FALSE;
+
+/* Number of images processed concurrently */
+int                workers = 1;
+
+/* Spool directory watched in daemon mode */
+char              *spooldir = NULL;
+
+/* Set by SIGINT or SIGTERM to finish the daemon mode */
+volatile sig_atomic_t stopreq = 0;
+
 /* Input params in config file */
 struct cfgparams {
    /* Red/Blue treshold: r/b pix ratio < treshold -> sky */
@@ -79,35 +108,145 @@ double            longitude;
 double            elevation;
 char              timezn[TZLEN];
 
-/* Image data */
-int               width, height;
-unsigned int      **image = NULL;
-unsigned int      **imageseg = NULL;
-unsigned int      **imagecnv = NULL;
+/* Mask image and its bands of rows (one per thread used in each image),
+   read once and shared by every input image */
+SkyMask           skymask;
+
+/* Segmentation parameters and their compiled R/B classifier, built once
+   after reading the configuration and shared by every input image */
+SegParams         segpars;
+
+/* Threads used to process each image */
+int               threads = 1;
+
+/* Large buffers of each image, reused by the next images of the same
+   size */
+BufPool          *buffers = NULL;
+
+/* Streaming mode: rows processed while decoded, whole image never stored */
+int               streaming = FALSE;
+
+/* Quick-look mode: images decoded at 1 / quicklook of their size */
+int               quicklook = 1;
+
+/* Profile mode: the time of each phase written for each image */
+int               profile = FALSE;
+
+/* Format of the output records (FMT_TEXT, FMT_CSV or FMT_JSONL) */
+int               outformat = FMT_TEXT;
 
-/* Output data */
-int               year;
-int               month;
-int               day;
-int               hour;
-int               minute;
-int               sec;
+/* Buffered writer of the output records */
+RecordWriter     *results = NULL;
 
-double            jdn;
-/*
-int               juldate;
-double            julfrac;
-*/
+/* Names of the fields of the CSV and JSON Lines records, the last one
+   only in sweep mode */
+const char       *recfield[NRECFIELDS + 1] = {
+   "file", "year", "month", "day", "hour", "minute", "second", "jd",
+   "latitude", "longitude", "elevation", "azimuth", "rbtreshold",
+   "neighbsize", "votes2flip", "cci", "totalarea", "totalpels", "scale",
+   "width", "height", "cci_novote"
+};
 
-double            ccindex;
+/* Sweep mode (--sweep): tresholds for which the CCI of each image is
+   calculated, instead of the one of the configuration */
+double             sweeptr[MAXSWEEP];
+int                nsweep = 0;
+
+/* Result cache file (--cache), NULL if not used */
+char              *chfname = NULL;
+
+/* Result cache, NULL if not used */
+ResultCache       *rcache = NULL;
+
+/* Hash of the parameters that change the results of an image */
+unsigned int       paramhash[2];
+
+/* Wall and CPU time of the configuration, geographic data and mask
+   reading, done once */
+double            cfgwall = 0.0, cfgcpu = 0.0;
+
+/* Names of the image phases in the profile lines */
+const char       *phasename[NPHASES] = {
+   "read", "exif", "decode", "segment", "writecut", "writeseg"
+};
+
+/* Wall and CPU time of each phase of an image */
+struct phasetimes {
+   double            wall[NPHASES];
+   double            cpu[NPHASES];
+   /* end of the last phase */
+   double            lastwall, lastcpu;
+};
+
+/* Metrics file (Prometheus text format), NULL if not required */
+char              *mtfname = NULL;
+
+/* Upper limits of the latency histograms (seconds) */
+const double      latbounds[] = {
+   0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0
+};
+
+/* Names of the failure causes in the metrics */
+const char       *failname[NFAILS] = { "read", "exif", "decode" };
+
+/* Metrics of the images processed, shared by the workers */
+struct ccmetrics {
+   pthread_mutex_t   lock;
+   /* wakes up the writer of the metrics file when it must stop */
+   pthread_cond_t    wake;
+   int               stop;
+   /* wall clock when the process started */
+   double            start;
+   unsigned long     processed;
+   unsigned long     failed[NFAILS];
+   /* images whose result was found in the cache */
+   unsigned long     cachehits;
+   /* images waiting, and images being processed */
+   int               queued;
+   int               inprogress;
+   /* wall time of each phase, and of the whole image (last one) */
+   Histogram         stage[NPHASES + 1];
+} metrics;
+
+/* Output data of a single image */
+struct ccresult {
+   int               year;
+   int               month;
+   int               day;
+   int               hour;
+   int               minute;
+   int               sec;
+   /* Julian date */
+   double            jdn;
+   /* Cloud Cover Index */
+   double            ccindex;
+   /* Total weighted area of interest region */
+   double            totalarea;
+   /* Total number of pixels in interest region */
+   int               totalpels;
+   /* In sweep mode, the CCI without and with vote for each treshold (two
+      values per treshold), NULL otherwise */
+   double           *sweep;
+};
+
+/* Image pool shared by the workers */
+struct workpool {
+   pthread_mutex_t   lock;
+   /* Index of next image to be processed */
+   int               next;
+   /* Index of next result to be written */
+   int               nextout;
+   /* Results, status and completion flag of each input image */
+   struct ccresult  *results;
+   int              *status;
+   char             *done;
+};
 
 /* Auxiliary variables used by XML parser */
 char             *valores[6];
 int               reading, idxrd;
 
 GeoInfo        locinfo;
-ImageInfo      imginfo;
-CamAndShotInfo phinfo;
 
 /**
  * \brief Set the default values for the configuration variables.
@@ -135,15 +274,6 @@ setDefaults() {
       timezn[i] = '\x0';
    }
    strcpy(timezn, UTCZONE);
-
-   year = 0;
-   month = 0;
-   day = 0;
-   hour = 0;
-   minute = 0;
-   sec = 0;
-   jdn = 0.0;
-   ccindex = 0.0;
 }
 
 /**
@@ -169,6 +299,59 @@ checkFileForRead(char *fname) {
       return 1;
 }
 
+/**
+ * \brief Verifies if a given directory is writable.
+ *
+ * @param[in] dname is the directory name
+ * \return 0 if the directory cannot be written, 1 otherwise.
+ */
+int
+checkDirForWrite(char *dname) {
+   struct stat       st;
+
+   if ((stat(dname, &st) == -1) || !S_ISDIR(st.st_mode) ||
+       access(dname, W_OK | X_OK))
+      return 0;
+   return 1;
+}
+
+/**
+ * \brief Verifies if a file name has the JPEG extension.
+ *
+ * @param[in] fname is the file name
+ * \return 1 if the name ends with ".jpg" or ".jpeg" (in any case), 0
+ * otherwise.
+ */
+int
+isJPEGName(char *fname) {
+   char             *ext = strrchr(fname, '.');
+
+   return (ext != NULL) &&
+      (!strcasecmp(ext, ".jpg") || !strcasecmp(ext, ".jpeg"));
+}
+
+/**
+ * \brief Builds the name of an output image in batch mode.
+ *
+ * The output name is dir/stem-suffix.png, where stem is the input file
+ * name without path and without extension.
+ * @param[in] dir is the output directory.
+ * @param[in] fname is the input image file name.
+ * @param[in] suffix is the suffix of the output file ("cut" or "seg").
+ * @param[out] oname is the output file name, MAXFNLEN chars long.
+ */
+void
+outputName(char *dir, char *fname, char *suffix, char *oname) {
+   char             *from = strrchr(fname, '/');
+   char             *ext;
+   int               len;
+
+   from = (from == NULL) ? fname : from + 1;
+   ext = strrchr(from, '.');
+   len = (ext == NULL) ? (int) strlen(from) : (int) (ext - from);
+   snprintf(oname, MAXFNLEN, "%s/%.*s-%s.png", dir, len, from, suffix);
+}
+
 /**
  * Expat processing element routine.
  */
@@ -346,12 +529,67 @@ usage(char *prgname, char *errmsg, int errcode) {
    fprintf(stderr, "-c <XML config file (optional)> ");
    fprintf(stderr, "-t <trimmed image file (optional)> ");
    fprintf(stderr, "-s <segmented image file (optional)> ");
-   fprintf(stderr, "<input image file> \n");
-   fprintf(stderr, "Output (tab separated):\n");
-   fprintf(stderr, "Year, Month, Date, Hour, Min, Sec, JD, JH, ");
-   fprintf(stderr, "Lat, Lon, Ele, Azim, RBThr,NSide, Conv, CCI\n");
-   fprintf(stderr, "JD = Julian Day Number.\n");
-   fprintf(stderr, "JH = Julian Hour (fraction of the day).\n");
+   fprintf(stderr, "-l <list of input files (optional)> ");
+   fprintf(stderr, "-d <directory of input files (optional)> ");
+   fprintf(stderr, "-w <spool directory to watch (optional)> ");
+   fprintf(stderr, "-j <images processed in parallel (optional)> ");
+   fprintf(stderr, "-p <threads per image (optional)> ");
+   fprintf(stderr, "-m (streaming mode, optional) ");
+   fprintf(stderr, "-q <quick-look scale 2, 4 or 8 (optional)> ");
+   fprintf(stderr, "--profile (optional) ");
+   fprintf(stderr, "--metrics <metrics file (optional)> ");
+   fprintf(stderr, "--format <text, csv or jsonl (optional)> ");
+   fprintf(stderr, "--cache <result cache file (optional)> ");
+   fprintf(stderr, "--sweep <tresholds (optional)> ");
+   fprintf(stderr, "<input image file(s)> \n");
+   fprintf(stderr, "Batch mode (several images, -l or -d): -t and -s are ");
+   fprintf(stderr, "directories, one output line per image, in input ");
+   fprintf(stderr, "order. -j 0 uses one worker per processor.\n");
+   fprintf(stderr, "-p splits each image among threads (0: one per ");
+   fprintf(stderr, "processor), the CCI does not depend on it. The -t and ");
+   fprintf(stderr, "-s PNG files are also compressed by that many ");
+   fprintf(stderr, "threads.\n");
+   fprintf(stderr, "-m processes the rows while they are decoded, without ");
+   fprintf(stderr, "storing the whole image (one thread per image, ");
+   fprintf(stderr, "same CCI).\n");
+   fprintf(stderr, "-q decodes the images at 1/2, 1/4 or 1/8 of their ");
+   fprintf(stderr, "size with a reduced mask (approximate CCI), the scale ");
+   fprintf(stderr, "and the analyzed size are added to the output line.\n");
+   fprintf(stderr, "--profile writes in the standard error a line per ");
+   fprintf(stderr, "image with the wall and CPU time of each phase, the ");
+   fprintf(stderr, "bytes allocated and the peak memory (key=value).\n");
+   fprintf(stderr, "--metrics rewrites the file every %d seconds ",
+           METRICSPERIOD);
+   fprintf(stderr, "with counters and latency histograms in the ");
+   fprintf(stderr, "Prometheus text format.\n");
+   fprintf(stderr, "--format csv (with a header line) or jsonl (an ");
+   fprintf(stderr, "object per line) writes records with the fields: ");
+   fprintf(stderr, "file, year, month, day, hour, minute, second, jd, ");
+   fprintf(stderr, "latitude, longitude, elevation, azimuth, rbtreshold, ");
+   fprintf(stderr, "neighbsize, votes2flip, cci, totalarea, totalpels, ");
+   fprintf(stderr, "scale, width, height (and cci_novote with --sweep).\n");
+   fprintf(stderr, "--cache keeps the results in a file (shared by ");
+   fprintf(stderr, "several processes, the %d most recently used), ",
+           CACHEENTRIES);
+   fprintf(stderr, "an image already processed with the same parameters ");
+   fprintf(stderr, "is not decoded again unless -t or -s is given.\n");
+   fprintf(stderr, "--sweep t1,t2,... or from:to:step writes a record per ");
+   fprintf(stderr, "treshold (multiples of 1/%d up to %d) ", SWEEPSCALE,
+           SWEEPMAX);
+   fprintf(stderr, "instead of RBThr, with the CCI and the CCI without ");
+   fprintf(stderr, "vote added; each image is decoded once (no -t, -s, ");
+   fprintf(stderr, "-m nor cache).\n");
+   fprintf(stderr, "Daemon mode (-w): new JPEG files in the spool directory ");
+   fprintf(stderr, "are processed and moved to its done/ or failed/ ");
+   fprintf(stderr, "subdirectory, until SIGINT or SIGTERM.\n");
+   fprintf(stderr, "Output (text format, space separated, a line per ");
+   fprintf(stderr, "image):\n");
+   fprintf(stderr, "Year, Month, Date, Hour, Min, Sec, JD, ");
+   fprintf(stderr, "Lat, Lon, Ele, Azim, RBThr, NSide, Conv, CCI\n");
+   fprintf(stderr, "(the CCI without vote is added with --sweep, the ");
+   fprintf(stderr, "scale and the analyzed size with -q)\n");
+   fprintf(stderr, "JD = Julian date (the fraction is the time of the ");
+   fprintf(stderr, "day).\n");
    fprintf(stderr, "Ele = Elevation (in meters).\n");
    fprintf(stderr, "RBThr = Red/Blue Threshold used to classify.\n");
    fprintf(stderr, "NSide = Neighborhood side size used in convolution.\n");
@@ -373,10 +611,168 @@ diagnostic(int c) {
    exit(4);
 }
 
+/**
+ * \brief Appends a file name to the list of input images.
+ *
+ * @param[in] fname is the name of the input image file.
+ * \return 1 if success, -1 if there is not enough memory, -2 if the name
+ * has MAXFNLEN characters or more (the list is not changed).
+ */
+int
+addInput(char *fname) {
+   char            **grown;
+   int               size;
+
+   if (strlen(fname) >= MAXFNLEN)
+      return -2;
+   if (ninputs == maxinputs) {
+      size = (maxinputs == 0) ? 16 : 2 * maxinputs;
+      grown = (char **) realloc(inputs, size * sizeof(char *));
+      if (grown == NULL)
+         return -1;
+      inputs = grown;
+      maxinputs = size;
+   }
+   inputs[ninputs] = (char *) malloc(MAXFNLEN);
+   if (inputs[ninputs] == NULL)
+      return -1;
+   strcpy(inputs[ninputs], fname);
+   ninputs++;
+   return 1;
+}
+
+/**
+ * \brief Reads the input image names from a list file.
+ *
+ * The list file contains a file name per line. Empty lines and lines
+ * beginning with '#' are ignored. The name "-" means standard input.
+ * @param[in] lfname is the name of list file.
+ * \return 1 if success, 0 if the list file cannot be read, -1 if there
+ * is not enough memory for the list, -2 if a name is too long.
+ */
+int
+readInputList(char *lfname) {
+   char              line[MAXFNLEN + 1];
+   int               len;
+   FILE             *lf = (strcmp(lfname, "-")) ? fopen(lfname, "r") : stdin;
+   int               res = 1;
+
+   if (lf == NULL)
+      return 0;
+   while (fgets(line, MAXFNLEN + 1, lf) != NULL) {
+      len = strlen(line);
+      /* a line that fills the buffer has a name too long */
+      if ((len == MAXFNLEN) && (line[len - 1] != '\n')) {
+         res = -2;
+         break;
+      }
+      while ((len > 0) && isspace((unsigned char) line[len - 1]))
+         line[--len] = '\x0';
+      if ((len == 0) || (line[0] == '#'))
+         continue;
+      res = addInput(line);
+      if (res < 0)
+         break;
+   }
+   if (lf != stdin)
+      fclose(lf);
+   return res;
+}
+
+/**
+ * Comparison function used to sort the images found in a directory.
+ */
+static int
+cmpnames(const void *a, const void *b) {
+   return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+/**
+ * \brief Adds, as input images, all the JPEG files in a directory.
+ *
+ * The files whose name ends with ".jpg" or ".jpeg" (case insensitive) are
+ * added in lexicographic order.
+ * @param[in] dname is the directory name.
+ * \return 1 if success, 0 if the directory cannot be read, -1 if there is
+ * not enough memory for the list, -2 if some path is too long (the other
+ * files are added, so a spool directory is not blocked by it).
+ */
+int
+readInputDir(char *dname) {
+   DIR              *dir = opendir(dname);
+   struct dirent    *ent;
+   char              path[MAXFNLEN];
+   int               first = ninputs, res = 1;
+
+   if (dir == NULL)
+      return 0;
+   while ((ent = readdir(dir)) != NULL) {
+      if (!isJPEGName(ent->d_name))
+         continue;
+      if (snprintf(path, MAXFNLEN, "%s/%s", dname, ent->d_name) >=
+          MAXFNLEN) {
+         res = -2;
+         continue;
+      }
+      if (checkFileForRead(path) && (addInput(path) < 0)) {
+         res = -1;
+         break;
+      }
+   }
+   closedir(dir);
+   qsort(inputs + first, ninputs - first, sizeof(char *), cmpnames);
+   return res;
+}
+
+/**
+ * \brief Reads the tresholds of the sweep mode.
+ *
+ * The argument is a comma separated list whose items are tresholds or
+ * ranges from:to:step (both ends included). The tresholds are rounded to
+ * the grid of the R/B histograms (multiples of 1 / SWEEPSCALE).
+ * @param[in] arg is the list, shorter than MAXFNLEN.
+ * \return 1 if success, 0 if the list is not valid, some treshold is out
+ * of [0, SWEEPMAX] or there are more than MAXSWEEP tresholds.
+ */
+int
+readSweep(char *arg) {
+   char              list[MAXFNLEN], *item, *end;
+   double            from, to, step, t;
+   int               k, n;
+
+   strcpy(list, arg);
+   nsweep = 0;
+   for (item = strtok(list, ","); item != NULL; item = strtok(NULL, ",")) {
+      from = to = strtod(item, &end);
+      step = 1.0;
+      if (*end == ':') {
+         to = strtod(end + 1, &end);
+         if (*end != ':')
+            return 0;
+         step = strtod(end + 1, &end);
+      }
+      if ((end == item) || (*end != '\x0') || (from < 0.0) ||
+          (to > SWEEPMAX) || (from > to) || (step <= 0.0))
+         return 0;
+      /* the steps are counted, not added, so no treshold is lost */
+      n = (int) ((to - from) / step + 1.0e-9);
+      for (k = 0; k <= n; k++) {
+         if (nsweep == MAXSWEEP)
+            return 0;
+         t = from + k * step;
+         sweeptr[nsweep++] = (int) (t * SWEEPSCALE + 0.5) /
+            (double) SWEEPSCALE;
+      }
+   }
+   return nsweep > 0;
+}
+
 /**
  * \brief Capture all the command line options.
  * Capture the name of files given in command line and validate them
- * (verify readability).
+ * (verify readability). Input images can be given as positional
+ * arguments, in a list file (option -l), as a directory (option -d) or
+ * as a spool directory to be watched (option -w).
  * @param[in] na is the original commnd line argument counter.
  * @param[in] la are the command line string.
  * @param[out] confile is the config file name.
@@ -384,11 +780,21 @@ diagnostic(int c) {
  * @param[out] segfile is the segmented file name.
  */
 void
-catchParams(int na, char *la[], char **inpfile,
+catchParams(int na, char *la[],
             char **confile, char **trifile, char **segfile) {
-   char c;
+   static struct option longopts[] = {
+      {"profile", no_argument, NULL, 'P'},
+      {"metrics", required_argument, NULL, 'M'},
+      {"format", required_argument, NULL, 'F'},
+      {"cache", required_argument, NULL, 'C'},
+      {"sweep", required_argument, NULL, 'S'},
+      {NULL, 0, NULL, 0}
+   };
+   int c, res;
+   char *endptr;
 
-   while ((c = getopt(na, la, "c:t:s:")) != -1) {
+   while ((c = getopt_long(na, la, "c:t:s:l:d:w:j:p:mq:", longopts,
+                           NULL)) != -1) {
       switch (c) {
          case 'c':
             *confile = (char *) malloc(MAXFNLEN);
@@ -402,19 +808,117 @@ catchParams(int na, char *la[], char **inpfile,
             *segfile = (char *) malloc(MAXFNLEN);
             strncpy(*segfile, optarg, MAXFNLEN);
             break;
+         case 'l':
+            batch = TRUE;
+            res = readInputList(optarg);
+            if (res == -2)
+               usage(la[0], ERR_FNLEN, 1);
+            if (res < 0)
+               usage(la[0], ERR_NOMEM, 2);
+            if (!res)
+               usage(la[0], ERR_LSFIL, 2);
+            break;
+         case 'd':
+            batch = TRUE;
+            res = readInputDir(optarg);
+            if (res == -2)
+               usage(la[0], ERR_FNLEN, 1);
+            if (res < 0)
+               usage(la[0], ERR_NOMEM, 2);
+            if (!res)
+               usage(la[0], ERR_INDIR, 2);
+            break;
+         case 'j':
+            workers = strtol(optarg, &endptr, 10);
+            if ((endptr == optarg) || (*endptr != '\x0'))
+               usage(la[0], ERR_NWORK, 1);
+            if (workers == 0)
+               workers = numProcessors();
+            if ((workers < 1) || (workers > MAXTHREADS))
+               usage(la[0], ERR_NWORK, 1);
+            break;
+         case 'p':
+            threads = strtol(optarg, &endptr, 10);
+            if ((endptr == optarg) || (*endptr != '\x0'))
+               usage(la[0], ERR_NTHRD, 1);
+            if (threads == 0)
+               threads = numProcessors();
+            if ((threads < 1) || (threads > MAXTHREADS))
+               usage(la[0], ERR_NTHRD, 1);
+            break;
+         case 'm':
+            streaming = TRUE;
+            break;
+         case 'P':
+            profile = TRUE;
+            break;
+         case 'M':
+            if (strlen(optarg) >= MAXFNLEN)
+               usage(la[0], ERR_FNLEN, 1);
+            mtfname = (char *) malloc(MAXFNLEN);
+            strcpy(mtfname, optarg);
+            break;
+         case 'S':
+            if (strlen(optarg) >= MAXFNLEN)
+               usage(la[0], ERR_FNLEN, 1);
+            if (!readSweep(optarg))
+               usage(la[0], ERR_SWEEP, 1);
+            break;
+         case 'C':
+            if (strlen(optarg) >= MAXFNLEN)
+               usage(la[0], ERR_FNLEN, 1);
+            chfname = (char *) malloc(MAXFNLEN);
+            strcpy(chfname, optarg);
+            break;
+         case 'F':
+            outformat = recordFormat(optarg);
+            if (outformat < 0)
+               usage(la[0], ERR_FRMAT, 1);
+            break;
+         case 'q':
+            quicklook = strtol(optarg, &endptr, 10);
+            if ((endptr == optarg) || (*endptr != '\x0') ||
+                ((quicklook != 2) && (quicklook != 4) && (quicklook != 8)))
+               usage(la[0], ERR_SCALE, 1);
+            break;
+         case 'w':
+            batch = TRUE;
+            if (strlen(optarg) >= MAXFNLEN)
+               usage(la[0], ERR_FNLEN, 1);
+            spooldir = (char *) malloc(MAXFNLEN);
+            strcpy(spooldir, optarg);
+            if (!checkDirForWrite(spooldir))
+               usage(la[0], ERR_SPOOL, 2);
+            break;
       }
    }
-   if (optind != (na - 1))
+   if (!batch && (optind >= na))
       usage(la[0], ERR_NARGS, 1);
-   /* Input image file name */
-   *inpfile = (char *) malloc(MAXFNLEN);
-   strncpy(*inpfile, la[optind], MAXFNLEN);
+   if (na - optind > 1)
+      batch = TRUE;
+   /* Input image file names */
+   for (; optind < na; optind++) {
+      res = addInput(la[optind]);
+      if (res == -2)
+         usage(la[0], ERR_FNLEN, 1);
+      if (res < 0)
+         usage(la[0], ERR_NOMEM, 2);
+   }
+   if ((ninputs == 0) && (spooldir == NULL))
+      usage(la[0], ERR_NOINP, 1);
+   infname = (ninputs > 0) ? inputs[0] : spooldir;
 
    /* Validate command line arguments */
-   if (!checkFileForRead(*inpfile))  /* input file readable */
+   if (!batch && !checkFileForRead(infname))  /* input file readable */
       usage(la[0], ERR_INFIL, 2);
    if (!checkFileForRead(*confile))  /* config file readable */
       usage(la[0], ERR_CFFIL, 3);
+   if (batch) { /* output names are directories */
+      if ((*trifile != NULL) && !checkDirForWrite(*trifile))
+         usage(la[0], ERR_OUDIR, 2);
+      if ((*segfile != NULL) && !checkDirForWrite(*segfile))
+         usage(la[0], ERR_OUDIR, 2);
+   }
 }
 
 /**
@@ -423,7 +927,7 @@ catchParams(int na, char *la[], char **inpfile,
  */
 void
 logParams() {
-   fprintf(stderr, "Input: %s|\n", infname);
+   fprintf(stderr, "Input: %s| (%d image(s))\n", infname, ninputs);
    if (cffname != NULL) {
       fprintf(stderr, "Use config file\n");
       fprintf(stderr, "Config: %s|\n", cffname);
@@ -446,232 +950,896 @@ logParams() {
 }
 
 /**
- * \brief Determines the weight factor used for a given pixel.
- *
- * Given the radial distance between some pixel and the image center, this
- * function gets the index that must be used in the factors array to weight
- * that pixel in the pixel counting.
- * @param[in] t target to be search.
- * @param[in] carr is the array where the search must be performed (in our
- * case the categories array must be used.
- * @param[in] low minimum index in the carr array to be used for search
- * (inclusive).
- * @param[in] ipp maximum index in the carr array to be used for search
- * (inclusive).
- * \return the index in the carra array where the first value greater or
- * equal to the given value (t) is stored. This is the index that must be
- * used in the factors array.
- */
-int catsearch(int t, const int carr[], int low, int upp) {
-  int l, u, m;
-  if ((low < upp) && (carr != NULL)) {
-    l = low;
-    u = upp;
-    while (l <= u) {
-      m = (int)((l + u) / 2);
-      if (carr[m] < t) l = m + 1;
-      else if (carr[m] > t) u = m - 1;
-      else return m;
-    }
-    if (l <= upp)
-      return l;
-  }
-  return -1;
-}
-
-/**
- * \brief Read an image from a JPEG file and cuts it to the size of a given
- * mask.
- *
- * Given a mask, whose size is enough to contain, exactly, the interest
- * region of the images, this function reads and crop an original image to
- * get only the interest region.
- *
- * @param[in] fname is the name of the file which contains the original
- * JPEG RGB EXIF image to be processed for the program.
- * @param[in] mskf is the filename of a PNG image which is the mask used to
- * filter only the interest region of the whole original image.
- * @param[out] wd is the width of interest region and, therefore, the width
- * of resulting buffer image returned by the function. It's set from the
- * width of mask.
- * @param[out] hg is the height of interest region and, therefore, the height
- * of resulting buffer image returned by the function. It's set from the
- * height of mask.
- * \return a 2-dimensional buffer with the data of image interest
- * region. The data of pixel in row i, column j of such region is stored as
- * the integer in the position [i][j] of the buffer returned by the
- * function. The most significant byte is the A (alpha) component
- * (transparency) of the pixel, followed by the R (red) component, the next
- * one is the G (green), the least significant bye is the B (blue)
- * component. Thus the integer (hex format) is AARRGGBB.
- */
-unsigned int **readAndCut(char *fname, char *mskf, int *wd, int *hg) {
-   int wm, hm, wi, hi, i, j, mv, mh;
-   unsigned int **img = readJPGImage(fname, &wi, &hi);
-   unsigned int **msk = readPNGImage(mskf, &wm, &hm);
-   unsigned int **res = (unsigned int **) malloc(hm *
-                                                 sizeof(unsigned int *));
-   unsigned int *whole = (unsigned int *) malloc(hm * wm *
-                                                 sizeof(unsigned int));
-   for (i = 0; i < hm; i++)
-      res[i] = whole + i * wm;
-
-   mh = (int) ((double)wi - (double)wm) / 2.0;
-   mv = (int) ((double)hi - (double)hm) / 2.0;
-   for (i = 0; i < hm; i++) {
-      for (j = 0; j < wm; j++) {
-         res[i][j] = msk[i][j] & img[i + mv][j + mh];
+ * \brief Starts the measure of the phases of an image.
+ *
+ * @param[out] pt is the structure where the times are stored.
+ */
+void
+startPhases(struct phasetimes *pt) {
+   int               k;
+
+   for (k = 0; k < NPHASES; k++)
+      pt->wall[k] = pt->cpu[k] = 0.0;
+   pt->lastwall = wallClock();
+   pt->lastcpu = cpuClock();
+}
+
+/**
+ * \brief Ends a phase of an image: the time since the end of the previous
+ * one is added to it.
+ *
+ * @param[in,out] pt is the structure where the times are stored.
+ * @param[in] phase is the phase that ends (PRF_READ, ..., PRF_WRITESEG).
+ */
+void
+endPhase(struct phasetimes *pt, int phase) {
+   double            wall = wallClock(), cpu = cpuClock();
+
+   pt->wall[phase] += wall - pt->lastwall;
+   pt->cpu[phase] += cpu - pt->lastcpu;
+   pt->lastwall = wall;
+   pt->lastcpu = cpu;
+}
+
+/**
+ * \brief Writes, in the standard error, the profile line of an image.
+ *
+ * A single line of key=value pairs, easy to parse: the file name, the
+ * wall and CPU seconds of the configuration reading (done once, the same
+ * in every line) and of each phase of the image, the seconds spent by the
+ * segmentation threads in the classification, the votes and the CCI
+ * counting (added over the threads, so they are CPU time), the total of
+ * the image, the bytes of the buffers allocated while it was processed,
+ * and the peak resident set size of the process in kilobytes. The CPU
+ * time and the allocations are the ones of the whole process, so with
+ * -j they include the images processed at the same time.
+ * @param[in] fname is the input image file name.
+ * @param[in] pt are the times of the phases of the image.
+ * @param[in] cci is the result of the segmentation, with its stage times.
+ * @param[in] bytes is the number of bytes allocated.
+ */
+void
+printProfile(char *fname, struct phasetimes *pt, CCIResult *cci,
+             unsigned long bytes) {
+   char              line[PRFLEN];
+   struct rusage     ru;
+   double            wall = 0.0, cpu = 0.0;
+   int               k, len;
+
+   len = snprintf(line, PRFLEN, "profile file=%.*s config_wall=%.6f "
+                  "config_cpu=%.6f", MAXFNLEN, fname, cfgwall, cfgcpu);
+   for (k = 0; k < NPHASES; k++) {
+      len += snprintf(line + len, PRFLEN - len, " %s_wall=%.6f %s_cpu=%.6f",
+                      phasename[k], pt->wall[k], phasename[k], pt->cpu[k]);
+      wall += pt->wall[k];
+      cpu += pt->cpu[k];
+   }
+   len += snprintf(line + len, PRFLEN - len, " classify_cpu=%.6f "
+                   "vote_cpu=%.6f cci_cpu=%.6f", cci->classifytime,
+                   cci->votetime, cci->counttime);
+   getrusage(RUSAGE_SELF, &ru);
+   snprintf(line + len, PRFLEN - len, " total_wall=%.6f total_cpu=%.6f "
+            "alloc_bytes=%lu peak_rss_kb=%ld", wall, cpu, bytes,
+            ru.ru_maxrss);
+   fprintf(stderr, "%s\n", line);
+}
+
+/**
+ * \brief Initializes the metrics of the process.
+ */
+void
+initMetrics() {
+   int               k, nb = sizeof(latbounds) / sizeof(double);
+
+   pthread_mutex_init(&metrics.lock, NULL);
+   pthread_cond_init(&metrics.wake, NULL);
+   metrics.stop = FALSE;
+   metrics.start = wallClock();
+   metrics.processed = metrics.cachehits = 0;
+   for (k = 0; k < NFAILS; k++)
+      metrics.failed[k] = 0;
+   metrics.queued = metrics.inprogress = 0;
+   for (k = 0; k <= NPHASES; k++)
+      initHistogram(&metrics.stage[k], latbounds, nb);
+}
+
+/**
+ * \brief Sets the number of input images waiting to be processed.
+ *
+ * @param[in] queued is the number of images.
+ */
+void
+setQueued(int queued) {
+   pthread_mutex_lock(&metrics.lock);
+   metrics.queued = (queued > 0) ? queued : 0;
+   pthread_mutex_unlock(&metrics.lock);
+}
+
+/**
+ * \brief Counts an image whose processing starts.
+ */
+void
+startImage() {
+   pthread_mutex_lock(&metrics.lock);
+   metrics.inprogress++;
+   pthread_mutex_unlock(&metrics.lock);
+}
+
+/**
+ * \brief Counts an image whose result was found in the cache.
+ */
+void
+countCacheHit() {
+   pthread_mutex_lock(&metrics.lock);
+   metrics.cachehits++;
+   pthread_mutex_unlock(&metrics.lock);
+}
+
+/**
+ * \brief Counts an image whose processing ends.
+ *
+ * The phases of the images processed are added to the latency
+ * histograms (the ones not done, as the writing of images not required,
+ * are not counted).
+ * @param[in] fail is the cause of the failure (FAIL_READ, FAIL_EXIF or
+ * FAIL_DECODE), -1 if the image was processed.
+ * @param[in] pt are the times of the phases of the image.
+ */
+void
+endImage(int fail, struct phasetimes *pt) {
+   double            total = 0.0;
+   int               k;
+
+   pthread_mutex_lock(&metrics.lock);
+   metrics.inprogress--;
+   if (fail >= 0)
+      metrics.failed[fail]++;
+   else {
+      metrics.processed++;
+      for (k = 0; k < NPHASES; k++) {
+         if (pt->wall[k] > 0.0)
+            observeValue(&metrics.stage[k], pt->wall[k]);
+         total += pt->wall[k];
       }
+      observeValue(&metrics.stage[NPHASES], total);
    }
-   free(img);
-   free(msk);
-   *wd = wm;
-   *hg = hm;
-   return res;
+   pthread_mutex_unlock(&metrics.lock);
 }
 
 /**
- * \brief Convolution operator to smooth borderline.
- *
- * Given the segmented image, this function smooth the borderline between
- * the two diferent classes.
- * @param[in] sdsz side size of neighborhood. This must be an odd integer.
- * @param[in] mv minimum number of votes in the neighborhood needed to
- * change the central pixel value.
- * @param[in] img is the image to be convolved.
- * @param[in] w image width.
- * @param[in] h image height.
- * \return A new image buffer with the resulting convolved image.
- *
- */
-unsigned int **convolution(int sdsz, int mv,
-                            unsigned int **img, int w, int h ) {
-   int i, j, pelcolor, nesi = (int) ((double)sdsz / 2.0);
-   int  n, m, nv;
-   unsigned int **res = (unsigned int **) malloc(h *
-                                                 sizeof(unsigned int *));
-   unsigned int *whole = (unsigned int *) malloc(h * w *
-                                                 sizeof(unsigned int));
-   for (i = 0; i < h; i++)
-      res[i] = whole + i * w;
-
-   for (i = nesi; i < h - nesi; i++) {
-      for (j = nesi; j < w - nesi; j++) {
-         pelcolor = img[i][j];
-         if (pelcolor == 0X00000000) {
-            res[i][j] = 0X00000000;
-         }
-         else {
-            nv = 0;
-            for (n = i - nesi; n <= i + nesi; n++) {
-               for (m = j - nesi; m <= j + nesi; m++) {
-                  if ((img[n][m] ^ pelcolor) != 0) {
-                     nv++;
-                  }
-               }
-            }
-            if (nv >= mv) res[i][j] = 0XFF000000 | ~pelcolor;
-            else res[i][j] = 0XFF000000 | pelcolor;
+ * \brief Writes the metrics in the Prometheus text format.
+ *
+ * @param[in] f is the output file.
+ * @param[in] arg is not used.
+ */
+void
+writeMetrics(FILE *f, void *arg) {
+   char              labels[32];
+   double            uptime;
+   unsigned long     bytes;
+   int               kept, busy, k;
+
+   poolUsage(buffers, &kept, &busy, &bytes);
+   pthread_mutex_lock(&metrics.lock);
+   uptime = wallClock() - metrics.start;
+   writeMetricHeader(f, "cloudcover_images_processed_total", "counter",
+                     "Images whose CCI was calculated.");
+   writeSample(f, "cloudcover_images_processed_total", NULL,
+               metrics.processed);
+   writeMetricHeader(f, "cloudcover_image_failures_total", "counter",
+                     "Images that could not be processed, by cause.");
+   for (k = 0; k < NFAILS; k++) {
+      sprintf(labels, "reason=\"%s\"", failname[k]);
+      writeSample(f, "cloudcover_image_failures_total", labels,
+                  metrics.failed[k]);
+   }
+   writeMetricHeader(f, "cloudcover_cache_hits_total", "counter",
+                     "Images whose result was found in the cache.");
+   writeSample(f, "cloudcover_cache_hits_total", NULL, metrics.cachehits);
+   writeMetricHeader(f, "cloudcover_images_per_second", "gauge",
+                     "Images processed per second since the start.");
+   writeSample(f, "cloudcover_images_per_second", NULL,
+               (uptime > 0.0) ? metrics.processed / uptime : 0.0);
+   writeMetricHeader(f, "cloudcover_uptime_seconds", "gauge",
+                     "Seconds since the process started.");
+   writeSample(f, "cloudcover_uptime_seconds", NULL, uptime);
+   writeMetricHeader(f, "cloudcover_queue_depth", "gauge",
+                     "Input images waiting to be processed.");
+   writeSample(f, "cloudcover_queue_depth", NULL, metrics.queued);
+   writeMetricHeader(f, "cloudcover_images_in_progress", "gauge",
+                     "Images being processed.");
+   writeSample(f, "cloudcover_images_in_progress", NULL,
+               metrics.inprogress);
+   writeMetricHeader(f, "cloudcover_stage_duration_seconds", "histogram",
+                     "Wall time of each phase of an image.");
+   for (k = 0; k <= NPHASES; k++) {
+      sprintf(labels, "stage=\"%s\"", (k < NPHASES) ? phasename[k] :
+              "total");
+      writeHistogram(f, "cloudcover_stage_duration_seconds", labels,
+                     &metrics.stage[k]);
+   }
+   pthread_mutex_unlock(&metrics.lock);
+   writeMetricHeader(f, "cloudcover_bufpool_allocations_total", "counter",
+                     "Buffers allocated by the buffer pool.");
+   writeSample(f, "cloudcover_bufpool_allocations_total", NULL,
+               poolAllocations(buffers));
+   writeMetricHeader(f, "cloudcover_bufpool_allocated_bytes_total",
+                     "counter", "Bytes allocated by the buffer pool.");
+   writeSample(f, "cloudcover_bufpool_allocated_bytes_total", NULL,
+               poolBytes(buffers));
+   writeMetricHeader(f, "cloudcover_bufpool_buffers", "gauge",
+                     "Buffers kept by the buffer pool.");
+   writeSample(f, "cloudcover_bufpool_buffers", "state=\"busy\"", busy);
+   writeSample(f, "cloudcover_bufpool_buffers", "state=\"free\"",
+               kept - busy);
+   writeMetricHeader(f, "cloudcover_bufpool_bytes", "gauge",
+                     "Bytes of the buffers kept by the buffer pool.");
+   writeSample(f, "cloudcover_bufpool_bytes", NULL, bytes);
+}
+
+/**
+ * \brief Writer of the metrics file.
+ *
+ * Rewrites the file every METRICSPERIOD seconds, and once more when it
+ * is asked to stop.
+ * @param[in] arg is not used.
+ * \return NULL.
+ */
+void *
+metricsWriter(void *arg) {
+   struct timespec   ts;
+   int               stop;
+
+   do {
+      pthread_mutex_lock(&metrics.lock);
+      clock_gettime(CLOCK_REALTIME, &ts);
+      ts.tv_sec += METRICSPERIOD;
+      while (!metrics.stop &&
+             (pthread_cond_timedwait(&metrics.wake, &metrics.lock, &ts) !=
+              ETIMEDOUT));
+      stop = metrics.stop;
+      pthread_mutex_unlock(&metrics.lock);
+      if (!writeMetricsFile(mtfname, writeMetrics, NULL))
+         fprintf(stderr, ERR_MTFIL);
+   } while (!stop);
+   return NULL;
+}
+
+/**
+ * \brief Stops the writer of the metrics file, after its last write.
+ *
+ * @param[in] writer is the thread of the writer (if mtfname is not NULL).
+ */
+void
+stopMetrics(pthread_t writer) {
+   if (mtfname == NULL)
+      return;
+   pthread_mutex_lock(&metrics.lock);
+   metrics.stop = TRUE;
+   pthread_cond_signal(&metrics.wake);
+   pthread_mutex_unlock(&metrics.lock);
+   pthread_join(writer, NULL);
+}
+
+/**
+ * \brief Opens the result cache.
+ *
+ * The results depend on the image bytes and on the parameters hashed
+ * here: the classification and vote parameters, the mask contents, the
+ * azimuth and time zone (used with the EXIF data) and the quick-look
+ * scale. If the cache cannot be used the images are processed without it.
+ */
+void
+openCache() {
+   char              params[PRFLEN];
+   unsigned int      maskhash[2];
+
+   if (!hashFile(cfgvals.msfname, maskhash)) {
+      fprintf(stderr, ERR_CACHE);
+      return;
+   }
+   snprintf(params, PRFLEN, "rbtreshold=%.17g neighbsize=%d votes2flip=%d "
+            "mask=%08x%08x azimuth=%.17g timezone=%s quicklook=%d",
+            cfgvals.rbtreshold, cfgvals.neighbsize, cfgvals.votes2flip,
+            maskhash[0], maskhash[1], cfgvals.azimuth, timezn, quicklook);
+   hashBytes(params, strlen(params), paramhash);
+   rcache = openResultCache(chfname, CACHEENTRIES);
+   if (rcache == NULL)
+      fprintf(stderr, ERR_CACHE);
+}
+
+/**
+ * \brief Calculates the Cloud Cover Index of an image for each treshold
+ * of the sweep.
+ *
+ * The R/B ratio histogram of the decoded region gives the CCI without
+ * vote of every treshold. When the vote can flip some pixel, the
+ * classification and vote are repeated for each treshold on the same
+ * region (the image is not decoded again).
+ * @param[in] region is the decoded box of the image under the mask.
+ * @param[out] ccr is the structure where the results are stored, its
+ * sweep array is allocated.
+ * @param[out] cci is the result of the last treshold.
+ * \return 1 if success, 0 if there is not enough memory.
+ */
+int
+sweepRegion(PlanarImage *region, struct ccresult *ccr, CCIResult *cci) {
+   RBHistogram      *rh;
+   SegParams         sp;
+   double            thr;
+   int               k, vote = votesFlip(&segpars);
+
+   rh = ratioHistogram(region, &skymask, segpars.neighbsize);
+   ccr->sweep = (double *) malloc(2 * nsweep * sizeof(double));
+   if ((rh == NULL) || (ccr->sweep == NULL)) {
+      freeRBHistogram(rh);
+      free(ccr->sweep);
+      ccr->sweep = NULL;
+      return 0;
+   }
+   sp = segpars;
+   for (k = 0; k < nsweep; k++) {
+      thr = sweeptr[k];
+      ccr->sweep[2 * k] = ccr->sweep[2 * k + 1] = sweepIndex(rh, &thr, cci);
+      if (vote) {
+         sp.rbtreshold = thr;
+         compileClassifier(&sp);
+         if (!segmentRegion(region, &skymask, &sp, NULL, NULL, cci)) {
+            freeRBHistogram(rh);
+            free(ccr->sweep);
+            ccr->sweep = NULL;
+            return 0;
          }
+         ccr->sweep[2 * k + 1] = cci->ccindex;
       }
    }
-   return res;
+   freeRBHistogram(rh);
+   return 1;
+}
+
+/**
+ * \brief Packs the results of an image in a cache value.
+ *
+ * The value has a fixed layout, without padding nor pointers: year,
+ * month, day, hour, minute, sec, jdn, ccindex, totalarea and totalpels,
+ * all of them stored as doubles (exact for the integers).
+ * @param[in] ccr is the structure with the results of the image.
+ * @param[out] val is the value, NCACHEVALS doubles.
+ */
+void
+packResult(struct ccresult *ccr, double *val) {
+   memset(val, 0, NCACHEVALS * sizeof(double));
+   val[0] = ccr->year;
+   val[1] = ccr->month;
+   val[2] = ccr->day;
+   val[3] = ccr->hour;
+   val[4] = ccr->minute;
+   val[5] = ccr->sec;
+   val[6] = ccr->jdn;
+   val[7] = ccr->ccindex;
+   val[8] = ccr->totalarea;
+   val[9] = ccr->totalpels;
+}
+
+/**
+ * \brief Unpacks the results of an image from a cache value.
+ *
+ * @param[in] val is the value written by packResult.
+ * @param[out] ccr is the structure where the results are stored (without
+ * sweep values).
+ */
+void
+unpackResult(double *val, struct ccresult *ccr) {
+   ccr->year = (int) val[0];
+   ccr->month = (int) val[1];
+   ccr->day = (int) val[2];
+   ccr->hour = (int) val[3];
+   ccr->minute = (int) val[4];
+   ccr->sec = (int) val[5];
+   ccr->jdn = val[6];
+   ccr->ccindex = val[7];
+   ccr->totalarea = val[8];
+   ccr->totalpels = (int) val[9];
+   ccr->sweep = NULL;
 }
 
 /**
- * \brief Classify the image pixels in two different cathegories (sky and
- * cloud).
- *
- * Uses the R/B criteria for pixel classification. If the ratio R/B of
- * pixel is below the threshold the pixel is classified as sky, if is above
- * or equal the threshold, is classified as cloud pixel.
- * @param[in] thr is the threshold used to classify.
- * @param[out] img is the input image.
- * @param[in] wd is the image width.
- * @param[in] hg is the image height.
- * \return the new segmented image. Black opaque pixels = Sky. White opaque
- * pixels = Cloud.
- */
-unsigned int **filterRB(double thr, unsigned int **img, int wd, int hg) {
-   int i, j, pelcolor;
-   double ratio;
-   unsigned int **res = (unsigned int **) malloc(hg *
-                                                 sizeof(unsigned int *));
-   unsigned int *whole = (unsigned int *) malloc(hg * wd *
-                                                 sizeof(unsigned int));
-   for (i = 0; i < hg; i++)
-      res[i] = whole + i * wd;
-
-   for (i = 0; i < wd; i++) {
-      for (j = 0; j < hg; j++) {
-         pelcolor = img[i][j];
-         /*outside region, black and transparent */
-         if ((pelcolor & 0X00FFFFFF) == 0) {
-            res[i][j] =  0X00000000;
+ * \brief Calculates the Cloud Cover Index of a single image.
+ *
+ * Reads the EXIF data and the pixels of an image file, cuts it with the
+ * mask (already read), segments it and calculates the CCI. The trimmed and
+ * segmented images are written if their file names are given. With a
+ * result cache, an image already processed with the same parameters is
+ * not decoded unless those images are required, and the results of new
+ * images are stored.
+ * @param[in] fname is the input image file name.
+ * @param[in] trfile is the trimmed image file name (NULL if not required).
+ * @param[in] sgfile is the segmented image file name (NULL if not
+ * required).
+ * @param[out] ccr is the structure where the results are stored.
+ * \return 0 if success, otherwise the error code that must be returned to
+ * the OS.
+ */
+int
+processImage(char *fname, char *trfile, char *sgfile, struct ccresult *ccr) {
+   int               res, width, height;
+   unsigned char    *data;
+   size_t            size;
+   unsigned int    **imagecut;
+   SegImage         *imagecnv;
+   PlanarImage      *region;
+   JPGReader        *reader;
+   CCIResult         cci;
+   ImageInfo         imginfo;
+   CamAndShotInfo    phinfo;
+   struct phasetimes pt;
+   unsigned long     bytes = poolBytes(buffers);
+   CacheKey          key;
+   double            cval[NCACHEVALS];
+
+   ccr->sweep = NULL;
+   if (nsweep > 0) /* the sweep writes no images */
+      trfile = sgfile = NULL;
+   startImage();
+   startPhases(&pt);
+   /* the file is read once, the EXIF data and the pixels come from it */
+   data = checkFileForRead(fname) ? readFileData(buffers, fname, &size) :
+      NULL;
+   if (data == NULL) {
+      fprintf(stderr, ERR_INFIL);
+      endImage(FAIL_READ, &pt);
+      return 2;
+   }
+   if ((rcache != NULL) && (nsweep == 0)) {
+      makeCacheKey(&key, data, size, paramhash);
+      if ((trfile == NULL) && (sgfile == NULL) &&
+          cacheLookup(rcache, &key, cval, sizeof(cval))) {
+         unpackResult(cval, ccr);
+         giveBuffer(buffers, data);
+         fprintf(stderr, MSG_CACHE);
+         endPhase(&pt, PRF_READ);
+         if (profile) {
+            cci.classifytime = cci.votetime = cci.counttime = 0.0;
+            printProfile(fname, &pt, &cci, poolBytes(buffers) - bytes);
+         }
+         countCacheHit();
+         endImage(-1, &pt);
+         return 0;
+      }
+   }
+   endPhase(&pt, PRF_READ);
+   /* reading exif data from image file */
+   res = getImgInfoData(fname, data, size, cfgvals.azimuth, timezn,
+                        &imginfo, &phinfo);
+   if (res != 1) {
+      fprintf(stderr, ERR_IINFO);
+      giveBuffer(buffers, data);
+      endImage(FAIL_EXIF, &pt);
+      return 6;
+   }
+   ccr->year = imginfo.year;
+   ccr->month = imginfo.month;
+   ccr->day = imginfo.day;
+   ccr->hour = imginfo.UTChr;
+   ccr->minute = imginfo.UTCmin;
+   ccr->sec = imginfo.UTCsec;
+   ccr->jdn = julianDate(ccr->year, ccr->month, ccr->day,
+                         ccr->hour, ccr->minute, (double) ccr->sec);
+   freeImgInfo(&imginfo, &phinfo);
+   endPhase(&pt, PRF_EXIF);
+
+   /* the intermediate images are built only if they are written */
+   imagecut = (trfile != NULL) ?
+      newPooledImage(buffers, skymask.width, skymask.height) : NULL;
+   imagecnv = (sgfile != NULL) ?
+      newPooledSegImage(buffers, skymask.width, skymask.height) : NULL;
+
+   res = -1;
+   if ((streaming || (quicklook > 1)) && (nsweep == 0)) {
+      /* segmentation while the pixels are read */
+      reader = openMemJPGReader(data, size, quicklook, &width, &height);
+      if (reader != NULL) {
+         fprintf(stderr, MSG_CCI1);
+         res = segmentStream(reader, width, height, &skymask, &segpars,
+                             imagecut, imagecnv, &cci);
+         closeJPGReader(reader);
+      }
+      /* the rows are decoded while they are segmented */
+      endPhase(&pt, PRF_SEGMENT);
+   }
+   else {
+      /* reading the image pixels under the mask */
+      reader = openMemJPGReader(data, size, quicklook, &width, &height);
+      if (reader != NULL) {
+         region = readMaskRegion(reader, width, height, &skymask, buffers);
+         closeJPGReader(reader);
+         endPhase(&pt, PRF_DECODE);
+         if (region != NULL) {
+            fprintf(stderr, MSG_CCI1);
+            if (nsweep > 0)
+               res = sweepRegion(region, ccr, &cci);
+            else
+               res = segmentRegion(region, &skymask, &segpars, imagecut,
+                                   imagecnv, &cci);
+            freePlanarImage(region);
+            endPhase(&pt, PRF_SEGMENT);
          }
-         else { /* inside region */
-            /* take the red chanel value */
-            ratio = (double)((pelcolor & 0X00FF0000) >> 16);
-            /* divide by the blue chanel value */
-            ratio = ratio / (double)(pelcolor & 0X000000FF);
-            /* if ratio is below the threshold */
-            if (ratio < thr) {
-               /* black (but opaque) means sky */
-               res[i][j] =  0XFF000000;
-            }
-            else { /* ratio above or equal the threshold */
-               /* white and opaque means cloud */
-               res[i][j] = 0XFFFFFFFF;
-            }
-         } /* inside picture */
-      } /* for j */
-   } /* for i */
+      }
+   }
+   giveBuffer(buffers, data);
+   if (res != 1) { /* unreadable, smaller than the mask or no memory */
+      fprintf(stderr, ERR_RDIMG);
+      releaseImage(buffers, imagecut);
+      freeSegImage(imagecnv);
+      endImage(FAIL_DECODE, &pt);
+      return 8;
+   }
+   fprintf(stderr, MSG_CCI2);
+   ccr->ccindex = cci.ccindex;
+   ccr->totalarea = cci.totalarea;
+   ccr->totalpels = cci.totalpels;
+   if ((rcache != NULL) && (nsweep == 0)) {
+      packResult(ccr, cval);
+      cacheStore(rcache, &key, cval, sizeof(cval));
+   }
+
+   if (trfile != NULL) {
+      res = writeParallelPNGImage(imagecut, trfile, skymask.width,
+                                  skymask.height, threads);
+      if (res != 1)
+         fprintf(stderr, ERR_WTFIL);
+      else
+         fprintf(stderr, MSG_WTFIL);
+      releaseImage(buffers, imagecut);
+      endPhase(&pt, PRF_WRITECUT);
+   }
+   if (sgfile != NULL) {
+      res = writeParallelSegImage(imagecnv, sgfile, threads);
+      if (res != 1)
+         fprintf(stderr, ERR_WSFIL);
+      else
+         fprintf(stderr, MSG_WSFIL);
+      freeSegImage(imagecnv);
+      endPhase(&pt, PRF_WRITESEG);
+   }
+   if (profile)
+      printProfile(fname, &pt, &cci, poolBytes(buffers) - bytes);
+   endImage(-1, &pt);
+   return 0;
+}
+
+/**
+ * \brief Writes a result record.
+ *
+ * The record goes to the buffer of the results writer, which is written
+ * in the standard output when it is full or flushed. In text format the
+ * record is the classic line:
+ * Year Month Date Hour Min Sec JD Lat Lon Ele Azim RBThr NSide Conv CCI,
+ * with the CCI without vote added in sweep mode, and the scale (1/n) and
+ * the analyzed size (WxH) in quick-look mode. In CSV and JSON Lines
+ * formats it has the fields of recfield, the input file name first.
+ * @param[in] ccr is the structure with the results of the image.
+ * @param[in] fname is the input file name.
+ * @param[in] thr is the R/B treshold.
+ * @param[in] cci is the CCI for that treshold.
+ * @param[in] novote is the CCI without vote (only in sweep mode).
+ */
+void
+printRecord(struct ccresult *ccr, char *fname, double thr, double cci,
+            double novote) {
+   char              tmp[32];
+
+   if (outformat != FMT_TEXT)
+      putString(results, fname);
+   putInt(results, ccr->year);
+   putInt(results, ccr->month);
+   putInt(results, ccr->day);
+   putInt(results, ccr->hour);
+   putInt(results, ccr->minute);
+   putInt(results, ccr->sec);
+   putDouble(results, ccr->jdn);
+   putDouble(results, latitude);
+   putDouble(results, longitude);
+   putDouble(results, elevation);
+   putDouble(results, cfgvals.azimuth);
+   putDouble(results, thr);
+   putInt(results, cfgvals.neighbsize);
+   putInt(results, cfgvals.votes2flip);
+   putDouble(results, cci);
+   if (outformat != FMT_TEXT) {
+      putDouble(results, ccr->totalarea);
+      putInt(results, ccr->totalpels);
+      putInt(results, quicklook);
+      putInt(results, skymask.width);
+      putInt(results, skymask.height);
+      if (nsweep > 0)
+         putDouble(results, novote);
+   }
+   else {
+      if (nsweep > 0)
+         putDouble(results, novote);
+      if (quicklook > 1) {
+         sprintf(tmp, "1/%d", quicklook);
+         putString(results, tmp);
+         sprintf(tmp, "%dx%d", skymask.width, skymask.height);
+         putString(results, tmp);
+      }
+   }
+   endRecord(results);
+}
+
+/**
+ * \brief Writes the result records of an image.
+ *
+ * A record with the treshold of the configuration, or one for each
+ * treshold in sweep mode (see printRecord). The sweep results are
+ * released.
+ * @param[in] ccr is the structure with the results of the image.
+ * @param[in] fname is the input file name.
+ */
+void
+printResult(struct ccresult *ccr, char *fname) {
+   int               k;
+
+   if (ccr->sweep == NULL) {
+      printRecord(ccr, fname, cfgvals.rbtreshold, ccr->ccindex, 0.0);
+      return;
+   }
+   for (k = 0; k < nsweep; k++)
+      printRecord(ccr, fname, sweeptr[k], ccr->sweep[2 * k + 1],
+                  ccr->sweep[2 * k]);
+   free(ccr->sweep);
+   ccr->sweep = NULL;
+}
+
+/**
+ * \brief Processes the input image with a given index.
+ *
+ * Builds the names of output images (in batch mode they are files in the
+ * output directories) and processes the image.
+ * @param[in] i is the index of image in the inputs list.
+ * @param[out] ccr is the structure where the results are stored.
+ * \return 0 if success, the error code of processImage otherwise.
+ */
+int
+processInput(int i, struct ccresult *ccr) {
+   char              trname[MAXFNLEN], sgname[MAXFNLEN];
+   char             *trout = trfname, *sgout = sgfname;
+
+   if (batch) {
+      fprintf(stderr, "%s\n", inputs[i]);
+      if (trfname != NULL) {
+         outputName(trfname, inputs[i], "cut", trname);
+         trout = trname;
+      }
+      if (sgfname != NULL) {
+         outputName(sgfname, inputs[i], "seg", sgname);
+         sgout = sgname;
+      }
+   }
+   return processImage(inputs[i], trout, sgout, ccr);
+}
+
+/**
+ * \brief Worker of the image pool.
+ *
+ * Takes the next unprocessed image of the inputs list until the list is
+ * exhausted. The results are written as soon as all the previous images
+ * (in input order) have been written.
+ * @param[in] arg is the pool shared by all the workers.
+ * @param[in] id is the worker number (unused).
+ */
+void
+poolWorker(void *arg, int id) {
+   struct workpool  *wp = (struct workpool *) arg;
+   struct ccresult   ccr;
+   int               i, res;
+
+   for (;;) {
+      pthread_mutex_lock(&wp->lock);
+      i = wp->next++;
+      pthread_mutex_unlock(&wp->lock);
+      if (i >= ninputs)
+         break;
+      setQueued(ninputs - i - 1);
+      res = processInput(i, &ccr);
+
+      pthread_mutex_lock(&wp->lock);
+      wp->results[i] = ccr;
+      wp->status[i] = res;
+      wp->done[i] = TRUE;
+      /* write every result whose predecessors are already written */
+      while ((wp->nextout < ninputs) && wp->done[wp->nextout]) {
+         if (wp->status[wp->nextout] == 0)
+            printResult(&wp->results[wp->nextout], inputs[wp->nextout]);
+         else if (batch)
+            fprintf(stderr, "%s: image skipped\n", inputs[wp->nextout]);
+         wp->nextout++;
+      }
+      pthread_mutex_unlock(&wp->lock);
+   }
+}
+
+/**
+ * \brief Processes all the images in the inputs list.
+ *
+ * The images are processed by a pool of workers (as many as given with
+ * the -j option). The mask, configuration and geographic data are shared
+ * by all of them. The results are written in input order.
+ * \return 0 if all the images were processed, -1 if there is not enough
+ * memory for their results, otherwise the error code of the first image
+ * (in input order) that failed.
+ */
+int
+processInputs() {
+   struct workpool   wp;
+   int               i, status = 0;
+
+   if (ninputs == 0)
+      return 0;
+   pthread_mutex_init(&wp.lock, NULL);
+   wp.next = wp.nextout = 0;
+   wp.results = (struct ccresult *) malloc(ninputs * sizeof(struct ccresult));
+   wp.status = (int *) malloc(ninputs * sizeof(int));
+   wp.done = (char *) calloc(ninputs, sizeof(char));
+   if ((wp.results == NULL) || (wp.status == NULL) || (wp.done == NULL)) {
+      pthread_mutex_destroy(&wp.lock);
+      free(wp.results);
+      free(wp.status);
+      free(wp.done);
+      return -1;
+   }
+   runThreads((workers < ninputs) ? workers : ninputs, poolWorker, &wp);
+   for (i = 0; (i < ninputs) && !status; i++)
+      status = wp.status[i];
+   pthread_mutex_destroy(&wp.lock);
+   free(wp.results);
+   free(wp.status);
+   free(wp.done);
+   return status;
+}
+
+/**
+ * \brief Signal handler used to finish the daemon mode.
+ */
+static void
+stopWatching(int sig) {
+   stopreq = 1;
+}
+
+/**
+ * \brief Processes an image found in the spool directory.
+ *
+ * The image is processed and then moved to the done subdirectory of
+ * spool, or to the failed one if it cannot be processed. Hidden files
+ * and files without the JPEG extension are ignored.
+ * @param[in] name is the file name (without path) in the spool directory.
+ * \return 0 if the image was processed, -1 if ignored, the error code of
+ * processImage otherwise.
+ */
+int
+spoolImage(char *name) {
+   char              path[MAXFNLEN], dest[MAXFNLEN];
+   char              trname[MAXFNLEN], sgname[MAXFNLEN];
+   char             *trout = NULL, *sgout = NULL;
+   struct ccresult   ccr;
+   int               res;
+
+   if ((name[0] == '.') || !isJPEGName(name))
+      return -1;
+   snprintf(path, MAXFNLEN, "%s/%s", spooldir, name);
+   if (access(path, F_OK)) /* already moved */
+      return -1;
+   fprintf(stderr, "%s\n", path);
+   if (trfname != NULL) {
+      outputName(trfname, name, "cut", trname);
+      trout = trname;
+   }
+   if (sgfname != NULL) {
+      outputName(sgfname, name, "seg", sgname);
+      sgout = sgname;
+   }
+   res = processImage(path, trout, sgout, &ccr);
+   if (res == 0) {
+      printResult(&ccr, path);
+      flushRecords(results);
+   }
+   else
+      fprintf(stderr, "%s: image failed\n", path);
+   snprintf(dest, MAXFNLEN, "%s/%s/%s", spooldir,
+            (res == 0) ? SPLDONE : SPLFAIL, name);
+   if (rename(path, dest))
+      fprintf(stderr, ERR_SPMOV, path);
    return res;
 }
 
 /**
- * \brief Calculate the Cloud Cover Index.
- *
- * Performs the calculation of CCI (Cloud Cover Index) in the segmentes
- * image. A correction factor is used given that the lens used deforms
- * areas in diferent way according to the radial distance of pixel.
- *
- * @param[in] img is the image where the CCI will be calculated.
- * @param[in] w image width.
- * @param[in] h image height.
- * @param[out] ta is the total weighted area in the image interest
- * region (whole sky area).
- * @param[out] tp total number of pixels in the interest region.
- * \return a double value with the proportion of image covered by clouds,
- * according to the segmented image (white pixels proportion in the
- * interest region)
- */
-double cloudcoverindex(unsigned int **img, int w, int h, double *ta, int *tp) {
-   double total = 0.0, clouds = 0.0;
-   int    pels = 0;
-   double sqdist, rcenter, ccenter;
-   int i, j, pelcolor, idxc;
-   rcenter = (int) ((double) h / 2.0);
-   ccenter = (int) ((double) w / 2.0);
-
-   for (i = 0; i < h; i++) {
-      for (j = 0; j < w; j++) {
-         pelcolor = img[i][j];
-         if ((pelcolor == 0XFF000000) || (pelcolor == 0XFFFFFFFF)) {
-            sqdist = (i - rcenter) * (i - rcenter) +
-               (j - ccenter) * (j - ccenter);
-            idxc = catsearch(sqdist, categories, 0, NUMCAT - 1);
-            total += factors[idxc];
-            pels++;
-            if (pelcolor == 0XFFFFFFFF) {
-               clouds += factors[idxc];
-            }
-         }
+ * \brief Processes all the images currently in the spool directory.
+ *
+ * Used when the daemon starts, and when the notification queue
+ * overflows and some events were lost.
+ */
+void
+scanSpool() {
+   int               i, len = strlen(spooldir) + 1;
+
+   for (i = 0; i < ninputs; i++)
+      free(inputs[i]);
+   ninputs = 0;
+   if (!readInputDir(spooldir))
+      return;
+   for (i = 0; (i < ninputs) && !stopreq; i++) {
+      setQueued(ninputs - i - 1);
+      spoolImage(inputs[i] + len);
+   }
+   setQueued(0);
+}
+
+/**
+ * \brief Daemon mode. Watches the spool directory for new images.
+ *
+ * Every JPEG file written or moved into the spool directory is processed
+ * as soon as it is closed. The configuration, geographic data and mask
+ * remain in memory. The function returns when SIGINT or SIGTERM is
+ * received.
+ * \return 0 if success, otherwise the error code that must be returned to
+ * the OS.
+ */
+int
+watchSpool() {
+   union {
+      struct inotify_event ev;
+      char              buf[SPLBUFSZ];
+   }                 evbuf;
+   struct inotify_event *ev;
+   struct sigaction  sa;
+   char              subdir[MAXFNLEN];
+   int               fd, len, i;
+
+   snprintf(subdir, MAXFNLEN, "%s/%s", spooldir, SPLDONE);
+   mkdir(subdir, 0775);
+   if (!checkDirForWrite(subdir)) {
+      fprintf(stderr, ERR_SPOOL);
+      return 9;
+   }
+   snprintf(subdir, MAXFNLEN, "%s/%s", spooldir, SPLFAIL);
+   mkdir(subdir, 0775);
+   if (!checkDirForWrite(subdir)) {
+      fprintf(stderr, ERR_SPOOL);
+      return 9;
+   }
+   fd = inotify_init();
+   if ((fd == -1) ||
+       (inotify_add_watch(fd, spooldir, IN_CLOSE_WRITE | IN_MOVED_TO) == -1)) {
+      fprintf(stderr, ERR_SPOOL);
+      return 9;
+   }
+   /* no SA_RESTART: a signal must interrupt the read */
+   memset(&sa, 0, sizeof(sa));
+   sa.sa_handler = stopWatching;
+   sigemptyset(&sa.sa_mask);
+   sigaction(SIGINT, &sa, NULL);
+   sigaction(SIGTERM, &sa, NULL);
+
+   scanSpool();
+   while (!stopreq) {
+      len = read(fd, evbuf.buf, SPLBUFSZ);
+      if (len <= 0) {
+         if ((len == -1) && (errno == EINTR))
+            continue;
+         break;
+      }
+      for (i = 0; (i < len) && !stopreq;
+           i += sizeof(struct inotify_event) + ev->len) {
+         ev = (struct inotify_event *) (evbuf.buf + i);
+         if (ev->mask & IN_Q_OVERFLOW)
+            scanSpool();
+         else if ((ev->len > 0) && !(ev->mask & IN_ISDIR))
+            spoolImage(ev->name);
       }
    }
-   *ta = total;
-   *tp = pels;
-   return clouds / total;
+   close(fd);
+   return 0;
 }
 
 /**
@@ -684,7 +1852,47 @@ double cloudcoverindex(unsigned int **img, int w, int h, double *ta, int *tp) {
  * -c <configuration file>
  * -s <segmented image file> (optional)
  * -t <trimmed image file> (optional)
- * -input image file
+ * -l <list file> (optional)
+ * -d <input directory> (optional)
+ * -w <spool directory> (optional)
+ * -j <number of workers> (optional)
+ * -p <number of threads per image> (optional)
+ * -m (streaming mode) (optional)
+ * -q <quick-look scale> (optional)
+ * --profile (optional)
+ * --metrics <metrics file> (optional)
+ * --format <output format> (optional)
+ * --cache <result cache file> (optional)
+ * --sweep <tresholds> (optional)
+ * -input image file(s)
+ *
+ * In batch mode (several input images, a list file or an input directory)
+ * the configuration, the geographic information and the mask are read only
+ * once, the -t and -s options are directories, and one line is written for
+ * each input image, in the same order. With -j the images are processed
+ * concurrently by a pool of workers. With -p the segmentation and CCI
+ * calculation of each image are divided among several threads, and so is
+ * the compression of the trimmed and segmented images. With -m
+ * the rows of each image are processed as soon as they are decoded, so
+ * only a few rows are stored instead of the whole image. With -q the
+ * images are decoded at a reduced scale, a quick-look approximation of
+ * the CCI, which is written together with the scale and the analyzed size.
+ * In daemon mode (-w) the spool directory is watched and the images are
+ * processed as soon as they arrive, then moved to done/ or failed/. With
+ * --profile a line with the time of each phase, the allocated bytes and
+ * the peak memory is written in the standard error for each image (see
+ * printProfile). With --metrics the counters of images processed and
+ * failed, the queue depth, the latency histograms of the phases and the
+ * use of the buffer pool are written in the Prometheus text format to a
+ * file, rewritten every METRICSPERIOD seconds and at the end (see
+ * writeMetrics). With --format csv or jsonl the results are written as
+ * CSV records (after a header line) or JSON objects, which include the
+ * input file name, the total weighted area and the number of pixels
+ * analyzed (see printResult). With --cache the results are kept in a file
+ * addressed by a hash of the image bytes and of the parameters, so an
+ * image submitted again is not decoded (see openCache). With --sweep the
+ * CCI is calculated for a list of tresholds instead of the one of the
+ * configuration, decoding each image only once (see sweepRegion).
  *
  * The output is: the segmented and trimmed images (if requested), and the
  * following 15 data values in a text line:
@@ -708,21 +1916,29 @@ double cloudcoverindex(unsigned int **img, int w, int h, double *ta, int *tp) {
  */
 int
 main(int argc, char *argv[]) {
-   int               res;
-   double            totalarea;
-   int               totalpels;
+   int               res, status;
+   SkyMask           qlmask;
+   double            wall0, cpu0;
+   pthread_t         writer;
 
    setDefaults();
+   initMetrics();
    /*
       Process command line */
    if (argc < 2)
       usage(argv[0], ERR_NARGS, 1);
    /* catch all the command line input parameters */
-   catchParams(argc, argv, &infname, &cffname, &trfname, &sgfname);
+   catchParams(argc, argv, &cffname, &trfname, &sgfname);
+   wall0 = wallClock();
+   cpu0 = cpuClock();
    /*  Get the configuration params from xml file */
    res = getConfig(cffname, &cfgvals);
    if (res)
       diagnostic(res);
+   segpars.rbtreshold = cfgvals.rbtreshold;
+   segpars.neighbsize = cfgvals.neighbsize;
+   segpars.votes2flip = cfgvals.votes2flip;
+   compileClassifier(&segpars);
 #ifdef DEBUG
    freopen("CloudCover.log", "w", stderr);
    logParams();
@@ -737,55 +1953,70 @@ main(int argc, char *argv[]) {
    longitude = locinfo.longitude;
    elevation = locinfo.elevation;
 
-   /* reading exif data from image file */
-   res = getImgInfo(infname, cfgvals.azimuth, timezn, &imginfo, &phinfo);
-   if (res != 1) {
-      fprintf(stderr, ERR_IINFO);
-      exit(6);
+   /* reading the mask, shared by all the input images */
+   if (!loadSkyMask(cfgvals.msfname, threads, &skymask)) {
+      fprintf(stderr, ERR_MSKFL);
+      exit(7);
    }
-   year = imginfo.year;
-   month = imginfo.month;
-   day = imginfo.day;
-   hour = imginfo.UTChr;
-   minute = imginfo.UTCmin;
-   sec = imginfo.UTCsec;
-   jdn = julianDate(year, month, day, hour, minute, (double) sec);
-
-   /* reading and trimming image file */
-   image  = readAndCut(infname, cfgvals.msfname, &width, &height);
-
-   if (trfname != NULL) {
-      res = writePNGImage(image, trfname, width, height);
-      if (res != 1)
-         fprintf(stderr, ERR_WTFIL);
-      else
-         fprintf(stderr, MSG_WTFIL);
+   if (quicklook > 1) { /* the mask of the reduced images */
+      res = scaleSkyMask(&skymask, quicklook, &qlmask);
+      freeSkyMask(&skymask);
+      if (!res) {
+         fprintf(stderr, ERR_MSKFL);
+         exit(7);
+      }
+      skymask = qlmask;
    }
-   imageseg = filterRB(cfgvals.rbtreshold, image, width, height);
-   imagecnv = convolution(cfgvals.neighbsize, cfgvals.votes2flip,
-                          imageseg, width, height);
-   if (sgfname != NULL) {
-      res = writePNGImage(imagecnv, sgfname, width, height);
-      if (res != 1)
-         fprintf(stderr, ERR_WSFIL);
-      else
-         fprintf(stderr, MSG_WSFIL);
+   if (chfname != NULL)
+      openCache();
+   cfgwall = wallClock() - wall0;
+   cfgcpu = cpuClock() - cpu0;
+   /* a set of buffers for each worker (plain allocations if NULL) */
+   buffers = newBufPool(BUFSPERIMG * workers);
+   results = newRecordWriter(stdout, outformat, recfield,
+                             (nsweep > 0) ? NRECFIELDS + 1 : NRECFIELDS);
+   if (results == NULL) {
+      fprintf(stderr, ERR_OUTPT);
+      exit(2);
+   }
+   if (mtfname != NULL) {
+      setQueued(ninputs);
+      if (!writeMetricsFile(mtfname, writeMetrics, NULL)) {
+         fprintf(stderr, ERR_MTFIL);
+         exit(2);
+      }
+      if (pthread_create(&writer, NULL, metricsWriter, NULL)) {
+         free(mtfname);
+         mtfname = NULL;
+      }
    }
-   fprintf(stderr, MSG_CCI1);
-   ccindex = cloudcoverindex(imagecnv, width, height, &totalarea, &totalpels);
-   fprintf(stderr, MSG_CCI2);
-
-   /*
-Year, Month, Date, Hour, Min, Sec, JD,
-%d %d %d %d %d %f %f %f %f %f %f %f %d %d %f\n
-Lat, Lon, Ele, Azim,
-
-RBThr, NSide, Conv, CCI.
-   */
-   printf("%d %d %d %d %d %d %f %f %f %f %f %f %d %d %f\n",
-          year, month, day, hour, minute, sec, jdn,
-          latitude, longitude, elevation, cfgvals.azimuth,
-          cfgvals.rbtreshold, cfgvals.neighbsize, cfgvals.votes2flip, ccindex);
 
-   return 0;
+   status = processInputs();
+   if (status < 0) {
+      fprintf(stderr, ERR_NOMEM);
+      stopMetrics(writer);
+      freeRecordWriter(results);
+      exit(2);
+   }
+   if (status && !batch) {
+      stopMetrics(writer);
+      freeRecordWriter(results);
+      exit(status);
+   }
+   if (spooldir != NULL) {
+      flushRecords(results);
+      res = watchSpool();
+      if (res)
+         status = res;
+   }
+   stopMetrics(writer);
+   if (!freeRecordWriter(results)) {
+      fprintf(stderr, ERR_OUTPT);
+      if (!status)
+         status = 2;
+   }
+   closeResultCache(rcache);
+   freeSkyMask(&skymask);
+   freeBufPool(buffers);
+   return status;
 } /* cloudcover.c ends here */
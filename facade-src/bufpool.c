@@ -0,0 +1,256 @@
+/**
+ * @file bufpool.c
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 16:40
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * @section DESCRIPTION
+ * Pool of reusable memory buffers, see bufpool.h.
+ */
+#define _POSIX_C_SOURCE 200112L
+#include<stdlib.h>
+#include<pthread.h>
+#include"bufpool.h"
+
+/*
+ * A buffer kept by the pool
+ */
+typedef struct {
+    void           *buf;
+    size_t          size;
+    int             busy;
+} bufslot;
+
+/**
+ * Pool of reusable buffers: the buffers kept and a lock, so several
+ * threads can share it.
+ */
+struct bufpool {
+    /** lock of the slots */
+    pthread_mutex_t lock;
+    /** buffers kept */
+    bufslot        *slot;
+    /** number of buffers kept */
+    int             nbufs;
+    /** maximum number of buffers kept */
+    int             maxbufs;
+    /** number of allocations */
+    long            allocs;
+    /** bytes allocated */
+    unsigned long   bytes;
+};
+
+/*
+ * Size class of a request: the smallest m 2^e not below size, with m in
+ * 4, ..., 8 (four classes per power of two, at most 25% more bytes).
+ * Every buffer of a class can serve any request of it, so a small
+ * request never takes a large buffer that another thread will need.
+ */
+static size_t
+classSize(size_t size)
+{
+    size_t          s = size - 1;
+    int             e = 0;
+
+    while ((s >> e) >= 8)
+        e++;
+    return ((s >> e) + 1) << e;
+}
+
+/**
+ * \brief Creates an empty pool.
+ */
+BufPool        *
+newBufPool(int maxbufs)
+{
+    BufPool        *bp = (BufPool *) malloc(sizeof(BufPool));
+
+    if (bp == NULL)
+        return NULL;
+    bp->slot = (bufslot *) malloc((maxbufs > 0 ? maxbufs : 1) *
+                                  sizeof(bufslot));
+    if (bp->slot == NULL) {
+        free(bp);
+        return NULL;
+    }
+    pthread_mutex_init(&bp->lock, NULL);
+    bp->nbufs = 0;
+    bp->maxbufs = maxbufs;
+    bp->allocs = 0;
+    bp->bytes = 0;
+    return bp;
+}
+
+/**
+ * \brief Takes a buffer from a pool.
+ */
+void           *
+takeBuffer(BufPool * bp, size_t size)
+{
+    void           *buf;
+    int             k, best = -1, spare = -1;
+
+    if (size == 0)
+        size = 1;
+    if (bp == NULL)
+        return malloc(size);
+    size = classSize(size);
+    pthread_mutex_lock(&bp->lock);
+    /*
+     * a free buffer of the same class
+     */
+    for (k = 0; (k < bp->nbufs) && (best < 0); k++) {
+        if (bp->slot[k].busy)
+            continue;
+        if (bp->slot[k].size == size)
+            best = k;
+        else if (bp->slot[k].size < size)
+            spare = k;
+    }
+    if (best >= 0) {
+        bp->slot[best].busy = 1;
+        buf = bp->slot[best].buf;
+        pthread_mutex_unlock(&bp->lock);
+        return buf;
+    }
+    bp->allocs++;
+    bp->bytes += size;
+    buf = malloc(size);
+    if (buf != NULL) {
+        /*
+         * a new slot, or a free buffer too small is replaced
+         */
+        k = -1;
+        if (bp->nbufs < bp->maxbufs)
+            k = bp->nbufs++;
+        else if (spare >= 0) {
+            k = spare;
+            free(bp->slot[k].buf);
+        }
+        if (k >= 0) {
+            bp->slot[k].buf = buf;
+            bp->slot[k].size = size;
+            bp->slot[k].busy = 1;
+        }
+    }
+    pthread_mutex_unlock(&bp->lock);
+    return buf;
+}
+
+/**
+ * \brief Gives a buffer back to a pool.
+ */
+void
+giveBuffer(BufPool * bp, void *buf)
+{
+    int             k;
+
+    if (buf == NULL)
+        return;
+    if (bp == NULL) {
+        free(buf);
+        return;
+    }
+    pthread_mutex_lock(&bp->lock);
+    for (k = 0; (k < bp->nbufs) && (bp->slot[k].buf != buf); k++);
+    if (k < bp->nbufs)
+        bp->slot[k].busy = 0;
+    else
+        free(buf);
+    pthread_mutex_unlock(&bp->lock);
+}
+
+/**
+ * \brief Number of buffers allocated by a pool.
+ */
+long
+poolAllocations(BufPool * bp)
+{
+    long            n;
+
+    if (bp == NULL)
+        return 0;
+    pthread_mutex_lock(&bp->lock);
+    n = bp->allocs;
+    pthread_mutex_unlock(&bp->lock);
+    return n;
+}
+
+/**
+ * \brief Number of bytes allocated by a pool.
+ */
+unsigned long
+poolBytes(BufPool * bp)
+{
+    unsigned long   n;
+
+    if (bp == NULL)
+        return 0;
+    pthread_mutex_lock(&bp->lock);
+    n = bp->bytes;
+    pthread_mutex_unlock(&bp->lock);
+    return n;
+}
+
+/**
+ * \brief Buffers currently kept by a pool.
+ */
+void
+poolUsage(BufPool * bp, int *kept, int *busy, unsigned long *bytes)
+{
+    int             k;
+
+    *kept = *busy = 0;
+    *bytes = 0;
+    if (bp == NULL)
+        return;
+    pthread_mutex_lock(&bp->lock);
+    *kept = bp->nbufs;
+    for (k = 0; k < bp->nbufs; k++) {
+        *busy += bp->slot[k].busy;
+        *bytes += bp->slot[k].size;
+    }
+    pthread_mutex_unlock(&bp->lock);
+}
+
+/**
+ * \brief Releases a pool and all its buffers.
+ */
+void
+freeBufPool(BufPool * bp)
+{
+    int             k;
+
+    if (bp == NULL)
+        return;
+    for (k = 0; k < bp->nbufs; k++)
+        free(bp->slot[k].buf);
+    pthread_mutex_destroy(&bp->lock);
+    free(bp->slot);
+    free(bp);
+}
+
+/*
+ * bufpool.c ends here
+ */
@@ -0,0 +1,550 @@
+/**
+ * @file classify.c
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 15:10
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * @section DESCRIPTION
+ * Pixel classification kernels. Cuts rows of a sky picture with a mask
+ * and classifies their pixels as outside, sky or cloud with the integer
+ * R/B test of the compiled classifier. Every kernel has a portable
+ * scalar version and SSE4.1, AVX2 and AVX-512 versions; the widest one
+ * supported by the processor is chosen at run time, and all of them give
+ * the same results.
+ */
+#include<stdlib.h>
+#include"classify.h"
+
+/*
+ * The vector kernels are compiled for x86 with GCC (5 or newer) or
+ * clang, each function with its own target, so the program runs in any
+ * x86 processor and only calls the kernels the processor supports.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ >= 5)))
+#define CLSX86
+#include<immintrin.h>
+#define TARGET(isa) __attribute__ ((target(isa)))
+#endif
+
+/*
+ * Class of the trimmed pixel p: outside if black, otherwise sky if
+ * R * den < num * B, cloud in other case
+ */
+#define PELCLASS(p, num, den) \
+    ((((p) & 0X00FFFFFF) != 0) * \
+     (CLSCLD - ((int) (((p) >> 16) & 0XFF) * (den) < \
+                (num) * (int) ((p) & 0XFF))))
+
+/*
+ * Functions of a kernel set
+ */
+typedef void    (*CutFunc) (const unsigned int *, const unsigned int *, int,
+                            unsigned int *);
+typedef void    (*ARGBFunc) (const unsigned int *, const unsigned int *,
+                             int, int, int, unsigned char *,
+                             unsigned int *);
+typedef void    (*PlanarFunc) (const unsigned int *, const unsigned char *,
+                               const unsigned char *, const unsigned char *,
+                               int, int, int, unsigned char *,
+                               unsigned int *);
+
+typedef struct {
+    const char     *name;
+    CutFunc         cut;
+    ARGBFunc        argb;
+    PlanarFunc      planar;
+} kernelset;
+
+/*
+ * Portable kernels, also used for the last pixels of the vector ones
+ */
+static void
+cutScalar(const unsigned int *msk, const unsigned int *img, int n,
+          unsigned int *cut)
+{
+    int             j;
+
+    for (j = 0; j < n; j++)
+        cut[j] = msk[j] & img[j];
+}
+
+static void
+argbScalar(const unsigned int *msk, const unsigned int *img, int n,
+           int num, int den, unsigned char *cls, unsigned int *cut)
+{
+    unsigned int    p;
+    int             j;
+
+    for (j = 0; j < n; j++) {
+        p = msk[j] & img[j];
+        if (cut != NULL)
+            cut[j] = p;
+        cls[j] = PELCLASS(p, num, den);
+    }
+}
+
+static void
+planarScalar(const unsigned int *msk, const unsigned char *red,
+             const unsigned char *green, const unsigned char *blue, int n,
+             int num, int den, unsigned char *cls, unsigned int *cut)
+{
+    unsigned int    p;
+    int             j;
+
+    for (j = 0; j < n; j++) {
+        p = msk[j] & (0XFF000000 | ((unsigned int) red[j] << 16) |
+                      ((unsigned int) green[j] << 8) | blue[j]);
+        if (cut != NULL)
+            cut[j] = p;
+        cls[j] = PELCLASS(p, num, den);
+    }
+}
+
+#ifdef CLSX86
+/*
+ * SSE4.1 kernels, 16 pixels per iteration in 4 vectors
+ */
+static          TARGET("sse4.1") __m128i
+classSSE41(__m128i p, __m128i num, __m128i den)
+{
+    __m128i         ff = _mm_set1_epi32(0XFF);
+    __m128i         r = _mm_and_si128(_mm_srli_epi32(p, 16), ff);
+    __m128i         b = _mm_and_si128(p, ff);
+    __m128i         sky, out;
+
+    /*
+     * sky is -1 (true) or 0, so CLSCLD + sky is the class inside
+     */
+    sky = _mm_cmplt_epi32(_mm_mullo_epi32(r, den), _mm_mullo_epi32(b, num));
+    out = _mm_cmpeq_epi32(_mm_and_si128(p, _mm_set1_epi32(0X00FFFFFF)),
+                          _mm_setzero_si128());
+    return _mm_andnot_si128(out, _mm_add_epi32(_mm_set1_epi32(CLSCLD), sky));
+}
+
+static          TARGET("sse4.1") void
+cutSSE41(const unsigned int *msk, const unsigned int *img, int n,
+         unsigned int *cut)
+{
+    int             j;
+
+    for (j = 0; j + 4 <= n; j += 4)
+        _mm_storeu_si128((__m128i *) (cut + j),
+                         _mm_and_si128(_mm_loadu_si128((__m128i *) (msk + j)),
+                                       _mm_loadu_si128((__m128i *) (img + j))));
+    cutScalar(msk + j, img + j, n - j, cut + j);
+}
+
+static          TARGET("sse4.1") void
+argbSSE41(const unsigned int *msk, const unsigned int *img, int n,
+          int num, int den, unsigned char *cls, unsigned int *cut)
+{
+    __m128i         vnum = _mm_set1_epi32(num), vden = _mm_set1_epi32(den);
+    __m128i         p, c[4];
+    int             j, k;
+
+    for (j = 0; j + 16 <= n; j += 16) {
+        for (k = 0; k < 4; k++) {
+            p = _mm_and_si128(_mm_loadu_si128((__m128i *) (msk + j + 4 * k)),
+                              _mm_loadu_si128((__m128i *) (img + j + 4 * k)));
+            if (cut != NULL)
+                _mm_storeu_si128((__m128i *) (cut + j + 4 * k), p);
+            c[k] = classSSE41(p, vnum, vden);
+        }
+        _mm_storeu_si128((__m128i *) (cls + j),
+                         _mm_packus_epi16(_mm_packus_epi32(c[0], c[1]),
+                                          _mm_packus_epi32(c[2], c[3])));
+    }
+    argbScalar(msk + j, img + j, n - j, num, den, cls + j,
+               (cut != NULL) ? cut + j : NULL);
+}
+
+static          TARGET("sse4.1") void
+planarSSE41(const unsigned int *msk, const unsigned char *red,
+            const unsigned char *green, const unsigned char *blue, int n,
+            int num, int den, unsigned char *cls, unsigned int *cut)
+{
+    __m128i         vnum = _mm_set1_epi32(num), vden = _mm_set1_epi32(den);
+    __m128i         alpha = _mm_set1_epi32(0XFF000000);
+    __m128i         r, g, b, p, c[4];
+    int             j, k;
+
+    for (j = 0; j + 16 <= n; j += 16) {
+        r = _mm_loadu_si128((__m128i *) (red + j));
+        g = _mm_loadu_si128((__m128i *) (green + j));
+        b = _mm_loadu_si128((__m128i *) (blue + j));
+        for (k = 0; k < 4; k++) {
+            /*
+             * the next 4 pixels of each plane, in 32 bits
+             */
+            p = _mm_or_si128(_mm_or_si128(alpha,
+                                          _mm_slli_epi32(_mm_cvtepu8_epi32(r),
+                                                         16)),
+                             _mm_or_si128(_mm_slli_epi32(_mm_cvtepu8_epi32(g),
+                                                         8),
+                                          _mm_cvtepu8_epi32(b)));
+            p = _mm_and_si128(p,
+                              _mm_loadu_si128((__m128i *) (msk + j + 4 * k)));
+            if (cut != NULL)
+                _mm_storeu_si128((__m128i *) (cut + j + 4 * k), p);
+            c[k] = classSSE41(p, vnum, vden);
+            r = _mm_srli_si128(r, 4);
+            g = _mm_srli_si128(g, 4);
+            b = _mm_srli_si128(b, 4);
+        }
+        _mm_storeu_si128((__m128i *) (cls + j),
+                         _mm_packus_epi16(_mm_packus_epi32(c[0], c[1]),
+                                          _mm_packus_epi32(c[2], c[3])));
+    }
+    planarScalar(msk + j, red + j, green + j, blue + j, n - j, num, den,
+                 cls + j, (cut != NULL) ? cut + j : NULL);
+}
+
+/*
+ * AVX2 kernels, 16 pixels per iteration in 2 vectors
+ */
+static          TARGET("avx2") __m256i
+classAVX2(__m256i p, __m256i num, __m256i den)
+{
+    __m256i         ff = _mm256_set1_epi32(0XFF);
+    __m256i         r = _mm256_and_si256(_mm256_srli_epi32(p, 16), ff);
+    __m256i         b = _mm256_and_si256(p, ff);
+    __m256i         sky, out;
+
+    sky = _mm256_cmpgt_epi32(_mm256_mullo_epi32(b, num),
+                             _mm256_mullo_epi32(r, den));
+    out = _mm256_cmpeq_epi32(_mm256_and_si256(p,
+                                              _mm256_set1_epi32(0X00FFFFFF)),
+                             _mm256_setzero_si256());
+    return _mm256_andnot_si256(out, _mm256_add_epi32(_mm256_set1_epi32(CLSCLD),
+                                                     sky));
+}
+
+/*
+ * Packs the classes of 16 pixels in 16 bytes, in order
+ */
+static          TARGET("avx2") __m128i
+packAVX2(__m256i c0, __m256i c1)
+{
+    __m256i         c = _mm256_permute4x64_epi64(_mm256_packus_epi32(c0, c1),
+                                                 0XD8);
+
+    return _mm_packus_epi16(_mm256_castsi256_si128(c),
+                            _mm256_extracti128_si256(c, 1));
+}
+
+static          TARGET("avx2") void
+cutAVX2(const unsigned int *msk, const unsigned int *img, int n,
+        unsigned int *cut)
+{
+    int             j;
+
+    for (j = 0; j + 8 <= n; j += 8)
+        _mm256_storeu_si256((__m256i *) (cut + j),
+                            _mm256_and_si256(_mm256_loadu_si256((__m256i *)
+                                                                (msk + j)),
+                                             _mm256_loadu_si256((__m256i *)
+                                                                (img + j))));
+    cutScalar(msk + j, img + j, n - j, cut + j);
+}
+
+static          TARGET("avx2") void
+argbAVX2(const unsigned int *msk, const unsigned int *img, int n,
+         int num, int den, unsigned char *cls, unsigned int *cut)
+{
+    __m256i         vnum = _mm256_set1_epi32(num);
+    __m256i         vden = _mm256_set1_epi32(den);
+    __m256i         p0, p1;
+    int             j;
+
+    for (j = 0; j + 16 <= n; j += 16) {
+        p0 = _mm256_and_si256(_mm256_loadu_si256((__m256i *) (msk + j)),
+                              _mm256_loadu_si256((__m256i *) (img + j)));
+        p1 = _mm256_and_si256(_mm256_loadu_si256((__m256i *) (msk + j + 8)),
+                              _mm256_loadu_si256((__m256i *) (img + j + 8)));
+        if (cut != NULL) {
+            _mm256_storeu_si256((__m256i *) (cut + j), p0);
+            _mm256_storeu_si256((__m256i *) (cut + j + 8), p1);
+        }
+        _mm_storeu_si128((__m128i *) (cls + j),
+                         packAVX2(classAVX2(p0, vnum, vden),
+                                  classAVX2(p1, vnum, vden)));
+    }
+    argbScalar(msk + j, img + j, n - j, num, den, cls + j,
+               (cut != NULL) ? cut + j : NULL);
+}
+
+/*
+ * Trimmed ARGB pixels from 8 bytes of each plane
+ */
+static          TARGET("avx2") __m256i
+pelsAVX2(const unsigned int *msk, __m128i r, __m128i g, __m128i b)
+{
+    __m256i         p;
+
+    p = _mm256_or_si256(_mm256_slli_epi32(_mm256_cvtepu8_epi32(r), 16),
+                        _mm256_slli_epi32(_mm256_cvtepu8_epi32(g), 8));
+    p = _mm256_or_si256(_mm256_or_si256(p, _mm256_cvtepu8_epi32(b)),
+                        _mm256_set1_epi32(0XFF000000));
+    return _mm256_and_si256(p, _mm256_loadu_si256((__m256i *) msk));
+}
+
+static          TARGET("avx2") void
+planarAVX2(const unsigned int *msk, const unsigned char *red,
+           const unsigned char *green, const unsigned char *blue, int n,
+           int num, int den, unsigned char *cls, unsigned int *cut)
+{
+    __m256i         vnum = _mm256_set1_epi32(num);
+    __m256i         vden = _mm256_set1_epi32(den);
+    __m256i         p0, p1;
+    __m128i         r, g, b;
+    int             j;
+
+    for (j = 0; j + 16 <= n; j += 16) {
+        r = _mm_loadu_si128((__m128i *) (red + j));
+        g = _mm_loadu_si128((__m128i *) (green + j));
+        b = _mm_loadu_si128((__m128i *) (blue + j));
+        p0 = pelsAVX2(msk + j, r, g, b);
+        p1 = pelsAVX2(msk + j + 8, _mm_srli_si128(r, 8),
+                      _mm_srli_si128(g, 8), _mm_srli_si128(b, 8));
+        if (cut != NULL) {
+            _mm256_storeu_si256((__m256i *) (cut + j), p0);
+            _mm256_storeu_si256((__m256i *) (cut + j + 8), p1);
+        }
+        _mm_storeu_si128((__m128i *) (cls + j),
+                         packAVX2(classAVX2(p0, vnum, vden),
+                                  classAVX2(p1, vnum, vden)));
+    }
+    planarScalar(msk + j, red + j, green + j, blue + j, n - j, num, den,
+                 cls + j, (cut != NULL) ? cut + j : NULL);
+}
+
+/*
+ * AVX-512 kernels, 16 pixels per iteration in 1 vector
+ */
+static          TARGET("avx512f") __m128i
+classAVX512(__m512i p, __m512i num, __m512i den)
+{
+    __m512i         ff = _mm512_set1_epi32(0XFF);
+    __m512i         r = _mm512_and_si512(_mm512_srli_epi32(p, 16), ff);
+    __m512i         b = _mm512_and_si512(p, ff);
+    __mmask16       sky, in;
+    __m512i         c;
+
+    sky = _mm512_cmplt_epi32_mask(_mm512_mullo_epi32(r, den),
+                                  _mm512_mullo_epi32(b, num));
+    in = _mm512_test_epi32_mask(p, _mm512_set1_epi32(0X00FFFFFF));
+    c = _mm512_mask_blend_epi32(sky, _mm512_set1_epi32(CLSCLD),
+                                _mm512_set1_epi32(CLSSKY));
+    return _mm512_cvtepi32_epi8(_mm512_maskz_mov_epi32(in, c));
+}
+
+static          TARGET("avx512f") void
+cutAVX512(const unsigned int *msk, const unsigned int *img, int n,
+          unsigned int *cut)
+{
+    int             j;
+
+    for (j = 0; j + 16 <= n; j += 16)
+        _mm512_storeu_si512((void *) (cut + j),
+                            _mm512_and_si512(_mm512_loadu_si512((void *)
+                                                                (msk + j)),
+                                             _mm512_loadu_si512((void *)
+                                                                (img + j))));
+    cutScalar(msk + j, img + j, n - j, cut + j);
+}
+
+static          TARGET("avx512f") void
+argbAVX512(const unsigned int *msk, const unsigned int *img, int n,
+           int num, int den, unsigned char *cls, unsigned int *cut)
+{
+    __m512i         vnum = _mm512_set1_epi32(num);
+    __m512i         vden = _mm512_set1_epi32(den);
+    __m512i         p;
+    int             j;
+
+    for (j = 0; j + 16 <= n; j += 16) {
+        p = _mm512_and_si512(_mm512_loadu_si512((void *) (msk + j)),
+                             _mm512_loadu_si512((void *) (img + j)));
+        if (cut != NULL)
+            _mm512_storeu_si512((void *) (cut + j), p);
+        _mm_storeu_si128((__m128i *) (cls + j), classAVX512(p, vnum, vden));
+    }
+    argbScalar(msk + j, img + j, n - j, num, den, cls + j,
+               (cut != NULL) ? cut + j : NULL);
+}
+
+static          TARGET("avx512f") void
+planarAVX512(const unsigned int *msk, const unsigned char *red,
+             const unsigned char *green, const unsigned char *blue, int n,
+             int num, int den, unsigned char *cls, unsigned int *cut)
+{
+    __m512i         vnum = _mm512_set1_epi32(num);
+    __m512i         vden = _mm512_set1_epi32(den);
+    __m512i         p;
+    int             j;
+
+    for (j = 0; j + 16 <= n; j += 16) {
+        p = _mm512_or_si512(_mm512_slli_epi32(_mm512_cvtepu8_epi32
+                                              (_mm_loadu_si128((__m128i *)
+                                                               (red + j))),
+                                              16),
+                            _mm512_slli_epi32(_mm512_cvtepu8_epi32
+                                              (_mm_loadu_si128((__m128i *)
+                                                               (green + j))),
+                                              8));
+        p = _mm512_or_si512(p, _mm512_cvtepu8_epi32(_mm_loadu_si128
+                                                    ((__m128i *) (blue + j))));
+        p = _mm512_and_si512(_mm512_or_si512(p,
+                                             _mm512_set1_epi32(0XFF000000)),
+                             _mm512_loadu_si512((void *) (msk + j)));
+        if (cut != NULL)
+            _mm512_storeu_si512((void *) (cut + j), p);
+        _mm_storeu_si128((__m128i *) (cls + j), classAVX512(p, vnum, vden));
+    }
+    planarScalar(msk + j, red + j, green + j, blue + j, n - j, num, den,
+                 cls + j, (cut != NULL) ? cut + j : NULL);
+}
+#endif
+
+/*
+ * Available kernel sets, in the order of enum CLSKERNEL
+ */
+static const kernelset kernels[NUMKERNELS] = {
+    {"scalar", cutScalar, argbScalar, planarScalar},
+#ifdef CLSX86
+    {"sse4.1", cutSSE41, argbSSE41, planarSSE41},
+    {"avx2", cutAVX2, argbAVX2, planarAVX2},
+    {"avx512", cutAVX512, argbAVX512, planarAVX512}
+#else
+    {"sse4.1", NULL, NULL, NULL},
+    {"avx2", NULL, NULL, NULL},
+    {"avx512", NULL, NULL, NULL}
+#endif
+};
+
+/*
+ * Kernel set in use, NULL until the first selection
+ */
+static const kernelset *current = NULL;
+
+/*
+ * 1 if the processor (and the operating system) supports the kernel set
+ */
+static int
+supported(int kernel)
+{
+#ifdef CLSX86
+    __builtin_cpu_init();
+    switch (kernel) {
+    case KERNSSE41:
+        return __builtin_cpu_supports("sse4.1") != 0;
+    case KERNAVX2:
+        return __builtin_cpu_supports("avx2") != 0;
+    case KERNAVX512:
+        return __builtin_cpu_supports("avx512f") != 0;
+    }
+#endif
+    return kernel == KERNSCALAR;
+}
+
+/**
+ * \brief Chooses the kernel set used by the classification functions.
+ */
+int
+selectClassifyKernel(int kernel)
+{
+    if (kernel >= NUMKERNELS)
+        kernel = NUMKERNELS - 1;
+    while ((kernel > KERNSCALAR) && !supported(kernel))
+        kernel--;
+    if (kernel < KERNSCALAR)
+        kernel = KERNSCALAR;
+    current = kernels + kernel;
+    return kernel;
+}
+
+/**
+ * \brief Kernel set currently used.
+ */
+int
+classifyKernel()
+{
+    if (current == NULL)
+        selectClassifyKernel(NUMKERNELS - 1);
+    return (int) (current - kernels);
+}
+
+/**
+ * \brief Name of a kernel set.
+ */
+const char     *
+classifyKernelName(int kernel)
+{
+    if ((kernel < 0) || (kernel >= NUMKERNELS))
+        return "?";
+    return kernels[kernel].name;
+}
+
+/**
+ * \brief Cuts a row of pixels with a mask.
+ */
+void
+cutRow(const unsigned int *msk, const unsigned int *img, int n,
+       unsigned int *cut)
+{
+    if (current == NULL)
+        selectClassifyKernel(NUMKERNELS - 1);
+    current->cut(msk, img, n, cut);
+}
+
+/**
+ * \brief Cuts and classifies a row of pixels in ARGB format.
+ */
+void
+classifyARGB(const unsigned int *msk, const unsigned int *img, int n,
+             int rbnum, int rbden, unsigned char *cls, unsigned int *cut)
+{
+    if (current == NULL)
+        selectClassifyKernel(NUMKERNELS - 1);
+    current->argb(msk, img, n, rbnum, rbden, cls, cut);
+}
+
+/**
+ * \brief Cuts and classifies a row of pixels in separate color planes.
+ */
+void
+classifyPlanar(const unsigned int *msk, const unsigned char *red,
+               const unsigned char *green, const unsigned char *blue,
+               int n, int rbnum, int rbden, unsigned char *cls,
+               unsigned int *cut)
+{
+    if (current == NULL)
+        selectClassifyKernel(NUMKERNELS - 1);
+    current->planar(msk, red, green, blue, n, rbnum, rbden, cls, cut);
+}
+
+/*
+ * classify.c ends here
+ */
@@ -94,15 +94,45 @@ exifreg         tgslist[TGSINTRST] = {
 int
 getImgInfo(char *fname, double az, char *utcoff,
            ImageInfo * imin, CamAndShotInfo * casi)
+{
+    FILE           *infile = fopen(fname, "rb");
+    unsigned char  *data = NULL;
+    long            size = 0;
+    int             res;
+
+    if (!infile)
+        return -1;              /* file error */
+    /*
+     * the whole file in a single read
+     */
+    if ((fseek(infile, 0, SEEK_END) == 0) && ((size = ftell(infile)) > 0) &&
+        (fseek(infile, 0, SEEK_SET) == 0)) {
+        data = (unsigned char *) malloc(size);
+        if ((data != NULL) && (fread(data, 1, size, infile) != (size_t) size))
+            size = 0;
+    }
+    fclose(infile);
+    if (data == NULL)
+        size = 0;
+    res = getImgInfoData(fname, data, size, az, utcoff, imin, casi);
+    free(data);
+    return res;
+}
+
+/**
+ * \brief Gets the EXIF metadata from a JPEG file already read.
+ */
+int
+getImgInfoData(char *fname, const unsigned char *data, size_t size,
+               double az, char *utcoff, ImageInfo * imin,
+               CamAndShotInfo * casi)
 {
     ExifData       *ed;
     unsigned int    tag;
     /* const char     *name;  */
     char            valor[81];
     ExifIfd         iIFD;
-    int             i;
-    FILE           *infile = fopen(fname, "rb");
-    int             c[4];
+    int             i, found = 0;
     unsigned int    signature;
     char           *from;
     char          **cadptr = (char **) casi;
@@ -111,13 +141,11 @@ getImgInfo(char *fname, double az, char *utcoff,
     double          valoff;
     double          jdate;
 
-    if (!infile)
-        return -1;              /* file error */
+    if (size < 4)
+        return -2;              /* No JPEG + EXIF file */
 
-    for (i = 0; i < 4; i++)
-        c[i] = fgetc(infile);
-    fclose(infile);
-    signature = (c[0] << 24) | (c[1] << 16) | (c[2] << 8) | c[3];
+    signature = ((unsigned int) data[0] << 24) | (data[1] << 16) |
+        (data[2] << 8) | data[3];
     if (signature != JPEGEXIFMN)
         return -2;              /* No JPEG + EXIF file */
 
@@ -128,6 +156,10 @@ getImgInfo(char *fname, double az, char *utcoff,
         return -3;
     if ((az < 0) || (az >= 360))
         return -4;              /* azimuth out of range */
+    /*
+     * CamAndShotInfo: only the tags present in file are filled
+     */
+    memset(casi, 0, sizeof(CamAndShotInfo));
 
     /*
      * time offset out of range
@@ -166,9 +198,14 @@ getImgInfo(char *fname, double az, char *utcoff,
      */
     imin->azimuth = az;
 
-    ed = exif_data_new_from_file(fname);
+    ed = exif_data_new_from_data(data, (unsigned int) size);
+    if (ed == NULL) {
+        free(imin->filename);
+        return -6;              /* EXIF data cannot be read */
+    }
     iIFD = (ExifIfd) tgslist[0].idx;
     tag = tgslist[0].tgnum;
+    valor[0] = '\x0';          /* empty if the tag is missing */
     exif_content_get_value(ed->ifd[iIFD], tag, valor, 80);
     /*
      * ImageInfo: EXIF version
@@ -190,24 +227,29 @@ getImgInfo(char *fname, double az, char *utcoff,
             /*
              * ImageInfo: width
              */
-            if (i == 1)
+            if (i == 1) {
                 imin->width = strtol(valor, (char **) NULL, 10);
+                found++;
+            }
             /*
              * ImageInfo: height
              */
-            else if (i == 2)
+            else if (i == 2) {
                 imin->height = strtol(valor, (char **) NULL, 10);
+                found++;
+            }
             /*
              * ImageInfo: Date and time info
              */
             else if (i == 3) {
                 from = valor;
-                sscanf(from, "%4d:%2d:%2d %2d:%2d:%2d",
-                       &(imin->year),
-                       &(imin->month),
-                       &(imin->day),
-                       &(imin->UTChr),
-                       &(imin->UTCmin), &(imin->UTCsec));
+                if (sscanf(from, "%4d:%2d:%2d %2d:%2d:%2d",
+                           &(imin->year),
+                           &(imin->month),
+                           &(imin->day),
+                           &(imin->UTChr),
+                           &(imin->UTCmin), &(imin->UTCsec)) == 6)
+                    found++;
                 /*
                  * correction to time obtained from EXIF, to obtain UTC time
                  */
@@ -237,8 +279,35 @@ getImgInfo(char *fname, double az, char *utcoff,
             }
         }
     }
+    exif_data_unref(ed);
+    /*
+     * libexif accepts a damaged EXIF block, the dimensions and the date
+     * and time must be there
+     */
+    if (found < 3) {
+        freeImgInfo(imin, casi);
+        return -6;
+    }
     return 1;                   /* success */
 }
+
+/**
+ * \brief Releases the strings allocated by getImgInfo.
+ */
+void
+freeImgInfo(ImageInfo * imin, CamAndShotInfo * casi)
+{
+    char          **cadptr = (char **) casi;
+    int             i;
+
+    free(imin->filename);
+    free(imin->exifversion);
+    imin->filename = imin->exifversion = NULL;
+    for (i = 5; i < TGSINTRST; i++) {
+        free(cadptr[i - 5]);
+        cadptr[i - 5] = NULL;
+    }
+}
 /*
  * imageinfo.c ends here
  */
@@ -38,103 +38,384 @@
 #include<stdio.h>
 #include<stdlib.h>
 #include<string.h>
+#include<setjmp.h>
+#include<zlib.h>
 #include"imageio.h"
+#include"parallel.h"
+
+/*
+ * libjpeg-turbo can skip rows and crop columns while decompressing
+ */
+#ifdef LIBJPEG_TURBO_VERSION_NUMBER
+#define JPGCROP
+#endif
+
+/*
+ * libjpeg 8 and libjpeg-turbo can decompress from a memory buffer
+ */
+#if (JPEG_LIB_VERSION >= 80) || defined(MEM_SRCDST_SUPPORTED)
+#define JPGMEMSRC
+#endif
 
 /**
- * \brief Reads a JPEG image from file.
+ * JPEG error manager. The standard one terminates the program when
+ * a corrupted file is found, this one returns control to the reading
+ * function.
  */
-unsigned int  **
-readJPGImage(char *fname, int *width, int *height)
+struct jpgerrmgr {
+    /** standard fields */
+    struct jpeg_error_mgr pub;
+    /** return point */
+    jmp_buf         setjmp_buffer;
+};
+
+/*
+ * Error exit routine: displays the message and jumps to the return point
+ */
+static void
+jpgErrorExit(j_common_ptr cinfo)
 {
+    struct jpgerrmgr *err = (struct jpgerrmgr *) cinfo->err;
+
+    (*cinfo->err->output_message) (cinfo);
+    longjmp(err->setjmp_buffer, 1);
+}
+
+/**
+ * JPEG incremental reader: decompressor, error manager, source file and
+ * the buffer of the last RGB row read.
+ */
+struct jpgreader {
+    /** decompressor */
     struct jpeg_decompress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    JSAMPROW        row_pointer[1];
-    unsigned int  **im;
-    unsigned int   *fullimage;
-    int             i, j;
-    register unsigned int red, green, blue;
+    /** error manager */
+    struct jpgerrmgr jerr;
+    /** source file, NULL if the source is a memory buffer */
+    FILE           *infile;
+    /** RGB row buffer */
+    JSAMPROW        line;
+};
 
-    FILE           *infile = fopen(fname, "rb");
+/*
+ * Prepares the decompression of infile, or of the size bytes of data if
+ * infile is NULL, at a reduced scale. infile is closed if the reader
+ * cannot be created.
+ */
+static JPGReader *
+startJPGReader(FILE * infile, const unsigned char *data, size_t size,
+               int scale, int *width, int *height)
+{
+    JPGReader      *jr;
 
-    if (!infile) {
+    jr = (JPGReader *) malloc(sizeof(JPGReader));
+    if (jr == NULL) {
+        if (infile != NULL)
+            fclose(infile);
         return NULL;
     }
-
+    jr->infile = infile;
+    jr->line = NULL;
     /*
-     * set the error handler (default used)
+     * set the error handler (standard messages, but no exit)
      */
-    cinfo.err = jpeg_std_error(&jerr);
+    jr->cinfo.err = jpeg_std_error(&jr->jerr.pub);
+    jr->jerr.pub.error_exit = jpgErrorExit;
+    jpeg_create_decompress(&jr->cinfo);
+    if (setjmp(jr->jerr.setjmp_buffer)) {
+        /*
+         * corrupted header
+         */
+        closeJPGReader(jr);
+        return NULL;
+    }
     /*
-     * setup decompression process
+     * this makes the library read from infile, or from the buffer
      */
-    jpeg_create_decompress(&cinfo);
+    if (infile != NULL)
+        jpeg_stdio_src(&jr->cinfo, infile);
+#ifdef JPGMEMSRC
+    else
+        jpeg_mem_src(&jr->cinfo, (unsigned char *) data,
+                     (unsigned long) size);
+#endif
     /*
-     * this makes the library read from infile
+     * reading the image header which contains image information
      */
-    jpeg_stdio_src(&cinfo, infile);
+    jpeg_read_header(&jr->cinfo, TRUE);
     /*
-     * reading the image header which contains image information
+     * the IDCT produces the reduced image directly
      */
-    jpeg_read_header(&cinfo, TRUE);
-    jpeg_start_decompress(&cinfo);
+    jr->cinfo.scale_num = 1;
+    jr->cinfo.scale_denom = scale;
+    jpeg_start_decompress(&jr->cinfo);
 
     /*
      * Size of actual image and size of formal image differ: that means that
-     * actual image is the formal image rescaling. We only accept non-rescaled
-     * images
+     * actual image is the formal image rescaling. We only accept the
+     * rescaling requested
      */
-    if ((cinfo.output_width != cinfo.image_width) ||
-        (cinfo.output_height != cinfo.image_height)) {
-        jpeg_abort((j_common_ptr) & cinfo);
+    if ((jr->cinfo.output_width !=
+         (jr->cinfo.image_width + scale - 1) / scale) ||
+        (jr->cinfo.output_height !=
+         (jr->cinfo.image_height + scale - 1) / scale) ||
+        (jr->cinfo.output_components != 3)) {
+        closeJPGReader(jr);
         return NULL;
     }
-    *width = cinfo.output_width;
-    *height = cinfo.output_height;
-
+    *width = jr->cinfo.output_width;
+    *height = jr->cinfo.output_height;
     /*
-     * memory to store the row pointers
+     * memory for the temporary row storage
      */
-    im = (unsigned int **) malloc(*height * sizeof(unsigned int *));
+    jr->line = (JSAMPROW) malloc(jr->cinfo.output_width *
+                                 jr->cinfo.output_components);
+    if (jr->line == NULL) {
+        closeJPGReader(jr);
+        return NULL;
+    }
+    return jr;
+}
+
+/**
+ * \brief Opens a JPEG file to read its rows one by one, at a reduced
+ * scale.
+ */
+JPGReader      *
+openScaledJPGReader(char *fname, int scale, int *width, int *height)
+{
+    FILE           *infile = fopen(fname, "rb");
+
+    if (!infile)
+        return NULL;
+    return startJPGReader(infile, NULL, 0, scale, width, height);
+}
+
+/**
+ * \brief Opens a JPEG image stored in memory to read its rows one by one,
+ * at a reduced scale.
+ */
+JPGReader      *
+openMemJPGReader(const unsigned char *data, size_t size, int scale,
+                 int *width, int *height)
+{
+#ifdef JPGMEMSRC
+    if ((data == NULL) || (size == 0))
+        return NULL;
+    return startJPGReader(NULL, data, size, scale, width, height);
+#else
+    return NULL;
+#endif
+}
+
+/**
+ * \brief Opens a JPEG file to read its rows one by one.
+ */
+JPGReader      *
+openJPGReader(char *fname, int *width, int *height)
+{
+    return openScaledJPGReader(fname, 1, width, height);
+}
+
+/**
+ * \brief Reads the next row of a JPEG file.
+ */
+int
+readJPGRow(JPGReader * jr, unsigned int *row)
+{
+    JSAMPROW        row_pointer[1];
+    int             j, width = jr->cinfo.output_width;
+    register unsigned int red, green, blue;
+
+    if (jr->cinfo.output_scanline >= jr->cinfo.output_height)
+        return 0;
+    if (setjmp(jr->jerr.setjmp_buffer))
+        return 0;               /* corrupted data */
+    row_pointer[0] = jr->line;
+    jpeg_read_scanlines(&jr->cinfo, row_pointer, 1);
     /*
-     * the full image in a single memory block
+     * the jpeg input file has 3 bytes (RGB). We store also an alpha channel,
+     * therefore the total number of bytes per pixel is 4 ARGB = 32 bits int
      */
-    fullimage =
-        (unsigned int *) malloc(*height * *width * sizeof(unsigned int));
+    for (j = 0; j < width; j++) {
+        red = (unsigned int) jr->line[3 * j];   /* R */
+        green = (unsigned int) jr->line[3 * j + 1];     /* G */
+        blue = (unsigned int) jr->line[3 * j + 2];      /* B */
+        row[j] = 0XFF000000 | (red << 16) | (green << 8) | blue;
+    }
+    return 1;
+}
 
+/**
+ * \brief Reads the next row of a JPEG file in separate color planes.
+ */
+int
+readJPGPlanes(JPGReader * jr, unsigned char *red, unsigned char *green,
+              unsigned char *blue)
+{
+    JSAMPROW        row_pointer[1];
+    JSAMPROW        pel;
+    int             j, width = jr->cinfo.output_width;
+
+    if (jr->cinfo.output_scanline >= jr->cinfo.output_height)
+        return 0;
+    if (setjmp(jr->jerr.setjmp_buffer))
+        return 0;               /* corrupted data */
+    row_pointer[0] = jr->line;
+    jpeg_read_scanlines(&jr->cinfo, row_pointer, 1);
+    pel = jr->line;
+    if (green == NULL)
+        for (j = 0; j < width; j++, pel += 3) {
+            red[j] = pel[0];
+            blue[j] = pel[2];
+        }
+    else
+        for (j = 0; j < width; j++, pel += 3) {
+            red[j] = pel[0];
+            green[j] = pel[1];
+            blue[j] = pel[2];
+        }
+    return 1;
+}
+
+/**
+ * \brief Restricts the decompression to a range of columns.
+ */
+int
+cropJPGReader(JPGReader * jr, int *xoffset, int *width)
+{
+#ifdef JPGCROP
+    JDIMENSION      xo, wd, margin;
+#endif
+
+    if ((*xoffset < 0) || (*width < 1) ||
+        (*xoffset + *width > jr->cinfo.output_width))
+        return 0;
+#ifdef JPGCROP
     /*
-     * each im entry, points to the respective image row
+     * the chroma upsampling replicates the border of the cropped region,
+     * so a margin of a block is kept at both sides to get the same pixel
+     * values of the whole row
      */
-    for (i = 0; i < *height; i++)
-        im[i] = fullimage + i * *width;
+    margin = jr->cinfo.max_h_samp_factor * DCTSIZE;
+    xo = (*xoffset > margin) ? *xoffset - margin : 0;
+    wd = *xoffset + *width + margin;
+    if (wd > jr->cinfo.output_width)
+        wd = jr->cinfo.output_width;
+    wd -= xo;
+    if (setjmp(jr->jerr.setjmp_buffer))
+        return 0;
+    jpeg_crop_scanline(&jr->cinfo, &xo, &wd);
+    *xoffset = xo;
+    *width = wd;
+#else
+    *xoffset = 0;
+    *width = jr->cinfo.output_width;
+#endif
+    return 1;
+}
+
+/**
+ * \brief Skips rows of a JPEG file.
+ */
+int
+skipJPGRows(JPGReader * jr, int nrows)
+{
+#ifndef JPGCROP
+    int             i;
+#endif
+
+    if (nrows <= 0)
+        return 1;
+    if (jr->cinfo.output_scanline + nrows > jr->cinfo.output_height)
+        return 0;
+#ifdef JPGCROP
+    if (setjmp(jr->jerr.setjmp_buffer))
+        return 0;               /* corrupted data */
+    jpeg_skip_scanlines(&jr->cinfo, nrows);
+    return 1;
+#else
     /*
-     * memory for the temporary row storage
+     * the rows must be decompressed anyway
      */
-    row_pointer[0] = (unsigned char *) malloc(cinfo.output_width *
-                                              cinfo.num_components);
+    for (i = 0; i < nrows; i++) {
+        if (setjmp(jr->jerr.setjmp_buffer))
+            return 0;
+        jpeg_read_scanlines(&jr->cinfo, &jr->line, 1);
+    }
+    return 1;
+#endif
+}
 
+/**
+ * \brief Finishes the reading of a JPEG file.
+ */
+void
+closeJPGReader(JPGReader * jr)
+{
+    if (jr == NULL)
+        return;
     /*
-     * the jpeg input file has 3 bytes (RGB). We store also an alpha channel
-     * with 0
+     * the remaining rows are discarded, no need to finish the decompression
      */
+    jpeg_destroy_decompress(&jr->cinfo);
+    free(jr->line);
+    if (jr->infile != NULL)
+        fclose(jr->infile);
+    free(jr);
+}
+
+/**
+ * \brief Reads a whole file in memory.
+ */
+unsigned char  *
+readFileData(BufPool * bp, char *fname, size_t *size)
+{
+    FILE           *infile = fopen(fname, "rb");
+    unsigned char  *data = NULL;
+    long            n;
+
+    if (!infile)
+        return NULL;
     /*
-     * therefore the total number of bytes per pixel is 4 RGBA = 32 bits int
+     * a single read of the whole file
      */
-    i = 0;
-    while (cinfo.output_scanline < *height) {
-        jpeg_read_scanlines(&cinfo, row_pointer, 1);
-        for (j = 0; j < *width; j++) {
-            im[i][j] = 0;       /* A */
-            red = (unsigned int) row_pointer[0][3 * j]; /* R */
-            green = (unsigned int) row_pointer[0][3 * j + 1];   /* G */
-            blue = (unsigned int) row_pointer[0][3 * j + 2];    /* B */
-            im[i][j] = 0XFF000000 | (red << 16) | (green << 8) | blue;
+    if ((fseek(infile, 0, SEEK_END) == 0) && ((n = ftell(infile)) > 0) &&
+        (fseek(infile, 0, SEEK_SET) == 0)) {
+        data = (unsigned char *) takeBuffer(bp, n);
+        if ((data != NULL) && (fread(data, 1, n, infile) != (size_t) n)) {
+            giveBuffer(bp, data);
+            data = NULL;
         }
-        i++;
+        *size = n;
     }
-    jpeg_finish_decompress(&cinfo);
-    jpeg_destroy_decompress(&cinfo);
-    free(row_pointer[0]);
     fclose(infile);
+    return data;
+}
+
+/**
+ * \brief Reads a JPEG image from file.
+ */
+unsigned int  **
+readJPGImage(char *fname, int *width, int *height)
+{
+    JPGReader      *jr;
+    unsigned int  **im;
+    int             i;
+
+    jr = openJPGReader(fname, width, height);
+    if (jr == NULL)
+        return NULL;
+    /*
+     * the full image in a single memory block
+     */
+    im = newImage(*width, *height);
+    for (i = 0; i < *height; i++)
+        if (!readJPGRow(jr, im[i])) {
+            freeImage(im);
+            im = NULL;
+            break;
+        }
+    closeJPGReader(jr);
     return im;
 }
 
@@ -193,10 +474,21 @@ readPNGImage(char *fname, int *width, int *height)
     color_type = png_get_color_type(png_ptr, info_ptr);
     bit_depth = png_get_bit_depth(png_ptr, info_ptr);
 
-    if ((color_type != PNG_COLOR_TYPE_RGB_ALPHA) || (bit_depth != 8)) {
-      fclose(infile);
-      return NULL;            /* only RGBA 8 bits per channel is allowed */
-    }
+    /*
+     * every other format is expanded to RGBA 8 bits per channel
+     */
+    if (bit_depth == 16)
+        png_set_strip_16(png_ptr);
+    if (color_type == PNG_COLOR_TYPE_PALETTE)
+        png_set_palette_to_rgb(png_ptr);
+    if ((color_type == PNG_COLOR_TYPE_GRAY) && (bit_depth < 8))
+        png_set_expand_gray_1_2_4_to_8(png_ptr);
+    if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS))
+        png_set_tRNS_to_alpha(png_ptr);
+    else if (!(color_type & PNG_COLOR_MASK_ALPHA))
+        png_set_filler(png_ptr, 0XFF, PNG_FILLER_AFTER);
+    if (!(color_type & PNG_COLOR_MASK_COLOR))
+        png_set_gray_to_rgb(png_ptr);
 
     png_set_interlace_handling(png_ptr);
     png_read_update_info(png_ptr, info_ptr);
@@ -243,21 +535,355 @@ readPNGImage(char *fname, int *width, int *height)
     return im;
 }
 
-/**
- * \brief Writes an image to a PNG file.
+/*
+ * Bytes of the sliding window of deflate, the most a stripe can take
+ * from the rows before it as preset dictionary
  */
-int
-writePNGImage(unsigned int **img, char *fname, int width, int height)
+#define PNGWINDOW 32768
+
+/*
+ * A horizontal stripe of a PNG image, deflated as a piece of the whole
+ * zlib stream
+ */
+typedef struct {
+    /** rows first, ..., last - 1 */
+    int             first, last;
+    /** compressed data, its length and allocated size */
+    unsigned char  *data;
+    size_t          len, size;
+    /** Adler-32 checksum of the filtered rows */
+    uLong           adler;
+    /** 1 if the stripe was compressed, 0 on error */
+    int             ok;
+} pngstripe;
+
+/*
+ * The stripes of a PNG image, with the row function shared by them
+ */
+typedef struct {
+    size_t          rowbytes;
+    /** bytes per pixel for the filters, 0 for no filtering */
+    int             bpp;
+    PNGIndexFunc    getrow;
+    void           *arg;
+    int             nstripes;
+    pngstripe      *stripe;
+} pngstripes;
+
+/*
+ * Paeth predictor of the PNG format
+ */
+static int
+paeth(int a, int b, int c)
+{
+    int             pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2 * c);
+
+    if ((pa <= pb) && (pa <= pc))
+        return a;
+    return (pb <= pc) ? b : c;
+}
+
+/*
+ * Sum of the filtered bytes taken as signed, the heuristic of libpng to
+ * choose the filter of a row
+ */
+static unsigned long
+filterSum(const unsigned char *f, size_t n)
+{
+    unsigned long   sum = 0;
+    size_t          j;
+
+    for (j = 0; j < n; j++)
+        sum += (f[j] < 128) ? f[j] : 256 - f[j];
+    return sum;
+}
+
+/*
+ * Filters a row of n bytes given the previous one: out has room for the
+ * five filters (n + 1 bytes each, the filter type first), the one with
+ * the smallest sum is returned. With bpp = 0 the row is not filtered.
+ */
+static const unsigned char *
+filterRow(const unsigned char *row, const unsigned char *prev, size_t n,
+          int bpp, unsigned char *out)
+{
+    unsigned char  *f;
+    const unsigned char *best = out;
+    unsigned long   sum, bestsum;
+    size_t          j, b = (size_t) bpp;
+    int             t;
+
+    out[0] = 0;
+    memcpy(out + 1, row, n);
+    if (bpp == 0)
+        return out;
+    bestsum = filterSum(out + 1, n);
+    for (t = 1; t < 5; t++) {
+        f = out + t * (n + 1);
+        f[0] = t;
+        f++;
+        /*
+         * the bytes of the first pixel have no left neighbor
+         */
+        for (j = 0; (j < b) && (j < n); j++)
+            f[j] = row[j] - ((t == 1) ? 0 : (t == 3) ? prev[j] >> 1 :
+                             prev[j]);
+        if (t == 1)
+            for (; j < n; j++)
+                f[j] = row[j] - row[j - b];
+        else if (t == 2)
+            for (; j < n; j++)
+                f[j] = row[j] - prev[j];
+        else if (t == 3)
+            for (; j < n; j++)
+                f[j] = row[j] - ((row[j - b] + prev[j]) >> 1);
+        else
+            for (; j < n; j++)
+                f[j] = row[j] - paeth(row[j - b], prev[j], prev[j - b]);
+        sum = filterSum(f, n);
+        if (sum < bestsum) {
+            bestsum = sum;
+            best = f - 1;
+        }
+    }
+    return best;
+}
+
+/*
+ * Deflates the output of the last rows given to a stripe, growing its
+ * buffer as needed. Returns 0 on error.
+ */
+static int
+deflateOut(z_stream * zs, pngstripe * st, int flush)
+{
+    unsigned char  *p;
+    int             r;
+
+    do {
+        if (st->len == st->size) {
+            p = (unsigned char *) realloc(st->data, 2 * st->size);
+            if (p == NULL)
+                return 0;
+            st->data = p;
+            st->size *= 2;
+        }
+        zs->next_out = st->data + st->len;
+        zs->avail_out = st->size - st->len;
+        r = deflate(zs, flush);
+        st->len = st->size - zs->avail_out;
+        if (r == Z_STREAM_ERROR)
+            return 0;
+    } while (zs->avail_out == 0);
+    return 1;
+}
+
+/*
+ * Thread that filters and compresses the stripe id as a raw deflate
+ * stream: all but the last one end in a byte boundary (sync flush) and
+ * without the final block, so they can be concatenated. The rows before
+ * the stripe (up to the window size) are filtered again to be the preset
+ * dictionary, so the compression is almost the one of a single stream.
+ */
+static void
+deflateStripe(void *arg, int id)
+{
+    pngstripes     *ps = (pngstripes *) arg;
+    pngstripe      *st = ps->stripe + id;
+    size_t          n = ps->rowbytes;
+    int             ndict = (int) ((PNGWINDOW + n) / (n + 1));
+    int             first, i, k = 0, res = 1;
+    unsigned char  *raw[2], *zero, *filt, *dict = NULL;
+    const unsigned char *row, *prev, *f;
+    size_t          dlen = 0, dk;
+    z_stream        zs;
+
+    first = (st->first > ndict) ? st->first - ndict : 0;
+    raw[0] = (unsigned char *) malloc(n);
+    raw[1] = (unsigned char *) malloc(n);
+    zero = (unsigned char *) calloc(n, 1);
+    filt = (unsigned char *) malloc(5 * (n + 1));
+    if (st->first > first)
+        dict = (unsigned char *) malloc((st->first - first) * (n + 1));
+    st->size = (st->last - st->first) * (n + 1) / 8 + 1024;
+    st->data = (unsigned char *) malloc(st->size);
+    zs.zalloc = Z_NULL;
+    zs.zfree = Z_NULL;
+    zs.opaque = Z_NULL;
+    if (!raw[0] || !raw[1] || !zero || !filt || !st->data ||
+        ((st->first > first) && !dict) ||
+        (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                      ps->bpp ? Z_FILTERED : Z_DEFAULT_STRATEGY) != Z_OK)) {
+        free(raw[0]);
+        free(raw[1]);
+        free(zero);
+        free(filt);
+        free(dict);
+        st->ok = 0;
+        return;
+    }
+    /*
+     * the first stripe leaves room for the zlib header
+     */
+    st->len = (id == 0) ? 2 : 0;
+    st->adler = adler32(0L, Z_NULL, 0);
+    prev = (first > 0) ? ps->getrow(ps->arg, first - 1, raw[1]) : zero;
+    for (i = first; res && (i < st->last); i++) {
+        row = ps->getrow(ps->arg, i, raw[k]);
+        f = filterRow(row, prev, n, ps->bpp, filt);
+        if (i < st->first) {
+            memcpy(dict + dlen, f, n + 1);
+            dlen += n + 1;
+            if (i == st->first - 1) {
+                dk = (dlen > PNGWINDOW) ? PNGWINDOW : dlen;
+                res = deflateSetDictionary(&zs, dict + dlen - dk,
+                                           (uInt) dk) == Z_OK;
+            }
+        }
+        else {
+            st->adler = adler32(st->adler, f, n + 1);
+            zs.next_in = (unsigned char *) f;
+            zs.avail_in = n + 1;
+            res = deflateOut(&zs, st, (i < st->last - 1) ? Z_NO_FLUSH :
+                             (id < ps->nstripes - 1) ? Z_SYNC_FLUSH :
+                             Z_FINISH);
+        }
+        prev = row;
+        k = (row == raw[0]) ? 1 : 0;
+    }
+    deflateEnd(&zs);
+    free(raw[0]);
+    free(raw[1]);
+    free(zero);
+    free(filt);
+    free(dict);
+    st->ok = res;
+}
+
+/*
+ * Frees the stripes of an image
+ */
+static void
+freeStripes(pngstripes * ps)
+{
+    int             k;
+
+    if (ps == NULL)
+        return;
+    for (k = 0; k < ps->nstripes; k++)
+        free(ps->stripe[k].data);
+    free(ps->stripe);
+    free(ps);
+}
+
+/*
+ * Filters and compresses an image in nstripes horizontal stripes, one
+ * thread each, as the pieces of a single zlib stream: the zlib header at
+ * the start of the first one, the Adler-32 of the whole image (combined
+ * from the ones of the stripes) at the end of the last one. Returns NULL
+ * on error.
+ */
+static pngstripes *
+deflateStripes(int height, size_t rowbytes, int bpp, PNGIndexFunc getrow,
+               void *arg, int nstripes)
+{
+    pngstripes     *ps;
+    pngstripe      *st;
+    unsigned char  *p;
+    uLong           adler;
+    int             k, ok = 1;
+
+    ps = (pngstripes *) malloc(sizeof(pngstripes));
+    if (ps == NULL)
+        return NULL;
+    ps->stripe = (pngstripe *) calloc(nstripes, sizeof(pngstripe));
+    if (ps->stripe == NULL) {
+        free(ps);
+        return NULL;
+    }
+    ps->rowbytes = rowbytes;
+    ps->bpp = bpp;
+    ps->getrow = getrow;
+    ps->arg = arg;
+    ps->nstripes = nstripes;
+    for (k = 0; k < nstripes; k++) {
+        ps->stripe[k].first = (int) ((long) k * height / nstripes);
+        ps->stripe[k].last = (int) ((long) (k + 1) * height / nstripes);
+    }
+    runThreads(nstripes, deflateStripe, ps);
+
+    for (k = 0; k < nstripes; k++)
+        ok = ok && ps->stripe[k].ok;
+    st = ps->stripe + nstripes - 1;
+    if (ok && (st->size < st->len + 4)) {
+        p = (unsigned char *) realloc(st->data, st->len + 4);
+        if (p != NULL) {
+            st->data = p;
+            st->size = st->len + 4;
+        }
+        else
+            ok = 0;
+    }
+    if (!ok) {
+        freeStripes(ps);
+        return NULL;
+    }
+    /*
+     * deflate with a 32K window and the default level
+     */
+    ps->stripe[0].data[0] = 0X78;
+    ps->stripe[0].data[1] = 0X9C;
+    adler = ps->stripe[0].adler;
+    for (k = 1; k < nstripes; k++)
+        adler = adler32_combine(adler, ps->stripe[k].adler, (z_off_t)
+                                ((ps->stripe[k].last - ps->stripe[k].first) *
+                                 (rowbytes + 1)));
+    st->data[st->len++] = (adler >> 24) & 0XFF;
+    st->data[st->len++] = (adler >> 16) & 0XFF;
+    st->data[st->len++] = (adler >> 8) & 0XFF;
+    st->data[st->len++] = adler & 0XFF;
+    return ps;
+}
+
+/*
+ * Writes a PNG file row by row: RGBA 8 bits per channel if palette is
+ * NULL, otherwise a palette image of depth bits per pixel. Each row is
+ * rowbytes long. With nthreads > 1 the image is compressed in stripes by
+ * that many threads before the file is created, and written as one IDAT
+ * chunk per stripe.
+ */
+static int
+writePNGFile(char *fname, int width, int height, int depth,
+             const unsigned int *palette, int ncolors, size_t rowbytes,
+             PNGIndexFunc getrow, void *arg, int nthreads)
 {
     png_structp     png_ptr;
     png_infop       info_ptr;
+    png_color       plte[256];
+    png_byte        trns[256];
+    unsigned char  *buf;
+    pngstripes     *ps = NULL;
+    int             i, ntrns = 0;
+    FILE           *outfile;
+
+    if (nthreads > height)
+        nthreads = height;
+    if (nthreads > MAXTHREADS)
+        nthreads = MAXTHREADS;
+    if (nthreads > 1) {
+        ps = deflateStripes(height, rowbytes, (palette != NULL) ? 0 : 4,
+                            getrow, arg, nthreads);
+        if (ps == NULL)
+            return -6;          /* Error writing bytes */
+    }
 
     /*
      * create file
      */
-    FILE           *outfile = fopen(fname, "wb");
-    if (!outfile)
+    outfile = fopen(fname, "wb");
+    if (!outfile) {
+        freeStripes(ps);
         return -1;
+    }
 
     /*
      * initialize stuff
@@ -266,17 +892,24 @@ writePNGImage(unsigned int **img, char *fname, int width, int height)
 
     if (!png_ptr) {
       fclose(outfile);
+      freeStripes(ps);
       return -2;              /* cannot create write struct */
     }
 
     info_ptr = png_create_info_struct(png_ptr);
     if (!info_ptr) {
+      png_destroy_write_struct(&png_ptr, NULL);
       fclose(outfile);
+      freeStripes(ps);
       return -3;              /* cannot create info struct */
     }
 
+    buf = (unsigned char *) malloc(rowbytes ? rowbytes : 1);
     if (setjmp(png_jmpbuf(png_ptr))) {
+      png_destroy_write_struct(&png_ptr, &info_ptr);
+      free(buf);
       fclose(outfile);
+      freeStripes(ps);
       return -4;              /* error during init i/o */
     }
 
@@ -287,49 +920,209 @@ writePNGImage(unsigned int **img, char *fname, int width, int height)
      * write header
      */
     if (setjmp(png_jmpbuf(png_ptr))) {
+      png_destroy_write_struct(&png_ptr, &info_ptr);
+      free(buf);
       fclose(outfile);
+      freeStripes(ps);
       return -5;              /* error writing header */
     }
 
-    /*
-     * param 5: bit depth = bits used for each chanel (8 bis). param 6: color
-     * type
-     */
-    png_set_IHDR(png_ptr, info_ptr, width, height,
-                 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE,
-                 PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
-
-    png_write_info(png_ptr, info_ptr);
+    if (palette != NULL) {
+        /*
+         * the colors, and the alpha of all of them up to the last one
+         * that is not opaque
+         */
+        png_set_IHDR(png_ptr, info_ptr, width, height,
+                     depth, PNG_COLOR_TYPE_PALETTE, PNG_INTERLACE_NONE,
+                     PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+        for (i = 0; i < ncolors; i++) {
+            plte[i].red = (palette[i] >> 16) & 0XFF;
+            plte[i].green = (palette[i] >> 8) & 0XFF;
+            plte[i].blue = palette[i] & 0XFF;
+            trns[i] = palette[i] >> 24;
+            if (trns[i] != 0XFF)
+                ntrns = i + 1;
+        }
+        png_set_PLTE(png_ptr, info_ptr, plte, ncolors);
+        if (ntrns > 0)
+            png_set_tRNS(png_ptr, info_ptr, trns, ntrns, NULL);
+        png_write_info(png_ptr, info_ptr);
+    }
+    else {
+        /*
+         * param 5: bit depth = bits used for each chanel (8 bis). param 6:
+         * color type
+         */
+        png_set_IHDR(png_ptr, info_ptr, width, height,
+                     8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE,
+                     PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
-    /*
-     * Weird!! in order to preserve the order I must say it's inverted
-     */
-    png_set_bgr(png_ptr);
+        png_write_info(png_ptr, info_ptr);
+    }
 
     /*
-     * write bytes
+     * write bytes, each row is asked for when it is written
      */
     if (setjmp(png_jmpbuf(png_ptr))) {
+      png_destroy_write_struct(&png_ptr, &info_ptr);
+      free(buf);
       fclose(outfile);
+      freeStripes(ps);
       return -6;              /* Error writing bytes */
     }
 
-    png_write_image(png_ptr, (png_bytep *) img);
+    if (ps != NULL)
+        for (i = 0; i < ps->nstripes; i++)
+            png_write_chunk(png_ptr, (png_const_bytep) "IDAT",
+                            ps->stripe[i].data, ps->stripe[i].len);
+    else
+        for (i = 0; i < height; i++)
+            png_write_row(png_ptr, (png_bytep) getrow(arg, i, buf));
 
     /*
      * end write
      */
     if (setjmp(png_jmpbuf(png_ptr))) {
+      png_destroy_write_struct(&png_ptr, &info_ptr);
+      free(buf);
       fclose(outfile);
+      freeStripes(ps);
       return -7;              /* Error during end of write */
     }
 
-    png_write_end(png_ptr, NULL);
+    /*
+     * libpng does not know about the IDAT chunks of the stripes
+     */
+    if (ps != NULL)
+        png_write_chunk(png_ptr, (png_const_bytep) "IEND", NULL, 0);
+    else
+        png_write_end(png_ptr, NULL);
 
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    free(buf);
     fclose(outfile);
+    freeStripes(ps);
     return 1;
 }
 
+/*
+ * An ARGB row function, as the packed row function of writePNGFile
+ */
+typedef struct {
+    PNGRowFunc      getrow;
+    void           *arg;
+    int             width;
+} argbrows;
+
+/*
+ * The ARGB row is translated (in place if it was built in buf) to the
+ * RGBA bytes of the PNG format
+ */
+static const unsigned char *
+argbRow(void *arg, int i, unsigned char *buf)
+{
+    argbrows       *ar = (argbrows *) arg;
+    const unsigned int *row = ar->getrow(ar->arg, i, (unsigned int *) buf);
+    unsigned int    p;
+    int             j;
+
+    for (j = 0; j < ar->width; j++) {
+        p = row[j];
+        buf[4 * j] = (p >> 16) & 0XFF;
+        buf[4 * j + 1] = (p >> 8) & 0XFF;
+        buf[4 * j + 2] = p & 0XFF;
+        buf[4 * j + 3] = (p >> 24) & 0XFF;
+    }
+    return buf;
+}
+
+/**
+ * \brief Writes an image to a PNG file, row by row, compressed by
+ * several threads.
+ */
+int
+writeParallelPNGRows(char *fname, int width, int height, PNGRowFunc getrow,
+                     void *arg, int nthreads)
+{
+    argbrows        ar;
+
+    ar.getrow = getrow;
+    ar.arg = arg;
+    ar.width = width;
+    return writePNGFile(fname, width, height, 8, NULL, 0,
+                        (size_t) width * sizeof(unsigned int), argbRow, &ar,
+                        nthreads);
+}
+
+/**
+ * \brief Writes an image to a PNG file, row by row.
+ */
+int
+writePNGRows(char *fname, int width, int height, PNGRowFunc getrow,
+             void *arg)
+{
+    return writeParallelPNGRows(fname, width, height, getrow, arg, 1);
+}
+
+/**
+ * \brief Writes a palette image to a PNG file, row by row, compressed by
+ * several threads.
+ */
+int
+writeParallelPNGPalette(char *fname, int width, int height, int depth,
+                        const unsigned int *palette, int ncolors,
+                        PNGIndexFunc getrow, void *arg, int nthreads)
+{
+    if ((depth != 1) && (depth != 2) && (depth != 4) && (depth != 8))
+        return -5;
+    if ((ncolors < 1) || (ncolors > (1 << depth)))
+        return -5;
+    return writePNGFile(fname, width, height, depth, palette, ncolors,
+                        ((size_t) width * depth + 7) / 8, getrow, arg,
+                        nthreads);
+}
+
+/**
+ * \brief Writes a palette image to a PNG file, row by row.
+ */
+int
+writePNGPalette(char *fname, int width, int height, int depth,
+                const unsigned int *palette, int ncolors,
+                PNGIndexFunc getrow, void *arg)
+{
+    return writeParallelPNGPalette(fname, width, height, depth, palette,
+                                   ncolors, getrow, arg, 1);
+}
+
+/*
+ * Row i of an image stored in memory
+ */
+static const unsigned int *
+imageRow(void *arg, int i, unsigned int *buf)
+{
+    return ((unsigned int **) arg)[i];
+}
+
+/**
+ * \brief Writes an image to a PNG file, compressed by several threads.
+ */
+int
+writeParallelPNGImage(unsigned int **img, char *fname, int width,
+                      int height, int nthreads)
+{
+    return writeParallelPNGRows(fname, width, height, imageRow, img,
+                                nthreads);
+}
+
+/**
+ * \brief Writes an image to a PNG file.
+ */
+int
+writePNGImage(unsigned int **img, char *fname, int width, int height)
+{
+    return writeParallelPNGImage(img, fname, width, height, 1);
+}
+
 /**
  * \brief Writes an image to a JPG file.
  */
@@ -397,6 +1190,150 @@ writeJPGImage(unsigned int **img, char *fname, int width, int height)
     return 1;
 }
 
+/**
+ * \brief Releases the memory of an image buffer.
+ */
+void
+freeImage(unsigned int **img)
+{
+    if (img == NULL)
+        return;
+    free(img[0]);
+    free(img);
+}
+
+/**
+ * \brief Allocates an image buffer.
+ */
+unsigned int  **
+newImage(int width, int height)
+{
+    unsigned int  **img;
+    int             i;
+
+    img = (unsigned int **) malloc(height * sizeof(unsigned int *));
+    if (img == NULL)
+        return NULL;
+    img[0] = (unsigned int *) malloc(height * width * sizeof(unsigned int));
+    if (img[0] == NULL) {
+        free(img);
+        return NULL;
+    }
+    for (i = 1; i < height; i++)
+        img[i] = img[0] + i * width;
+    return img;
+}
+
+/**
+ * \brief Takes an image buffer from a pool.
+ */
+unsigned int  **
+newPooledImage(BufPool * bp, int width, int height)
+{
+    unsigned int  **img;
+    size_t          rows = height * sizeof(unsigned int *);
+    int             i;
+
+    /*
+     * the row array is followed by the pixels (rows is a multiple of
+     * the pixel size)
+     */
+    img = (unsigned int **) takeBuffer(bp, rows + (size_t) height * width *
+                                       sizeof(unsigned int));
+    if (img == NULL)
+        return NULL;
+    if (height > 0)
+        img[0] = (unsigned int *) ((char *) img + rows);
+    for (i = 1; i < height; i++)
+        img[i] = img[0] + (size_t) i * width;
+    return img;
+}
+
+/**
+ * \brief Gives an image buffer back to its pool.
+ */
+void
+releaseImage(BufPool * bp, unsigned int **img)
+{
+    giveBuffer(bp, img);
+}
+
+/**
+ * \brief Allocates a planar image.
+ */
+PlanarImage    *
+newPlanarImage(int width, int height, int withgreen)
+{
+    return newPooledPlanarImage(NULL, width, height, withgreen);
+}
+
+/**
+ * \brief Takes a planar image from a pool.
+ */
+PlanarImage    *
+newPooledPlanarImage(BufPool * bp, int width, int height, int withgreen)
+{
+    PlanarImage    *pi = (PlanarImage *) malloc(sizeof(PlanarImage));
+    size_t          n = (size_t) width * height;
+
+    if (pi == NULL)
+        return NULL;
+    pi->width = width;
+    pi->height = height;
+    pi->pool = bp;
+    /*
+     * the planes are a single buffer: red, blue and green
+     */
+    pi->red = (unsigned char *) takeBuffer(bp, (withgreen ? 3 : 2) * n);
+    if (pi->red == NULL) {
+        free(pi);
+        return NULL;
+    }
+    pi->blue = pi->red + n;
+    pi->green = withgreen ? pi->blue + n : NULL;
+    return pi;
+}
+
+/**
+ * \brief Releases a planar image.
+ */
+void
+freePlanarImage(PlanarImage * pi)
+{
+    if (pi == NULL)
+        return;
+    giveBuffer(pi->pool, pi->red);
+    free(pi);
+}
+
+/**
+ * \brief Reads a JPEG image from file in separate color planes.
+ */
+PlanarImage    *
+readPlanarJPGImage(char *fname, int withgreen)
+{
+    JPGReader      *jr;
+    PlanarImage    *pi;
+    int             i, width, height;
+    size_t          off;
+
+    jr = openJPGReader(fname, &width, &height);
+    if (jr == NULL)
+        return NULL;
+    pi = newPlanarImage(width, height, withgreen);
+    for (i = 0; (pi != NULL) && (i < height); i++) {
+        off = (size_t) i * width;
+        if (!readJPGPlanes(jr, pi->red + off,
+                           withgreen ? pi->green + off : NULL,
+                           pi->blue + off)) {
+            freePlanarImage(pi);
+            pi = NULL;
+        }
+    }
+    closeJPGReader(jr);
+    return pi;
+}
+
 /*
  * imageio.c ends here
  */
@@ -0,0 +1,151 @@
+/**
+ * @file metrics.c
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 18:20
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * @section DESCRIPTION
+ * Metrics in the Prometheus text exposition format, see metrics.h.
+ */
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"metrics.h"
+
+/**
+ * \brief Initializes an empty histogram.
+ */
+void
+initHistogram(Histogram * h, const double *bounds, int nbounds)
+{
+    int             k;
+
+    h->nbounds = (nbounds > MAXBUCKETS) ? MAXBUCKETS : nbounds;
+    for (k = 0; k < h->nbounds; k++)
+        h->bound[k] = bounds[k];
+    for (k = 0; k <= MAXBUCKETS; k++)
+        h->count[k] = 0;
+    h->sum = 0.0;
+    h->total = 0;
+}
+
+/**
+ * \brief Adds an observation to a histogram.
+ */
+void
+observeValue(Histogram * h, double v)
+{
+    int             k;
+
+    for (k = 0; (k < h->nbounds) && (v > h->bound[k]); k++);
+    h->count[k]++;
+    h->sum += v;
+    h->total++;
+}
+
+/**
+ * \brief Writes the HELP and TYPE lines of a metric.
+ */
+void
+writeMetricHeader(FILE * f, const char *name, const char *type,
+                  const char *help)
+{
+    fprintf(f, "# HELP %s %s\n", name, help);
+    fprintf(f, "# TYPE %s %s\n", name, type);
+}
+
+/**
+ * \brief Writes a sample of a metric.
+ */
+void
+writeSample(FILE * f, const char *name, const char *labels, double value)
+{
+    if ((labels != NULL) && (labels[0] != '\0'))
+        fprintf(f, "%s{%s} %.10g\n", name, labels, value);
+    else
+        fprintf(f, "%s %.10g\n", name, value);
+}
+
+/**
+ * \brief Writes the samples of a histogram.
+ */
+void
+writeHistogram(FILE * f, const char *name, const char *labels,
+               Histogram * h)
+{
+    const char     *sep = ((labels != NULL) && (labels[0] != '\0')) ? "," : "";
+    unsigned long   acc = 0;
+    int             k;
+
+    if (labels == NULL)
+        labels = "";
+    for (k = 0; k < h->nbounds; k++) {
+        acc += h->count[k];
+        fprintf(f, "%s_bucket{%s%sle=\"%g\"} %lu\n", name, labels, sep,
+                h->bound[k], acc);
+    }
+    fprintf(f, "%s_bucket{%s%sle=\"+Inf\"} %lu\n", name, labels, sep,
+            h->total);
+    fprintf(f, "%s_sum", name);
+    if (labels[0] != '\0')
+        fprintf(f, "{%s}", labels);
+    fprintf(f, " %.10g\n", h->sum);
+    fprintf(f, "%s_count", name);
+    if (labels[0] != '\0')
+        fprintf(f, "{%s}", labels);
+    fprintf(f, " %lu\n", h->total);
+}
+
+/**
+ * \brief Replaces a metrics file.
+ */
+int
+writeMetricsFile(const char *fname, MetricsFunc write, void *arg)
+{
+    char           *tmpname = (char *) malloc(strlen(fname) + 5);
+    FILE           *f;
+    int             ok;
+
+    if (tmpname == NULL)
+        return 0;
+    sprintf(tmpname, "%s.tmp", fname);
+    f = fopen(tmpname, "w");
+    if (f == NULL) {
+        free(tmpname);
+        return 0;
+    }
+    write(f, arg);
+    ok = !ferror(f);
+    ok = (fclose(f) == 0) && ok;
+    if (ok)
+        ok = (rename(tmpname, fname) == 0);
+    if (!ok)
+        remove(tmpname);
+    free(tmpname);
+    return ok;
+}
+
+/*
+ * metrics.c ends here
+ */
@@ -0,0 +1,155 @@
+/**
+ * @file parallel.c
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 10:15
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * @section DESCRIPTION
+ * Parallel execution library. A thin layer over POSIX threads used to
+ * run the same function in several threads sharing a common argument,
+ * the partition of image rows among such threads, and the clocks used
+ * to measure them.
+ */
+#define _POSIX_C_SOURCE 200112L
+#include<stdlib.h>
+#include<pthread.h>
+#include<time.h>
+#include<unistd.h>
+#include"parallel.h"
+
+/*
+ * Arguments of each thread
+ */
+typedef struct {
+    ThreadFunc      func;
+    void           *arg;
+    int             id;
+} threadarg;
+
+/*
+ * Thread body: calls the user function
+ */
+static void    *
+threadMain(void *p)
+{
+    threadarg      *ta = (threadarg *) p;
+
+    ta->func(ta->arg, ta->id);
+    return NULL;
+}
+
+/**
+ * \brief Runs a function in several threads and waits for all of them.
+ */
+int
+runThreads(int n, ThreadFunc func, void *arg)
+{
+    pthread_t       th[MAXTHREADS];
+    threadarg       ta[MAXTHREADS];
+    char            started[MAXTHREADS];
+    int             i;
+
+    if ((n < 1) || (n > MAXTHREADS))
+        return 0;
+    for (i = 1; i < n; i++) {
+        ta[i].func = func;
+        ta[i].arg = arg;
+        ta[i].id = i;
+        started[i] = !pthread_create(&th[i], NULL, threadMain, &ta[i]);
+    }
+    func(arg, 0);
+    /*
+     * the ones that could not be created run here
+     */
+    for (i = 1; i < n; i++)
+        if (!started[i])
+            func(arg, i);
+    for (i = 1; i < n; i++)
+        if (started[i])
+            pthread_join(th[i], NULL);
+    return n;
+}
+
+/**
+ * \brief Splits a sequence of rows in bands of similar weight.
+ */
+void
+partitionRows(const int *weight, int nrows, int n, int *bounds)
+{
+    double          total = 0.0, acc = 0.0;
+    int             i, k;
+
+    for (i = 0; i < nrows; i++)
+        total += weight[i];
+    bounds[0] = 0;
+    for (i = 0, k = 1; (i < nrows) && (k < n); i++) {
+        acc += weight[i];
+        /*
+         * band k - 1 ends when its share of the total weight is reached
+         */
+        while ((k < n) && (acc * n >= total * k))
+            bounds[k++] = i + 1;
+    }
+    while (k <= n)
+        bounds[k++] = nrows;
+}
+
+/**
+ * \brief Number of processors currently online.
+ */
+int
+numProcessors()
+{
+    long            n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (n < 1) ? 1 : (int) n;
+}
+
+/**
+ * \brief Wall clock time, to measure time intervals.
+ */
+double
+wallClock()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1E-9;
+}
+
+/**
+ * \brief CPU time of the process, added over all its threads.
+ */
+double
+cpuClock()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1E-9;
+}
+
+/*
+ * parallel.c ends here
+ */
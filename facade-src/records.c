@@ -0,0 +1,278 @@
+/**
+ * @file records.c
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 19:05
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * @section DESCRIPTION
+ * Buffered writer of result records, see records.h.
+ */
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"records.h"
+
+/*
+ * Maximum length of a number written by putInt or putDouble
+ */
+#define NUMLEN 400
+
+/**
+ * \brief Writes the buffered records in the output file.
+ */
+int
+flushRecords(RecordWriter * rw)
+{
+    if (rw->len > 0) {
+        if (fwrite(rw->buf, 1, rw->len, rw->out) != rw->len)
+            rw->ok = 0;
+        rw->len = 0;
+    }
+    if (fflush(rw->out))
+        rw->ok = 0;
+    return rw->ok;
+}
+
+/*
+ * Appends n bytes to the buffer, writing it when it is full
+ */
+static void
+append(RecordWriter * rw, const char *s, size_t n)
+{
+    if (rw->len + n > RECBUFSIZE) {
+        if (fwrite(rw->buf, 1, rw->len, rw->out) != rw->len)
+            rw->ok = 0;
+        rw->len = 0;
+    }
+    if (n > RECBUFSIZE) {
+        if (fwrite(s, 1, n, rw->out) != n)
+            rw->ok = 0;
+        return;
+    }
+    memcpy(rw->buf + rw->len, s, n);
+    rw->len += n;
+}
+
+/*
+ * Appends a string quoted as a JSON string
+ */
+static void
+appendJSON(RecordWriter * rw, const char *s)
+{
+    char            esc[8];
+    const char     *run;
+
+    append(rw, "\"", 1);
+    while (*s != '\0') {
+        /*
+         * the characters that need no escape are copied in runs
+         */
+        for (run = s; (*s != '\0') && (*s != '"') && (*s != '\\') &&
+             ((unsigned char) *s >= 0x20); s++);
+        append(rw, run, s - run);
+        if (*s == '\0')
+            break;
+        if ((*s == '"') || (*s == '\\'))
+            sprintf(esc, "\\%c", *s);
+        else if (*s == '\n')
+            strcpy(esc, "\\n");
+        else if (*s == '\t')
+            strcpy(esc, "\\t");
+        else
+            sprintf(esc, "\\u%04x", (unsigned char) *s);
+        append(rw, esc, strlen(esc));
+        s++;
+    }
+    append(rw, "\"", 1);
+}
+
+/*
+ * Appends the separator of the next field (and its key in JSON)
+ */
+static void
+startField(RecordWriter * rw)
+{
+    char            key[32];
+
+    switch (rw->format) {
+    case FMT_CSV:
+        if (rw->field > 0)
+            append(rw, ",", 1);
+        break;
+    case FMT_JSONL:
+        append(rw, (rw->field > 0) ? "," : "{", 1);
+        if (rw->field < rw->nfields)
+            appendJSON(rw, rw->names[rw->field]);
+        else {
+            sprintf(key, "field%d", rw->field + 1);
+            appendJSON(rw, key);
+        }
+        append(rw, ":", 1);
+        break;
+    default:
+        if (rw->field > 0)
+            append(rw, " ", 1);
+    }
+    rw->field++;
+}
+
+/**
+ * \brief Creates a record writer.
+ */
+RecordWriter   *
+newRecordWriter(FILE * out, int format, const char **names, int nfields)
+{
+    RecordWriter   *rw = (RecordWriter *) malloc(sizeof(RecordWriter));
+    int             k;
+
+    if (rw == NULL)
+        return NULL;
+    rw->buf = (char *) malloc(RECBUFSIZE);
+    if (rw->buf == NULL) {
+        free(rw);
+        return NULL;
+    }
+    rw->out = out;
+    rw->format = format;
+    rw->names = names;
+    rw->nfields = (names != NULL) ? nfields : 0;
+    rw->field = 0;
+    rw->len = 0;
+    rw->ok = 1;
+    if (format == FMT_CSV) {
+        for (k = 0; k < rw->nfields; k++)
+            putString(rw, names[k]);
+        endRecord(rw);
+    }
+    return rw;
+}
+
+/**
+ * \brief Gets the format with a given name.
+ */
+int
+recordFormat(const char *name)
+{
+    if (strcmp(name, "text") == 0)
+        return FMT_TEXT;
+    if (strcmp(name, "csv") == 0)
+        return FMT_CSV;
+    if (strcmp(name, "jsonl") == 0)
+        return FMT_JSONL;
+    return -1;
+}
+
+/**
+ * \brief Puts a string field in the current record.
+ */
+void
+putString(RecordWriter * rw, const char *s)
+{
+    const char     *q;
+
+    startField(rw);
+    if (rw->format == FMT_JSONL) {
+        appendJSON(rw, s);
+        return;
+    }
+    if ((rw->format != FMT_CSV) || (strpbrk(s, ",\"\r\n") == NULL)) {
+        append(rw, s, strlen(s));
+        return;
+    }
+    /*
+     * CSV quoted field, the quotes are doubled
+     */
+    append(rw, "\"", 1);
+    while ((q = strchr(s, '"')) != NULL) {
+        append(rw, s, q - s + 1);
+        append(rw, "\"", 1);
+        s = q + 1;
+    }
+    append(rw, s, strlen(s));
+    append(rw, "\"", 1);
+}
+
+/**
+ * \brief Puts an integer field in the current record.
+ */
+void
+putInt(RecordWriter * rw, int v)
+{
+    char            num[NUMLEN];
+
+    startField(rw);
+    sprintf(num, "%d", v);
+    append(rw, num, strlen(num));
+}
+
+/**
+ * \brief Puts a real field in the current record.
+ */
+void
+putDouble(RecordWriter * rw, double v)
+{
+    char            num[NUMLEN];
+
+    startField(rw);
+    if ((rw->format == FMT_JSONL) && ((v != v) || (v - v != 0.0)))
+        strcpy(num, "null");
+    else
+        sprintf(num, "%f", v);
+    append(rw, num, strlen(num));
+}
+
+/**
+ * \brief Ends the current record.
+ */
+void
+endRecord(RecordWriter * rw)
+{
+    if (rw->format == FMT_JSONL)
+        append(rw, (rw->field > 0) ? "}\n" : "{}\n",
+               (rw->field > 0) ? 2 : 3);
+    else
+        append(rw, "\n", 1);
+    rw->field = 0;
+}
+
+/**
+ * \brief Writes the buffered records and frees a record writer.
+ */
+int
+freeRecordWriter(RecordWriter * rw)
+{
+    int             ok;
+
+    if (rw == NULL)
+        return 1;
+    ok = flushRecords(rw);
+    free(rw->buf);
+    free(rw);
+    return ok;
+}
+
+/*
+ * records.c ends here
+ */
@@ -0,0 +1,383 @@
+/**
+ * @file rescache.c
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 19:40
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * @section DESCRIPTION
+ * Persistent cache of results, see rescache.h.
+ */
+#define _XOPEN_SOURCE 500
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/types.h>
+#include<sys/stat.h>
+#include<sys/time.h>
+#include"rescache.h"
+
+/*
+ * Identification of the cache files, and version of their layout
+ */
+#define CACHEMAGIC "CCICACHE"
+#define CACHEVERSION 2
+
+/*
+ * Seeds and mixing constants of the two hashes
+ */
+#define HASHSEED1 0x9747b28cU
+#define HASHSEED2 0x5bd1e995U
+#define MIX1 0xcc9e2d51U
+#define MIX2 0x1b873593U
+#define MIX3 0x38b34ae5U
+#define MIX4 0xa1e38b93U
+
+/*
+ * Header of the cache file, followed by the sets of entries
+ */
+struct cachehdr {
+    char            magic[8];
+    int             version;
+    /* size of an entry, the layout depends on the platform */
+    int             entrysize;
+    int             nsets;
+};
+
+/*
+ * Rotates a 32 bit word r bits to the left
+ */
+static unsigned int
+rotl(unsigned int x, int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+/*
+ * Final mixing of a hash
+ */
+static unsigned int
+fmix(unsigned int h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * \brief Calculates the hash of a block of bytes.
+ */
+void
+hashBytes(const void *buf, size_t len, unsigned int hash[2])
+{
+    const unsigned char *p = (const unsigned char *) buf;
+    unsigned int    h1 = HASHSEED1, h2 = HASHSEED2, k, k1, k2;
+    size_t          i, nwords = len / 4;
+
+    for (i = 0; i < nwords; i++) {
+        memcpy(&k, p + 4 * i, 4);
+        k1 = rotl(k * MIX1, 15) * MIX2;
+        h1 = rotl(h1 ^ k1, 13) * 5 + 0xe6546b64U;
+        k2 = rotl(k * MIX3, 16) * MIX4;
+        h2 = rotl(h2 ^ k2, 15) * 5 + 0x561ccd1bU;
+    }
+    /*
+     * the last bytes (less than a word)
+     */
+    k = 0;
+    for (i = len & 3; i > 0; i--)
+        k = (k << 8) | p[4 * nwords + i - 1];
+    if (len & 3) {
+        h1 ^= rotl(k * MIX1, 15) * MIX2;
+        h2 ^= rotl(k * MIX3, 16) * MIX4;
+    }
+    hash[0] = fmix(h1 ^ (unsigned int) len);
+    hash[1] = fmix(h2 ^ (unsigned int) len);
+}
+
+/**
+ * \brief Calculates the hash of the contents of a file.
+ */
+int
+hashFile(const char *fname, unsigned int hash[2])
+{
+    FILE           *f = fopen(fname, "rb");
+    unsigned char  *buf;
+    long            size;
+    int             ok;
+
+    if (f == NULL)
+        return 0;
+    if (fseek(f, 0, SEEK_END) || ((size = ftell(f)) < 0) ||
+        fseek(f, 0, SEEK_SET)) {
+        fclose(f);
+        return 0;
+    }
+    buf = (unsigned char *) malloc(size + 1);
+    ok = (buf != NULL) && (fread(buf, 1, size, f) == (size_t) size);
+    if (ok)
+        hashBytes(buf, size, hash);
+    free(buf);
+    fclose(f);
+    return ok;
+}
+
+/**
+ * \brief Builds the key of a block of data.
+ */
+void
+makeCacheKey(CacheKey * k, const void *data, size_t len,
+             const unsigned int params[2])
+{
+    hashBytes(data, len, k->data);
+    k->params[0] = params[0];
+    k->params[1] = params[1];
+    k->length = len;
+}
+
+/*
+ * Locks (F_WRLCK) or unlocks (F_UNLCK) a range of the cache file,
+ * waiting for the other processes
+ */
+static int
+lockRange(int fd, int type, off_t start, off_t len)
+{
+    struct flock    fl;
+
+    fl.l_type = type;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = start;
+    fl.l_len = len;
+    while (fcntl(fd, F_SETLKW, &fl) == -1)
+        if (errno != EINTR)
+            return 0;
+    return 1;
+}
+
+/**
+ * \brief Opens a cache file, or creates it if it does not exist.
+ */
+ResultCache    *
+openResultCache(const char *fname, int entries)
+{
+    ResultCache    *rc = (ResultCache *) malloc(sizeof(ResultCache));
+    struct cachehdr hdr;
+    ssize_t         n;
+    int             ok;
+
+    if (rc == NULL)
+        return NULL;
+    rc->fd = open(fname, O_RDWR | O_CREAT, 0644);
+    if (rc->fd < 0) {
+        free(rc);
+        return NULL;
+    }
+    /*
+     * the header is locked, so only one process creates the file
+     */
+    ok = lockRange(rc->fd, F_WRLCK, 0, sizeof(hdr));
+    n = ok ? pread(rc->fd, &hdr, sizeof(hdr), 0) : -1;
+    if (n == 0) {
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, CACHEMAGIC, sizeof(hdr.magic));
+        hdr.version = CACHEVERSION;
+        hdr.entrysize = sizeof(CacheEntry);
+        hdr.nsets = (entries > CACHEWAYS) ?
+            (entries + CACHEWAYS - 1) / CACHEWAYS : 1;
+        /*
+         * the entries are zeros, that is, empty
+         */
+        ok = (pwrite(rc->fd, &hdr, sizeof(hdr), 0) == sizeof(hdr)) &&
+            !ftruncate(rc->fd, sizeof(hdr) +
+                       (off_t) hdr.nsets * CACHEWAYS * sizeof(CacheEntry));
+    }
+    else
+        ok = (n == sizeof(hdr)) &&
+            !memcmp(hdr.magic, CACHEMAGIC, sizeof(hdr.magic)) &&
+            (hdr.version == CACHEVERSION) &&
+            (hdr.entrysize == sizeof(CacheEntry)) && (hdr.nsets > 0);
+    lockRange(rc->fd, F_UNLCK, 0, sizeof(hdr));
+    if (!ok) {
+        close(rc->fd);
+        free(rc);
+        return NULL;
+    }
+    rc->nsets = hdr.nsets;
+    pthread_mutex_init(&rc->lock, NULL);
+    return rc;
+}
+
+/*
+ * Offset in the file of the set of a key
+ */
+static off_t
+setOffset(ResultCache * rc, const CacheKey * k)
+{
+    return sizeof(struct cachehdr) +
+        (off_t) (k->data[0] % rc->nsets) * CACHEWAYS * sizeof(CacheEntry);
+}
+
+/*
+ * Checksum of an entry
+ */
+static unsigned int
+entryCheck(CacheEntry * e)
+{
+    unsigned int    h[2];
+
+    hashBytes(e->value, CACHEDATALEN, h);
+    return h[0] ^ e->key.data[1] ^ rotl(e->key.params[0], 7) ^
+        rotl(e->key.params[1], 19) ^ (unsigned int) e->key.length;
+}
+
+/*
+ * 1 if an entry is used and has the given key
+ */
+static int
+sameKey(CacheEntry * e, const CacheKey * k)
+{
+    return (e->lastuse > 0.0) && (e->key.data[0] == k->data[0]) &&
+        (e->key.data[1] == k->data[1]) &&
+        (e->key.params[0] == k->params[0]) &&
+        (e->key.params[1] == k->params[1]) && (e->key.length == k->length);
+}
+
+/*
+ * Time of use later than all the ones of a set (the clock may not
+ * advance between two uses)
+ */
+static double
+useTime(CacheEntry * set)
+{
+    struct timeval  tv;
+    double          now;
+    int             w;
+
+    gettimeofday(&tv, NULL);
+    now = tv.tv_sec + tv.tv_usec * 1.0e-6;
+    for (w = 0; w < CACHEWAYS; w++)
+        if (set[w].lastuse >= now)
+            now = set[w].lastuse + 1.0e-6;
+    return now;
+}
+
+/**
+ * \brief Looks for a value in the cache.
+ */
+int
+cacheLookup(ResultCache * rc, const CacheKey * k, void *value, size_t len)
+{
+    CacheEntry      set[CACHEWAYS];
+    off_t           off = setOffset(rc, k);
+    int             w, found = 0;
+
+    if (len > CACHEDATALEN)
+        return 0;
+    pthread_mutex_lock(&rc->lock);
+    if (lockRange(rc->fd, F_WRLCK, off, sizeof(set))) {
+        if (pread(rc->fd, set, sizeof(set), off) == sizeof(set)) {
+            for (w = 0; (w < CACHEWAYS) && !found; w++)
+                found = sameKey(&set[w], k) &&
+                    (set[w].check == entryCheck(&set[w]));
+            if (found) {
+                w--;
+                memcpy(value, set[w].value, len);
+                /*
+                 * if the time cannot be written the value is good anyway
+                 */
+                set[w].lastuse = useTime(set);
+                pwrite(rc->fd, &set[w], sizeof(CacheEntry),
+                       off + w * sizeof(CacheEntry));
+            }
+        }
+        lockRange(rc->fd, F_UNLCK, off, sizeof(set));
+    }
+    pthread_mutex_unlock(&rc->lock);
+    return found;
+}
+
+/**
+ * \brief Stores a value in the cache.
+ */
+int
+cacheStore(ResultCache * rc, const CacheKey * k, const void *value,
+           size_t len)
+{
+    CacheEntry      set[CACHEWAYS];
+    off_t           off = setOffset(rc, k);
+    int             w, victim = 0, stored = 0;
+
+    if (len > CACHEDATALEN)
+        return 0;
+    pthread_mutex_lock(&rc->lock);
+    if (lockRange(rc->fd, F_WRLCK, off, sizeof(set))) {
+        if (pread(rc->fd, set, sizeof(set), off) == sizeof(set)) {
+            /*
+             * the same key, or else the oldest entry (empty ones are 0)
+             */
+            for (w = 0; w < CACHEWAYS; w++) {
+                if (sameKey(&set[w], k)) {
+                    victim = w;
+                    break;
+                }
+                if (set[w].lastuse < set[victim].lastuse)
+                    victim = w;
+            }
+            set[victim].lastuse = useTime(set);
+            set[victim].key = *k;
+            memset(set[victim].value, 0, CACHEDATALEN);
+            memcpy(set[victim].value, value, len);
+            set[victim].check = entryCheck(&set[victim]);
+            stored = (pwrite(rc->fd, &set[victim], sizeof(CacheEntry),
+                             off + victim * sizeof(CacheEntry)) ==
+                      sizeof(CacheEntry));
+        }
+        lockRange(rc->fd, F_UNLCK, off, sizeof(set));
+    }
+    pthread_mutex_unlock(&rc->lock);
+    return stored;
+}
+
+/**
+ * \brief Closes a cache.
+ */
+void
+closeResultCache(ResultCache * rc)
+{
+    if (rc == NULL)
+        return;
+    close(rc->fd);
+    pthread_mutex_destroy(&rc->lock);
+    free(rc);
+}
+
+/*
+ * rescache.c ends here
+ */
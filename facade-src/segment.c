@@ -0,0 +1,1741 @@
+/**
+ * @file segment.c
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 12:40
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * @section DESCRIPTION
+ * Sky segmentation library. Cuts the interest region of a whole sky
+ * picture with a mask, classifies its pixels as sky or cloud according
+ * to their R/B ratio, smooths the borderline between both classes with
+ * a voting (convolution) operator and calculates the Cloud Cover Index
+ * (CCI) as the weighted proportion of cloud pixels.
+ */
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"imageio.h"
+#include"parallel.h"
+#include"classify.h"
+#include"segment.h"
+
+/*
+ * Counters of each pixel class in the pixel counting: one per weight
+ * category, and one for the pixels beyond the last category limit
+ */
+#define NUMBINS (NUMCAT + 1)
+
+/*
+ * Segmented image value of each pixel class
+ */
+static const unsigned int segval[3] = { SEGOUT, SEGSKY, SEGCLD };
+
+/**
+ * Squared radial distance limits of the weight categories.
+ */
+const int       categories[NUMCAT] = {
+    4225,
+    44944,
+    88209,
+    133956,
+    184900,
+    242064,
+    308025,
+    386884,
+    492804,
+    929296,
+    1028196,
+    1102500,
+    1162084,
+    1212201,
+    1258884,
+    1299600,
+    1336336,
+    1371241,
+    1401856,
+    1432809,
+    1461681,
+    1488400,
+    1512900,
+    1537600,
+    1560001,
+    1582564,
+    1602756,
+    1623076,
+    1640961,
+    1661521,
+    1679616,
+    1695204,
+    1713481,
+    1729225,
+    1745041,
+    1750329
+};
+
+/**
+ * Weight factors of the categories.
+ */
+const double    factors[NUMCAT] = {
+    1.00,
+    0.99,
+    0.98,
+    0.97,
+    0.96,
+    0.95,
+    0.94,
+    0.93,
+    0.92,
+    0.91,
+    1.00,
+    0.99,
+    0.98,
+    0.97,
+    0.96,
+    0.95,
+    0.94,
+    0.93,
+    0.92,
+    1.01,
+    1.02,
+    1.03,
+    1.04,
+    1.05,
+    1.06,
+    1.07,
+    1.08,
+    1.09,
+    1.10,
+    1.11,
+    1.12,
+    1.13,
+    1.14,
+    1.15,
+    1.16,
+    1.17
+};
+
+/*
+ * Data shared by the threads that process the bands of an image
+ */
+typedef struct {
+    unsigned int  **in;
+    unsigned int  **out;
+    SegImage       *seg;
+    unsigned int  **cut;
+    unsigned int  **rows;
+    PlanarImage    *reg;
+    JPGReader      *jr;
+    unsigned char  *lred, *lgreen, *lblue;
+    int             lastrow;
+    int             xskip;
+    int             w, h;
+    int             mv, mh;
+    SkyMask        *sm;
+    SegParams      *sp;
+    long           *hist;
+    double         *times;
+    int            *bandok;
+    unsigned short *rbbin;
+    int             margin;
+} bandjob;
+
+/*
+ * Number of bits set in a word
+ */
+static int
+bitCount(unsigned long x)
+{
+#ifdef __GNUC__
+    return __builtin_popcountl(x);
+#else
+    int             n;
+
+    for (n = 0; x != 0; n++)
+        x &= x - 1;
+    return n;
+#endif
+}
+
+/*
+ * Position of the lowest bit set in a word (not 0)
+ */
+static int
+lowBit(unsigned long x)
+{
+#ifdef __GNUC__
+    return __builtin_ctzl(x);
+#else
+    int             n;
+
+    for (n = 0; (x & 1) == 0; n++)
+        x >>= 1;
+    return n;
+#endif
+}
+
+/*
+ * Sliding window counts of the vote. The columns counts are the sky and
+ * cloud pixels of each column in the 2 nesi + 1 rows of the window, and
+ * the window counts the sky and cloud pixels in the 2 nesi + 1 columns
+ * around each pixel, so each pixel costs the same whatever the window
+ * size.
+ */
+typedef struct {
+    int             w, nesi;
+    int            *colsky, *colcld;
+    int            *winsky, *wincld;
+} votecount;
+
+/*
+ * Allocates the counts of rows of w pixels
+ */
+static void
+newVotes(votecount * vc, int w, int nesi)
+{
+    vc->w = w;
+    vc->nesi = nesi;
+    vc->colsky = (int *) malloc(4 * w * sizeof(int));
+    vc->colcld = vc->colsky + w;
+    vc->winsky = vc->colcld + w;
+    vc->wincld = vc->winsky + w;
+}
+
+/*
+ * Adds the pixels set in the plane add and not in the plane sub to the
+ * column counts col, and removes the pixels set in sub and not in add.
+ * The rows of the window change little from one to the next, so only a
+ * few pixels are visited. sub can be NULL (no pixel set).
+ */
+static void
+votePlane(int *col, const unsigned long *add, const unsigned long *sub,
+          int words)
+{
+    unsigned long   a, s, in, out;
+    int             k;
+
+    for (k = 0; k < words; k++) {
+        a = add[k];
+        s = (sub != NULL) ? sub[k] : 0;
+        for (in = a & ~s; in != 0; in &= in - 1)
+            col[k * SEGBITS + lowBit(in)]++;
+        for (out = s & ~a; out != 0; out &= out - 1)
+            col[k * SEGBITS + lowBit(out)]--;
+    }
+}
+
+/*
+ * Moves the column counts from the row sub to the row add. Each row is
+ * a sky plane followed by a cloud plane; sub can be NULL.
+ */
+static void
+voteRows(votecount * vc, const unsigned long *add, const unsigned long *sub)
+{
+    int             words = (vc->w + SEGBITS - 1) / SEGBITS;
+
+    votePlane(vc->colsky, add, sub, words);
+    votePlane(vc->colcld, add + words, (sub != NULL) ? sub + words : NULL,
+              words);
+}
+
+/*
+ * Adds (sign = 1) or removes (sign = -1) a segmented row to the column
+ * counts
+ */
+static void
+voteSegments(votecount * vc, const unsigned int *seg, int sign)
+{
+    int             j;
+
+    for (j = 0; j < vc->w; j++) {
+        vc->colsky[j] += sign * (seg[j] == SEGSKY);
+        vc->colcld[j] += sign * (seg[j] == SEGCLD);
+    }
+}
+
+/*
+ * Window sums of the columns nesi, ..., w - nesi - 1
+ */
+static void
+windowSums(const int *col, int w, int nesi, int *win)
+{
+    int             j, sum = 0;
+
+    if (w <= 2 * nesi)
+        return;
+    for (j = 0; j < 2 * nesi; j++)
+        sum += col[j];
+    for (j = nesi; j < w - nesi; j++) {
+        sum += col[j + nesi];
+        win[j] = sum;
+        sum -= col[j - nesi];
+    }
+}
+
+/*
+ * Updates the window counts once the column counts are complete
+ */
+static void
+slideVotes(votecount * vc)
+{
+    windowSums(vc->colsky, vc->w, vc->nesi, vc->winsky);
+    windowSums(vc->colcld, vc->w, vc->nesi, vc->wincld);
+}
+
+/*
+ * Packs a row of w pixel classes in a sky plane and a cloud plane
+ */
+static void
+packClasses(const unsigned char *cls, int w, unsigned long *sky,
+            unsigned long *cld)
+{
+    unsigned long   s, c;
+    int             j, k, b, n;
+
+    for (k = 0, j = 0; j < w; k++) {
+        s = c = 0;
+        n = (w - j < SEGBITS) ? w - j : SEGBITS;
+        for (b = 0; b < n; b++, j++) {
+            s |= (unsigned long) (cls[j] == CLSSKY) << b;
+            c |= (unsigned long) (cls[j] == CLSCLD) << b;
+        }
+        sky[k] = s;
+        cld[k] = c;
+    }
+}
+
+/*
+ * Packs a row of w pixels of a segmented image in an inside plane and a
+ * cloud plane
+ */
+static void
+packSegments(const unsigned int *seg, int w, unsigned long *in,
+             unsigned long *cld)
+{
+    unsigned long   s, c;
+    int             j, k, b, n;
+
+    for (k = 0, j = 0; j < w; k++) {
+        s = c = 0;
+        n = (w - j < SEGBITS) ? w - j : SEGBITS;
+        for (b = 0; b < n; b++, j++) {
+            s |= (unsigned long) ((seg[j] == SEGSKY) ||
+                                  (seg[j] == SEGCLD)) << b;
+            c |= (unsigned long) (seg[j] == SEGCLD) << b;
+        }
+        in[k] = s;
+        cld[k] = c;
+    }
+}
+
+/*
+ * Number of neighbors (the pixel itself included) whose class differs
+ * from the class c, sky or cloud, of the pixel at column j
+ */
+#define VOTES(vc, j, c) \
+    ((2 * (vc)->nesi + 1) * (2 * (vc)->nesi + 1) - \
+     (((c) == CLSSKY) ? (vc)->winsky[j] : (vc)->wincld[j]))
+
+/**
+ * \brief Builds the R/B classifier for the treshold of the parameters.
+ */
+void
+compileClassifier(SegParams * sp)
+{
+    int             r, b;
+
+    memset(sp->rbsky, 0, sizeof(sp->rbsky));
+    /*
+     * blue = 0 is never sky, so the column 0 stays clear
+     */
+    for (r = 0; r < 256; r++)
+        for (b = 1; b < 256; b++)
+            if ((double) r / (double) b < sp->rbtreshold)
+                sp->rbsky[r][b >> 5] |= 1U << (b & 31);
+    /*
+     * For each blue b the sky pixels are those with red below some limit
+     * r; the smallest of the fractions r / b is the exact treshold of
+     * the integer test. 256 / 1 if every pixel with blue > 0 is sky.
+     */
+    sp->rbnum = 256;
+    sp->rbden = 1;
+    for (b = 1; b < 256; b++) {
+        for (r = 0; (r < 256) && ISSKY(sp, r, b); r++);
+        if ((r < 256) && (r * sp->rbden < sp->rbnum * b)) {
+            sp->rbnum = r;
+            sp->rbden = b;
+        }
+    }
+    /*
+     * the kernels are chosen now, before any thread uses them
+     */
+    classifyKernel();
+}
+
+/**
+ * \brief Tells if the vote can change the class of some pixel.
+ */
+int
+votesFlip(SegParams * sp)
+{
+    int             side = 2 * (int) ((double) sp->neighbsize / 2.0) + 1;
+
+    return sp->votes2flip < side * side;
+}
+
+/*
+ * Weight category of a squared radial distance (in pixels of the full
+ * size image). Beyond the last limit the category is NUMCAT.
+ */
+static int
+radialCategory(double sqdist)
+{
+    int             c = catsearch(sqdist, categories, 0, NUMCAT - 1);
+
+    return (c < 0) ? NUMCAT : c;
+}
+
+/**
+ * \brief Builds the spans of a mask.
+ */
+int
+buildMaskSpans(SkyMask * sm)
+{
+    int             i, j, n = 0, size = 256, failed = 0;
+    int             rows = sm->bottom - sm->top;
+    int            *from, *to;
+
+    sm->rowspans = (int *) malloc((rows + 1) * sizeof(int));
+    sm->spanfrom = (int *) malloc(size * sizeof(int));
+    sm->spanto = (int *) malloc(size * sizeof(int));
+    if ((sm->rowspans == NULL) || (sm->spanfrom == NULL) ||
+        (sm->spanto == NULL))
+        failed = 1;
+    for (i = sm->top; (i < sm->bottom) && !failed; i++) {
+        sm->rowspans[i - sm->top] = n;
+        for (j = sm->left; j < sm->right; j++) {
+            if (sm->pix[i][j] == 0)
+                continue;
+            /*
+             * the pixel extends the last span of the row, or opens one
+             */
+            if ((n > sm->rowspans[i - sm->top]) && (sm->spanto[n - 1] == j)) {
+                sm->spanto[n - 1] = j + 1;
+                continue;
+            }
+            if (n == size) {
+                size *= 2;
+                /*
+                 * a block that was moved is kept even if the other one
+                 * cannot grow, so both can be freed
+                 */
+                from = (int *) realloc(sm->spanfrom, size * sizeof(int));
+                if (from != NULL)
+                    sm->spanfrom = from;
+                to = (int *) realloc(sm->spanto, size * sizeof(int));
+                if (to != NULL)
+                    sm->spanto = to;
+                if ((from == NULL) || (to == NULL)) {
+                    failed = 1;
+                    break;
+                }
+            }
+            sm->spanfrom[n] = j;
+            sm->spanto[n] = j + 1;
+            n++;
+        }
+    }
+    if (failed) {
+        free(sm->rowspans);
+        free(sm->spanfrom);
+        free(sm->spanto);
+        sm->rowspans = sm->spanfrom = sm->spanto = NULL;
+        return 0;
+    }
+    sm->rowspans[rows] = n;
+    return 1;
+}
+
+/**
+ * \brief Builds the radial weight map of a mask.
+ */
+int
+buildRadialMap(SkyMask * sm)
+{
+    double          sqdist, rcenter, ccenter;
+    double          sqscale = (double) sm->scale * sm->scale;
+    int             i, j, s, c, prev, n = 0, size = 256, failed = 0;
+    int             rows = sm->bottom - sm->top;
+    int            *from, *to, *cat;
+
+    if (sm->rowspans == NULL) {
+        sm->rowruns = sm->runfrom = sm->runto = sm->runcat = NULL;
+        return 0;
+    }
+    sm->rowruns = (int *) malloc((rows + 1) * sizeof(int));
+    sm->runfrom = (int *) malloc(size * sizeof(int));
+    sm->runto = (int *) malloc(size * sizeof(int));
+    sm->runcat = (int *) malloc(size * sizeof(int));
+    rcenter = (int) ((double) sm->height / 2.0);
+    ccenter = (int) ((double) sm->width / 2.0);
+    if ((sm->rowruns == NULL) || (sm->runfrom == NULL) ||
+        (sm->runto == NULL) || (sm->runcat == NULL))
+        failed = 1;
+    for (i = sm->top; (i < sm->bottom) && !failed; i++) {
+        sm->rowruns[i - sm->top] = n;
+        for (s = sm->rowspans[i - sm->top];
+             (s < sm->rowspans[i - sm->top + 1]) && !failed; s++) {
+            /*
+             * the runs do not cross the gaps between spans
+             */
+            prev = -1;
+            for (j = sm->spanfrom[s]; j < sm->spanto[s]; j++) {
+                sqdist = (i - rcenter) * (i - rcenter) +
+                    (j - ccenter) * (j - ccenter);
+                sqdist *= sqscale;
+                /*
+                 * the category of the previous pixel is checked first
+                 */
+                if ((prev >= 0) && (prev < NUMCAT) &&
+                    (sqdist <= categories[prev]) &&
+                    ((prev == 0) || (sqdist > categories[prev - 1])))
+                    c = prev;
+                else
+                    c = radialCategory(sqdist);
+                if (c == prev) {
+                    sm->runto[n - 1] = j + 1;
+                    continue;
+                }
+                if (n == size) {
+                    size *= 2;
+                    /*
+                     * a block that was moved is kept even if another
+                     * one cannot grow, so all of them can be freed
+                     */
+                    from = (int *) realloc(sm->runfrom, size * sizeof(int));
+                    if (from != NULL)
+                        sm->runfrom = from;
+                    to = (int *) realloc(sm->runto, size * sizeof(int));
+                    if (to != NULL)
+                        sm->runto = to;
+                    cat = (int *) realloc(sm->runcat, size * sizeof(int));
+                    if (cat != NULL)
+                        sm->runcat = cat;
+                    if ((from == NULL) || (to == NULL) || (cat == NULL)) {
+                        failed = 1;
+                        break;
+                    }
+                }
+                sm->runfrom[n] = j;
+                sm->runto[n] = j + 1;
+                sm->runcat[n] = c;
+                n++;
+                prev = c;
+            }
+        }
+    }
+    if (failed) {
+        free(sm->rowruns);
+        free(sm->runfrom);
+        free(sm->runto);
+        free(sm->runcat);
+        sm->rowruns = sm->runfrom = sm->runto = sm->runcat = NULL;
+        return 0;
+    }
+    sm->rowruns[rows] = n;
+    return 1;
+}
+
+/*
+ * Finds the bounding box of the interest region, and divides the mask
+ * rows in nbands bands with a similar number of pixels inside it
+ */
+static void
+maskBands(SkyMask * sm, int nbands)
+{
+    int            *weight;
+    int             i, j;
+
+    /*
+     * the weight of each row is its number of opaque pixels
+     */
+    weight = (int *) calloc(sm->height, sizeof(int));
+    sm->top = sm->left = 0;
+    sm->bottom = sm->right = -1;
+    for (i = 0; i < sm->height; i++)
+        for (j = 0; j < sm->width; j++) {
+            if (sm->pix[i][j] & 0XFF000000)
+                weight[i]++;
+            if (sm->pix[i][j] == 0)
+                continue;
+            if (sm->bottom < 0) {
+                sm->top = i;
+                sm->left = sm->right = j;
+            }
+            sm->bottom = i;
+            if (j < sm->left)
+                sm->left = j;
+            if (j > sm->right)
+                sm->right = j;
+        }
+    /*
+     * limits are exclusive (empty box if no pixel inside)
+     */
+    sm->bottom++;
+    sm->right++;
+    if (sm->bottom == 0)
+        sm->right = 0;
+    sm->nbands = nbands;
+    sm->bounds = (int *) malloc((nbands + 1) * sizeof(int));
+    partitionRows(weight, sm->height, nbands, sm->bounds);
+    free(weight);
+    buildMaskSpans(sm);
+    buildRadialMap(sm);
+}
+
+/**
+ * \brief Reads the mask from a PNG file.
+ */
+int
+loadSkyMask(char *fname, int nbands, SkyMask * sm)
+{
+    sm->pix = readPNGImage(fname, &sm->width, &sm->height);
+    if (sm->pix == NULL)
+        return 0;
+    sm->scale = 1;
+    maskBands(sm, nbands);
+    return 1;
+}
+
+/**
+ * \brief Builds a reduced copy of a mask.
+ */
+int
+scaleSkyMask(SkyMask * src, int scale, SkyMask * dst)
+{
+    int             i, j, c = scale / 2;
+
+    dst->width = src->width / scale;
+    dst->height = src->height / scale;
+    if ((scale < 1) || (dst->width < 1) || (dst->height < 1))
+        return 0;
+    dst->pix = newImage(dst->width, dst->height);
+    /*
+     * each pixel takes the value of the center of its block
+     */
+    for (i = 0; i < dst->height; i++)
+        for (j = 0; j < dst->width; j++)
+            dst->pix[i][j] = src->pix[i * scale + c][j * scale + c];
+    dst->scale = src->scale * scale;
+    maskBands(dst, src->nbands);
+    return 1;
+}
+
+/**
+ * \brief Releases the memory used by a mask.
+ */
+void
+freeSkyMask(SkyMask * sm)
+{
+    freeImage(sm->pix);
+    free(sm->bounds);
+    free(sm->rowspans);
+    free(sm->spanfrom);
+    free(sm->spanto);
+    free(sm->rowruns);
+    free(sm->runfrom);
+    free(sm->runto);
+    free(sm->runcat);
+    sm->pix = NULL;
+    sm->bounds = NULL;
+    sm->rowspans = sm->spanfrom = sm->spanto = NULL;
+    sm->rowruns = sm->runfrom = sm->runto = sm->runcat = NULL;
+}
+
+/**
+ * \brief Determines the weight factor used for a given pixel.
+ */
+int
+catsearch(double t, const int carr[], int low, int upp)
+{
+    int             l, u, m;
+
+    if ((low < upp) && (carr != NULL)) {
+        l = low;
+        u = upp;
+        while (l <= u) {
+            m = (int) ((l + u) / 2);
+            if (carr[m] < t)
+                l = m + 1;
+            else if (carr[m] > t)
+                u = m - 1;
+            else
+                return m;
+        }
+        if (l <= upp)
+            return l;
+    }
+    return -1;
+}
+
+/**
+ * \brief Allocates an empty segmented image.
+ */
+SegImage       *
+newSegImage(int width, int height)
+{
+    return newPooledSegImage(NULL, width, height);
+}
+
+/**
+ * \brief Takes an empty segmented image from a pool.
+ */
+SegImage       *
+newPooledSegImage(BufPool * bp, int width, int height)
+{
+    SegImage       *seg = (SegImage *) malloc(sizeof(SegImage));
+    size_t          n;
+
+    if (seg == NULL)
+        return NULL;
+    seg->width = width;
+    seg->height = height;
+    seg->words = (width + SEGBITS - 1) / SEGBITS;
+    seg->pool = bp;
+    n = (size_t) seg->words * height;
+    seg->inside = (unsigned long *) takeBuffer(bp, 2 * n *
+                                                sizeof(unsigned long));
+    if (seg->inside == NULL) {
+        free(seg);
+        return NULL;
+    }
+    memset(seg->inside, 0, 2 * n * sizeof(unsigned long));
+    seg->cloud = seg->inside + n;
+    return seg;
+}
+
+/**
+ * \brief Releases the memory used by a segmented image.
+ */
+void
+freeSegImage(SegImage * seg)
+{
+    if (seg == NULL)
+        return;
+    giveBuffer(seg->pool, seg->inside);
+    free(seg);
+}
+
+/**
+ * \brief Value of a pixel of a segmented image.
+ */
+unsigned int
+segPixel(SegImage * seg, int i, int j)
+{
+    size_t          k = (size_t) i * seg->words + j / SEGBITS;
+    unsigned long   bit = 1UL << (j % SEGBITS);
+
+    if (!(seg->inside[k] & bit))
+        return SEGOUT;
+    return (seg->cloud[k] & bit) ? SEGCLD : SEGSKY;
+}
+
+/*
+ * Row i of a segmented image in ARGB format
+ */
+static const unsigned int *
+segRow(void *arg, int i, unsigned int *buf)
+{
+    SegImage       *seg = (SegImage *) arg;
+    int             j;
+
+    for (j = 0; j < seg->width; j++)
+        buf[j] = segPixel(seg, i, j);
+    return buf;
+}
+
+/**
+ * \brief Converts a segmented image to the ARGB format.
+ */
+unsigned int  **
+segToImage(SegImage * seg)
+{
+    unsigned int  **img = newImage(seg->width, seg->height);
+    int             i;
+
+    if (img == NULL)
+        return NULL;
+    for (i = 0; i < seg->height; i++)
+        segRow(seg, i, img[i]);
+    return img;
+}
+
+/*
+ * Palette of the segmented images: outside, sky and cloud
+ */
+static const unsigned int segpalette[3] = { SEGOUT, SEGSKY, SEGCLD };
+
+/*
+ * The 4 bits of a nibble (pixel k in bit k) spread as the low bits of
+ * four 2 bit pixels (pixel k in bit 6 - 2k), as the PNG format packs them
+ */
+static const unsigned char spread2[16] = {
+    0X00, 0X40, 0X10, 0X50, 0X04, 0X44, 0X14, 0X54,
+    0X01, 0X41, 0X11, 0X51, 0X05, 0X45, 0X15, 0X55
+};
+
+/*
+ * Row i of a segmented image as 2 bit palette indices, four pixels per
+ * byte (SEGBITS is a multiple of 4, so a nibble never crosses a word)
+ */
+static const unsigned char *
+segIndexRow(void *arg, int i, unsigned char *buf)
+{
+    SegImage       *seg = (SegImage *) arg;
+    const unsigned long *in = seg->inside + (size_t) i * seg->words;
+    const unsigned long *cld = seg->cloud + (size_t) i * seg->words;
+    unsigned long   sky;
+    int             m, j, k, sh;
+
+    for (m = 0; m < (seg->width + 3) / 4; m++) {
+        j = 4 * m;
+        k = j / SEGBITS;
+        sh = j % SEGBITS;
+        sky = in[k] & ~cld[k];
+        buf[m] = spread2[(sky >> sh) & 0XF] |
+            (spread2[(cld[k] >> sh) & 0XF] << 1);
+    }
+    return buf;
+}
+
+/**
+ * \brief Writes a segmented image to a PNG file.
+ */
+int
+writeSegImage(SegImage * seg, char *fname)
+{
+    return writeParallelSegImage(seg, fname, 1);
+}
+
+/**
+ * \brief Writes a segmented image to a PNG file, compressed by several
+ * threads.
+ */
+int
+writeParallelSegImage(SegImage * seg, char *fname, int nthreads)
+{
+    return writeParallelPNGPalette(fname, seg->width, seg->height, 2,
+                                   segpalette, 3, segIndexRow, seg, nthreads);
+}
+
+/*
+ * Spans of the row i of a mask: s0, ..., s1 - 1 (none out of the bounding
+ * box)
+ */
+static void
+rowSpans(SkyMask * sm, int i, int *s0, int *s1)
+{
+    if ((i < sm->top) || (i >= sm->bottom)) {
+        *s0 = *s1 = 0;
+        return;
+    }
+    *s0 = sm->rowspans[i - sm->top];
+    *s1 = sm->rowspans[i - sm->top + 1];
+}
+
+/**
+ * \brief Read an image from a JPEG file and cuts it to the size of a given
+ * mask.
+ */
+unsigned int  **
+readAndCut(char *fname, SkyMask * sm, int *wd, int *hg)
+{
+    int             wi, hi, i, s, s0, s1, a, mv, mh;
+    unsigned int  **img = readJPGImage(fname, &wi, &hi);
+    unsigned int  **res;
+
+    /*
+     * corrupted image, or smaller than the mask
+     */
+    if (img == NULL)
+        return NULL;
+    if ((wi < sm->width) || (hi < sm->height)) {
+        freeImage(img);
+        return NULL;
+    }
+    res = newImage(sm->width, sm->height);
+    mh = (int) ((double) wi - (double) sm->width) / 2.0;
+    mv = (int) ((double) hi - (double) sm->height) / 2.0;
+    for (i = 0; i < sm->height; i++) {
+        memset(res[i], 0, sm->width * sizeof(unsigned int));
+        rowSpans(sm, i, &s0, &s1);
+        for (s = s0; s < s1; s++) {
+            a = sm->spanfrom[s];
+            cutRow(sm->pix[i] + a, img[i + mv] + mh + a, sm->spanto[s] - a,
+                   res[i] + a);
+        }
+    }
+    freeImage(img);
+    *wd = sm->width;
+    *hg = sm->height;
+    return res;
+}
+
+/*
+ * R/B classification of a band of rows
+ */
+static void
+filterRBBand(void *arg, int id)
+{
+    bandjob        *bj = (bandjob *) arg;
+    unsigned int  **img = bj->in, **res = bj->out;
+    unsigned char  *cls = (unsigned char *) malloc(bj->w);
+    int             i, j, s, s0, s1, a, n;
+
+    for (i = bj->sm->bounds[id]; i < bj->sm->bounds[id + 1]; i++) {
+        memset(res[i], 0, bj->w * sizeof(unsigned int));
+        rowSpans(bj->sm, i, &s0, &s1);
+        for (s = s0; s < s1; s++) {
+            /*
+             * the image is already trimmed, it is its own mask
+             */
+            a = bj->sm->spanfrom[s];
+            n = bj->sm->spanto[s] - a;
+            classifyARGB(img[i] + a, img[i] + a, n, bj->sp->rbnum,
+                         bj->sp->rbden, cls, NULL);
+            for (j = 0; j < n; j++)
+                res[i][a + j] = segval[cls[j]];
+        }
+    }
+    free(cls);
+}
+
+/**
+ * \brief Classify the image pixels in two different cathegories (sky and
+ * cloud).
+ */
+unsigned int  **
+filterRB(double thr, unsigned int **img, SkyMask * sm)
+{
+    bandjob         bj;
+    SegParams       sp;
+
+    sp.rbtreshold = thr;
+    compileClassifier(&sp);
+    bj.in = img;
+    bj.out = newImage(sm->width, sm->height);
+    bj.w = sm->width;
+    bj.h = sm->height;
+    bj.sm = sm;
+    bj.sp = &sp;
+    runThreads(sm->nbands, filterRBBand, &bj);
+    return bj.out;
+}
+
+/*
+ * Convolution of a band of rows
+ */
+static void
+convolutionBand(void *arg, int id)
+{
+    bandjob        *bj = (bandjob *) arg;
+    unsigned int  **img = bj->in, **res = bj->out;
+    unsigned int    pelcolor;
+    int             i, j, n, nv, w = bj->w, h = bj->h, valid = -1;
+    int             s, s0, s1, a, b;
+    int             nesi = (int) ((double) bj->sp->neighbsize / 2.0);
+    votecount       vc;
+
+    newVotes(&vc, w, nesi);
+    for (i = bj->sm->bounds[id]; i < bj->sm->bounds[id + 1]; i++) {
+        if ((i < nesi) || (i >= h - nesi)) {
+            memset(res[i], 0, w * sizeof(unsigned int));
+            continue;
+        }
+        /*
+         * the window moves one row down, or is counted from scratch
+         */
+        if (valid == i - 1) {
+            voteSegments(&vc, img[i - 1 - nesi], -1);
+            voteSegments(&vc, img[i + nesi], 1);
+        } else {
+            memset(vc.colsky, 0, 2 * w * sizeof(int));
+            for (n = i - nesi; n <= i + nesi; n++)
+                voteSegments(&vc, img[n], 1);
+        }
+        valid = i;
+        slideVotes(&vc);
+        memset(res[i], 0, w * sizeof(unsigned int));
+        rowSpans(bj->sm, i, &s0, &s1);
+        for (s = s0; s < s1; s++) {
+            a = (bj->sm->spanfrom[s] < nesi) ? nesi : bj->sm->spanfrom[s];
+            b = (bj->sm->spanto[s] > w - nesi) ? w - nesi : bj->sm->spanto[s];
+            for (j = a; j < b; j++) {
+                pelcolor = img[i][j];
+                if (pelcolor == SEGOUT)
+                    continue;
+                nv = VOTES(&vc, j, (pelcolor == SEGSKY) ? CLSSKY : CLSCLD);
+                if (nv >= bj->sp->votes2flip)
+                    res[i][j] = 0XFF000000 | ~pelcolor;
+                else
+                    res[i][j] = pelcolor;
+            }
+        }
+    }
+    free(vc.colsky);
+}
+
+/**
+ * \brief Convolution operator to smooth borderline.
+ */
+unsigned int  **
+convolution(int sdsz, int mv, unsigned int **img, SkyMask * sm)
+{
+    bandjob         bj;
+    SegParams       sp;
+
+    sp.neighbsize = sdsz;
+    sp.votes2flip = mv;
+    bj.in = img;
+    bj.out = newImage(sm->width, sm->height);
+    bj.w = sm->width;
+    bj.h = sm->height;
+    bj.sm = sm;
+    bj.sp = &sp;
+    runThreads(sm->nbands, convolutionBand, &bj);
+    return bj.out;
+}
+
+/*
+ * Number of bits set in the bits a, ..., b - 1 of a plane
+ */
+static long
+rangeCount(const unsigned long *p, int a, int b)
+{
+    unsigned long   first, last;
+    int             ka, kb, k;
+    long            n;
+
+    if (a >= b)
+        return 0;
+    ka = a / SEGBITS;
+    kb = (b - 1) / SEGBITS;
+    first = ~0UL << (a % SEGBITS);
+    last = ~0UL >> (SEGBITS - 1 - (b - 1) % SEGBITS);
+    if (ka == kb)
+        return bitCount(p[ka] & first & last);
+    n = bitCount(p[ka] & first) + bitCount(p[kb] & last);
+    for (k = ka + 1; k < kb; k++)
+        n += bitCount(p[k]);
+    return n;
+}
+
+/*
+ * Pixel counting of a row of the segmented image, given as an inside
+ * plane and a cloud plane. The pixels of each run of the radial map are
+ * added to the counters of its category: hist[c] counts the pixels of
+ * category c and hist[NUMBINS + c] the cloud ones.
+ */
+static void
+countRow(bandjob * bj, int i, const unsigned long *in,
+         const unsigned long *cld, long *hist)
+{
+    SkyMask        *sm = bj->sm;
+    int             r, c;
+
+    if ((i < sm->top) || (i >= sm->bottom))
+        return;
+    for (r = sm->rowruns[i - sm->top]; r < sm->rowruns[i - sm->top + 1];
+         r++) {
+        c = sm->runcat[r];
+        hist[c] += rangeCount(in, sm->runfrom[r], sm->runto[r]);
+        hist[NUMBINS + c] += rangeCount(cld, sm->runfrom[r], sm->runto[r]);
+    }
+}
+
+/*
+ * Weighted pixel counting of a band of rows
+ */
+static void
+ccindexBand(void *arg, int id)
+{
+    bandjob        *bj = (bandjob *) arg;
+    int             i, words = (bj->w + SEGBITS - 1) / SEGBITS;
+    unsigned long  *in;
+
+    in = (unsigned long *) malloc(2 * words * sizeof(unsigned long));
+    for (i = bj->sm->bounds[id]; i < bj->sm->bounds[id + 1]; i++) {
+        packSegments(bj->in[i], bj->w, in, in + words);
+        countRow(bj, i, in, in + words, bj->hist + id * 2 * NUMBINS);
+    }
+    free(in);
+}
+
+/*
+ * Adds the counters of the nbands bands and weights each category with
+ * its factor. The counters are integers, so the result does not depend on
+ * the order of the pixels nor on the number of threads. The pixels beyond
+ * the last category limit are counted with weight 0. The stage times of
+ * the bands, if any, are added too.
+ */
+static double
+addCounts(bandjob * bj, int nbands, CCIResult * ccr)
+{
+    double          total = 0.0, clouds = 0.0;
+    long            pels = 0, catpels, catclouds;
+    int             c, k;
+
+    for (c = 0; c < NUMBINS; c++) {
+        catpels = catclouds = 0;
+        for (k = 0; k < nbands; k++) {
+            catpels += bj->hist[k * 2 * NUMBINS + c];
+            catclouds += bj->hist[k * 2 * NUMBINS + NUMBINS + c];
+        }
+        pels += catpels;
+        if (c == NUMCAT)
+            continue;
+        total += factors[c] * catpels;
+        clouds += factors[c] * catclouds;
+    }
+    ccr->totalarea = total;
+    ccr->totalpels = (int) pels;
+    ccr->ccindex = clouds / total;
+    ccr->classifytime = ccr->votetime = ccr->counttime = 0.0;
+    for (k = 0; (bj->times != NULL) && (k < nbands); k++) {
+        ccr->classifytime += bj->times[3 * k];
+        ccr->votetime += bj->times[3 * k + 1];
+        ccr->counttime += bj->times[3 * k + 2];
+    }
+    return ccr->ccindex;
+}
+
+/**
+ * \brief Calculate the Cloud Cover Index.
+ */
+double
+cloudcoverindex(unsigned int **img, SkyMask * sm, CCIResult * ccr)
+{
+    bandjob         bj;
+
+    bj.in = img;
+    bj.w = sm->width;
+    bj.h = sm->height;
+    bj.sm = sm;
+    bj.hist = (long *) calloc(sm->nbands * 2 * NUMBINS, sizeof(long));
+    bj.times = NULL;
+    runThreads(sm->nbands, ccindexBand, &bj);
+    addCounts(&bj, sm->nbands, ccr);
+    free(bj.hist);
+    return ccr->ccindex;
+}
+
+/*
+ * Pointers to the color planes of the image row that corresponds to the
+ * row i of the mask, from the column sm->left on. Only the rows of the
+ * mask bounding box are used. In streaming mode the rows above are
+ * skipped and the rows are read until the required one, 0 is returned
+ * if it cannot be read.
+ */
+static int
+planeRow(bandjob * bj, int i, unsigned char **red, unsigned char **green,
+         unsigned char **blue)
+{
+    int             r = i + bj->mv;
+    size_t          off;
+
+    if (bj->jr == NULL) {
+        off = (size_t) (i - bj->sm->top) * bj->reg->width;
+        *red = bj->reg->red + off;
+        *green = bj->reg->green + off;
+        *blue = bj->reg->blue + off;
+        return 1;
+    }
+    if (bj->lastrow < r - 1) {
+        if (!skipJPGRows(bj->jr, r - 1 - bj->lastrow))
+            return 0;
+        bj->lastrow = r - 1;
+    }
+    while (bj->lastrow < r) {
+        if (!readJPGPlanes(bj->jr, bj->lred, bj->lgreen, bj->lblue))
+            return 0;
+        bj->lastrow++;
+    }
+    *red = bj->lred + bj->xskip;
+    *green = bj->lgreen + bj->xskip;
+    *blue = bj->lblue + bj->xskip;
+    return 1;
+}
+
+/*
+ * Cuts and classifies the row i of the mask region. The trimmed row is
+ * stored if cut is not NULL. Only the spans of the mask are classified,
+ * the rest of the row is outside the interest region.
+ */
+static int
+classifyRow(bandjob * bj, int i, unsigned char *cls, unsigned int *cut)
+{
+    SkyMask        *sm = bj->sm;
+    unsigned char  *red, *green, *blue;
+    int             s, s0, s1, a, n;
+
+    memset(cls, CLSOUT, bj->w);
+    if (cut != NULL)
+        memset(cut, 0, bj->w * sizeof(unsigned int));
+    rowSpans(sm, i, &s0, &s1);
+    if (s0 == s1)
+        return 1;
+    /*
+     * the rows of the image start at the column sm->left
+     */
+    if (bj->rows != NULL) {
+        for (s = s0; s < s1; s++) {
+            a = sm->spanfrom[s];
+            n = sm->spanto[s] - a;
+            classifyARGB(sm->pix[i] + a,
+                         bj->rows[i - sm->top] + a - sm->left, n,
+                         bj->sp->rbnum, bj->sp->rbden, cls + a,
+                         (cut != NULL) ? cut + a : NULL);
+        }
+        return 1;
+    }
+    if (!planeRow(bj, i, &red, &green, &blue))
+        return 0;
+    for (s = s0; s < s1; s++) {
+        a = sm->spanfrom[s];
+        n = sm->spanto[s] - a;
+        classifyPlanar(sm->pix[i] + a, red + a - sm->left,
+                       green + a - sm->left, blue + a - sm->left, n,
+                       bj->sp->rbnum, bj->sp->rbden, cls + a,
+                       (cut != NULL) ? cut + a : NULL);
+    }
+    return 1;
+}
+
+/*
+ * Fused process of the rows r0, ..., r1 - 1. The classified rows are
+ * kept in a ring of 2 nesi + 2 rows: the vote window of row r and the
+ * row that leaves it when the window moves down. Each row of the ring is
+ * a sky plane followed by a cloud plane. The nesi rows above and below
+ * the band are classified by both neighbor threads. The pixels are
+ * counted in hist (see countRow), and the time of each stage is added to
+ * times (classification, votes and counting). Returns 0 if some image
+ * row cannot be read or there is not enough memory.
+ */
+static int
+segmentRows(bandjob * bj, int r0, int r1, long *hist, double *times)
+{
+    int             mvotes = bj->sp->votes2flip;
+    int             nesi = (int) ((double) bj->sp->neighbsize / 2.0);
+    int             nring = 2 * nesi + 2;
+    int             w = bj->w, h = bj->h;
+    int             words = (w + SEGBITS - 1) / SEGBITS;
+    int             i, j, k, n, c, s, s0, s1, a, b, next, valid = -1, ok = 1;
+    unsigned long   in, bit, *ring, *sky, *cld, *segin, *segcld;
+    unsigned char  *cls;
+    unsigned int   *cutrow;
+    votecount       vc;
+    double          t0, t1;
+
+    if (r0 >= r1)
+        return 1;
+    ring = (unsigned long *) malloc(nring * 2 * words *
+                                    sizeof(unsigned long));
+    cls = (unsigned char *) malloc(w);
+    newVotes(&vc, w, nesi);
+    segin = segcld = NULL;
+    if (bj->seg == NULL) {
+        segin = (unsigned long *) malloc(2 * words * sizeof(unsigned long));
+        segcld = segin + words;
+    }
+    if ((ring == NULL) || (cls == NULL) || (vc.colsky == NULL) ||
+        ((bj->seg == NULL) && (segin == NULL)))
+        ok = 0;
+    next = (r0 - nesi < 0) ? 0 : r0 - nesi;
+    for (i = r0; ok && (i < r1); i++) {
+        t0 = wallClock();
+        /*
+         * classify every row needed by the neighborhoods of row i
+         */
+        for (; ok && (next <= i + nesi) && (next < h); next++) {
+            cutrow = ((bj->cut != NULL) && (next >= r0) && (next < r1)) ?
+                bj->cut[next] : NULL;
+            ok = classifyRow(bj, next, cls, cutrow);
+            sky = ring + (next % nring) * 2 * words;
+            packClasses(cls, w, sky, sky + words);
+        }
+        t1 = wallClock();
+        times[0] += t1 - t0;
+        if (!ok)
+            break;
+        if (bj->seg != NULL) {
+            segin = bj->seg->inside + (size_t) i * words;
+            segcld = bj->seg->cloud + (size_t) i * words;
+        }
+        memset(segin, 0, words * sizeof(unsigned long));
+        memset(segcld, 0, words * sizeof(unsigned long));
+        if ((i < nesi) || (i >= h - nesi)) {
+            countRow(bj, i, segin, segcld, hist);
+            times[2] += wallClock() - t1;
+            continue;
+        }
+        /*
+         * the window moves one row down, or is counted from scratch
+         */
+        if (valid == i - 1)
+            voteRows(&vc, ring + ((i + nesi) % nring) * 2 * words,
+                     ring + ((i - 1 - nesi) % nring) * 2 * words);
+        else {
+            memset(vc.colsky, 0, 2 * w * sizeof(int));
+            for (n = i - nesi; n <= i + nesi; n++)
+                voteRows(&vc, ring + (n % nring) * 2 * words, NULL);
+        }
+        valid = i;
+        slideVotes(&vc);
+        sky = ring + (i % nring) * 2 * words;
+        cld = sky + words;
+        rowSpans(bj->sm, i, &s0, &s1);
+        for (s = s0; s < s1; s++) {
+            a = (bj->sm->spanfrom[s] < nesi) ? nesi : bj->sm->spanfrom[s];
+            b = (bj->sm->spanto[s] > w - nesi) ? w - nesi : bj->sm->spanto[s];
+            if (a >= b)
+                continue;
+            /*
+             * only the sky and cloud pixels of the span are visited
+             */
+            for (k = a / SEGBITS; k <= (b - 1) / SEGBITS; k++) {
+                in = sky[k] | cld[k];
+                if (k == a / SEGBITS)
+                    in &= ~0UL << (a % SEGBITS);
+                if (k == (b - 1) / SEGBITS)
+                    in &= ~0UL >> (SEGBITS - 1 - (b - 1) % SEGBITS);
+                segin[k] |= in;
+                for (; in != 0; in &= in - 1) {
+                    bit = in & ~(in - 1);
+                    j = k * SEGBITS + lowBit(in);
+                    c = (sky[k] & bit) ? CLSSKY : CLSCLD;
+                    /*
+                     * flipping swaps sky and cloud
+                     */
+                    if (VOTES(&vc, j, c) >= mvotes)
+                        c = CLSSKY + CLSCLD - c;
+                    if (c == CLSCLD)
+                        segcld[k] |= bit;
+                }
+            }
+        }
+        t0 = wallClock();
+        times[1] += t0 - t1;
+        countRow(bj, i, segin, segcld, hist);
+        times[2] += wallClock() - t0;
+    }
+    free(ring);
+    free(cls);
+    free(vc.colsky);
+    if (bj->seg == NULL)
+        free(segin);
+    return ok;
+}
+
+/*
+ * Fused process of a band of rows
+ */
+static void
+segmentBand(void *arg, int id)
+{
+    bandjob        *bj = (bandjob *) arg;
+
+    bj->bandok[id] = segmentRows(bj, bj->sm->bounds[id],
+                                 bj->sm->bounds[id + 1],
+                                 bj->hist + id * 2 * NUMBINS,
+                                 bj->times + id * 3);
+}
+
+/*
+ * Whether all the bands were processed
+ */
+static int
+bandsDone(bandjob * bj)
+{
+    int             k;
+
+    for (k = 0; k < bj->sm->nbands; k++)
+        if (!bj->bandok[k])
+            return 0;
+    return 1;
+}
+
+/*
+ * Releases the counters of the fused processes
+ */
+static void
+freeJob(bandjob * bj)
+{
+    free(bj->hist);
+    free(bj->times);
+    free(bj->bandok);
+    bj->hist = NULL;
+    bj->times = NULL;
+    bj->bandok = NULL;
+}
+
+/*
+ * Common setup of the fused processes. Returns 0 if there is not enough
+ * memory for the counters (nothing is left allocated).
+ */
+static int
+setupJob(bandjob * bj, int wi, int hi, SkyMask * sm, SegParams * sp,
+         unsigned int **cut, SegImage * seg)
+{
+    bj->in = NULL;
+    bj->rows = NULL;
+    bj->reg = NULL;
+    bj->jr = NULL;
+    bj->lred = bj->lgreen = bj->lblue = NULL;
+    bj->lastrow = -1;
+    bj->xskip = 0;
+    bj->out = NULL;
+    bj->seg = seg;
+    bj->cut = cut;
+    bj->w = sm->width;
+    bj->h = sm->height;
+    bj->mh = (int) ((double) wi - (double) sm->width) / 2.0;
+    bj->mv = (int) ((double) hi - (double) sm->height) / 2.0;
+    bj->sm = sm;
+    bj->sp = sp;
+    bj->hist = (long *) calloc(sm->nbands * 2 * NUMBINS, sizeof(long));
+    bj->times = (double *) calloc(sm->nbands * 3, sizeof(double));
+    bj->bandok = (int *) calloc(sm->nbands, sizeof(int));
+    if ((bj->hist == NULL) || (bj->times == NULL) || (bj->bandok == NULL)) {
+        freeJob(bj);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * \brief Cuts, classifies, smooths and counts the pixels of an image in a
+ * single pass.
+ */
+int
+segmentImage(unsigned int **img, int wi, int hi, SkyMask * sm,
+             SegParams * sp, unsigned int **cut, SegImage * seg,
+             CCIResult * ccr)
+{
+    bandjob         bj;
+    int             i, ok;
+
+    if ((wi < sm->width) || (hi < sm->height))
+        return 0;
+    if (!setupJob(&bj, wi, hi, sm, sp, cut, seg))
+        return 0;
+    /*
+     * the rows of the bounding box, without copying them
+     */
+    bj.rows = (unsigned int **) malloc((sm->bottom - sm->top + 1) *
+                                       sizeof(unsigned int *));
+    if (bj.rows == NULL) {
+        freeJob(&bj);
+        return 0;
+    }
+    for (i = sm->top; i < sm->bottom; i++)
+        bj.rows[i - sm->top] = img[i + bj.mv] + bj.mh + sm->left;
+    runThreads(sm->nbands, segmentBand, &bj);
+    ok = bandsDone(&bj);
+    if (ok)
+        addCounts(&bj, sm->nbands, ccr);
+    free(bj.rows);
+    freeJob(&bj);
+    return ok;
+}
+
+/**
+ * \brief Reads only the part of an image inside the mask bounding box.
+ */
+PlanarImage    *
+readMaskRegion(JPGReader * jr, int wi, int hi, SkyMask * sm, BufPool * bp)
+{
+    PlanarImage    *reg;
+    unsigned char  *red, *green, *blue;
+    int             i, mh, mv, xoff, cw, skip;
+    int             rw = sm->right - sm->left, rh = sm->bottom - sm->top;
+    size_t          off;
+
+    if ((wi < sm->width) || (hi < sm->height))
+        return NULL;
+    mh = (int) ((double) wi - (double) sm->width) / 2.0;
+    mv = (int) ((double) hi - (double) sm->height) / 2.0;
+    reg = newPooledPlanarImage(bp, rw, rh, 1);
+    if ((reg == NULL) || (rh == 0))
+        return reg;
+    /*
+     * only the columns and rows of the box are decompressed
+     */
+    xoff = mh + sm->left;
+    cw = rw;
+    if (!cropJPGReader(jr, &xoff, &cw) || !skipJPGRows(jr, mv + sm->top)) {
+        freePlanarImage(reg);
+        return NULL;
+    }
+    skip = mh + sm->left - xoff;
+    red = (unsigned char *) malloc(cw);
+    green = (unsigned char *) malloc(cw);
+    blue = (unsigned char *) malloc(cw);
+    if ((red == NULL) || (green == NULL) || (blue == NULL)) {
+        freePlanarImage(reg);
+        reg = NULL;
+        rh = 0;                 /* no row is read */
+    }
+    for (i = 0; i < rh; i++) {
+        if (!readJPGPlanes(jr, red, green, blue)) {
+            freePlanarImage(reg);
+            reg = NULL;
+            break;
+        }
+        off = (size_t) i * rw;
+        memcpy(reg->red + off, red + skip, rw);
+        memcpy(reg->green + off, green + skip, rw);
+        memcpy(reg->blue + off, blue + skip, rw);
+    }
+    free(red);
+    free(green);
+    free(blue);
+    return reg;
+}
+
+/**
+ * \brief Cuts, classifies, smooths and counts the pixels of the mask
+ * bounding box of an image.
+ */
+int
+segmentRegion(PlanarImage * reg, SkyMask * sm, SegParams * sp,
+              unsigned int **cut, SegImage * seg, CCIResult * ccr)
+{
+    bandjob         bj;
+    int             ok;
+
+    if (!setupJob(&bj, sm->width, sm->height, sm, sp, cut, seg))
+        return 0;
+    bj.reg = reg;
+    runThreads(sm->nbands, segmentBand, &bj);
+    ok = bandsDone(&bj);
+    if (ok)
+        addCounts(&bj, sm->nbands, ccr);
+    freeJob(&bj);
+    return ok;
+}
+
+/**
+ * \brief Cuts, classifies, smooths and counts the pixels of an image
+ * while it is read.
+ */
+int
+segmentStream(JPGReader * jr, int wi, int hi, SkyMask * sm,
+              SegParams * sp, unsigned int **cut, SegImage * seg,
+              CCIResult * ccr)
+{
+    bandjob         bj;
+    int             ok = 1, xoff, cw;
+
+    if ((wi < sm->width) || (hi < sm->height))
+        return 0;
+    if (!setupJob(&bj, wi, hi, sm, sp, cut, seg))
+        return -1;
+    bj.jr = jr;
+    /*
+     * only the columns of the mask bounding box are decompressed
+     */
+    xoff = bj.mh + sm->left;
+    cw = sm->right - sm->left;
+    if (cw > 0) {
+        ok = cropJPGReader(jr, &xoff, &cw);
+        bj.xskip = bj.mh + sm->left - xoff;
+        bj.lred = (unsigned char *) malloc(cw);
+        bj.lgreen = (unsigned char *) malloc(cw);
+        bj.lblue = (unsigned char *) malloc(cw);
+        if ((bj.lred == NULL) || (bj.lgreen == NULL) || (bj.lblue == NULL))
+            ok = 0;
+    }
+    if (ok)
+        ok = segmentRows(&bj, 0, bj.h, bj.hist, bj.times);
+    if (ok)
+        addCounts(&bj, sm->nbands, ccr);
+    free(bj.lred);
+    free(bj.lgreen);
+    free(bj.lblue);
+    freeJob(&bj);
+    return ok ? 1 : -1;
+}
+
+/*
+ * R/B bins of a band of rows: the pixels of category c are counted in
+ * hist[c * SWEEPBINS + bin]
+ */
+static void
+ratioBand(void *arg, int id)
+{
+    bandjob        *bj = (bandjob *) arg;
+    SkyMask        *sm = bj->sm;
+    PlanarImage    *reg = bj->reg;
+    long           *hist = bj->hist + (size_t) id * NUMBINS * SWEEPBINS;
+    long           *cat;
+    unsigned int    m, r, g, b;
+    int             i, j, k, a, e, i0, i1;
+    size_t          off;
+
+    i0 = (sm->bounds[id] > sm->top) ? sm->bounds[id] : sm->top;
+    if (i0 < bj->margin)
+        i0 = bj->margin;
+    i1 = (sm->bounds[id + 1] < sm->bottom) ? sm->bounds[id + 1] :
+        sm->bottom;
+    if (i1 > bj->h - bj->margin)
+        i1 = bj->h - bj->margin;
+    for (i = i0; i < i1; i++) {
+        off = (size_t) (i - sm->top) * reg->width - sm->left;
+        for (k = sm->rowruns[i - sm->top]; k < sm->rowruns[i - sm->top + 1];
+             k++) {
+            cat = hist + sm->runcat[k] * SWEEPBINS;
+            a = (sm->runfrom[k] < bj->margin) ? bj->margin : sm->runfrom[k];
+            e = (sm->runto[k] > bj->w - bj->margin) ? bj->w - bj->margin :
+                sm->runto[k];
+            for (j = a; j < e; j++) {
+                m = sm->pix[i][j];
+                r = reg->red[off + j] & (m >> 16);
+                g = reg->green[off + j] & (m >> 8);
+                b = reg->blue[off + j] & m;
+                /*
+                 * black pixels are outside the interest region
+                 */
+                if (r | g | b)
+                    cat[bj->rbbin[(r << 8) | b]]++;
+            }
+        }
+    }
+}
+
+/**
+ * \brief Builds the R/B ratio histogram of the mask bounding box of an
+ * image.
+ */
+RBHistogram    *
+ratioHistogram(PlanarImage * reg, SkyMask * sm, int neighbsize)
+{
+    RBHistogram    *rh;
+    bandjob         bj;
+    long            n;
+    int             r, b, c, k, id;
+
+    rh = (RBHistogram *) malloc(sizeof(RBHistogram));
+    bj.hist = (long *) calloc((size_t) sm->nbands * NUMBINS * SWEEPBINS,
+                              sizeof(long));
+    bj.rbbin = (unsigned short *) malloc(256 * 256 * sizeof(short));
+    if (rh != NULL)
+        rh->below = (long *) malloc(NUMBINS * (SWEEPBINS + 1) *
+                                    sizeof(long));
+    if ((rh == NULL) || (rh->below == NULL) || (bj.hist == NULL) ||
+        (bj.rbbin == NULL)) {
+        freeRBHistogram(rh);
+        free(bj.hist);
+        free(bj.rbbin);
+        return NULL;
+    }
+    /*
+     * the bin of each red and blue pair, so no pixel needs a division
+     */
+    for (r = 0; r < 256; r++)
+        for (b = 0; b < 256; b++)
+            bj.rbbin[(r << 8) | b] = ((b == 0) ||
+                                      (r * SWEEPSCALE / b >= SWEEPBINS)) ?
+                SWEEPBINS - 1 : r * SWEEPSCALE / b;
+    bj.reg = reg;
+    bj.sm = sm;
+    bj.w = sm->width;
+    bj.h = sm->height;
+    bj.margin = (int) ((double) neighbsize / 2.0);
+    runThreads(sm->nbands, ratioBand, &bj);
+    /*
+     * the bands are added, and accumulated by bin
+     */
+    for (c = 0; c < NUMBINS; c++) {
+        n = 0;
+        for (k = 0; k < SWEEPBINS; k++) {
+            rh->below[c * (SWEEPBINS + 1) + k] = n;
+            for (id = 0; id < sm->nbands; id++)
+                n += bj.hist[((size_t) id * NUMBINS + c) * SWEEPBINS + k];
+        }
+        rh->below[c * (SWEEPBINS + 1) + SWEEPBINS] = n;
+    }
+    free(bj.hist);
+    free(bj.rbbin);
+    return rh;
+}
+
+/**
+ * \brief Calculates the Cloud Cover Index without vote for a R/B
+ * treshold.
+ */
+double
+sweepIndex(RBHistogram * rh, double *thr, CCIResult * ccr)
+{
+    double          total = 0.0, clouds = 0.0;
+    long            pels = 0, catpels, catclouds, *below;
+    int             c, m;
+
+    m = (*thr <= 0.0) ? 0 : (*thr >= SWEEPMAX) ? SWEEPMAX * SWEEPSCALE :
+        (int) (*thr * SWEEPSCALE + 0.5);
+    *thr = (double) m / SWEEPSCALE;
+    /*
+     * sky if R / B < m / SWEEPSCALE, that is, if the bin is lower than m;
+     * the weights are added as in addCounts
+     */
+    for (c = 0; c < NUMBINS; c++) {
+        below = rh->below + c * (SWEEPBINS + 1);
+        catpels = below[SWEEPBINS];
+        catclouds = catpels - below[m];
+        pels += catpels;
+        if (c == NUMCAT)
+            continue;
+        total += factors[c] * catpels;
+        clouds += factors[c] * catclouds;
+    }
+    ccr->totalarea = total;
+    ccr->totalpels = (int) pels;
+    ccr->ccindex = clouds / total;
+    ccr->classifytime = ccr->votetime = ccr->counttime = 0.0;
+    return ccr->ccindex;
+}
+
+/**
+ * \brief Releases a R/B ratio histogram.
+ */
+void
+freeRBHistogram(RBHistogram * rh)
+{
+    if (rh == NULL)
+        return;
+    free(rh->below);
+    free(rh);
+}
+
+/*
+ * segment.c ends here
+ */
@@ -0,0 +1,132 @@
+/**
+ * @file bufpool.h
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 16:40
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * @section DESCRIPTION
+ * Pool of reusable memory buffers. The large buffers needed to process
+ * an image (file contents, color planes, trimmed and segmented images)
+ * have the same size for every image of a series, so they are taken from
+ * the pool and given back to it when the image is done. After the first
+ * image no large block is allocated, and the memory is not faulted in
+ * again for every image.
+ */
+#ifndef BUFPOOL_H
+#define BUFPOOL_H
+
+#include<stddef.h>
+
+/**
+ * Pool of reusable buffers, shared by several threads.
+ */
+typedef struct bufpool BufPool;
+
+/**
+ * \brief Creates an empty pool.
+ *
+ * @param[in] maxbufs is the maximum number of buffers kept by the pool
+ * (in use or free). When it is reached, the new buffers are allocated
+ * and released as usual.
+ * \return the pool, or NULL if there is not enough memory.
+ */
+BufPool        *newBufPool(int maxbufs);
+
+/**
+ * \brief Takes a buffer from a pool.
+ *
+ * The pooled buffers are grouped in size classes (four per power of two)
+ * and the size is rounded up to its class, at most 25% more bytes. A
+ * free buffer of the same class is reused; if there is none, a new one
+ * is allocated. A buffer is never taken by a request of another class,
+ * so when several threads share the pool each class keeps as many
+ * buffers as requests of it can be in use at the same time. The caller
+ * owns the buffer (no other call returns it) until it is given back with
+ * giveBuffer. Its contents are undefined.
+ *
+ * @param[in] bp is the pool. If it is NULL the buffer is just allocated.
+ * @param[in] size is the number of bytes required.
+ * \return the buffer, or NULL if there is not enough memory.
+ */
+void           *takeBuffer(BufPool * bp, size_t size);
+
+/**
+ * \brief Gives a buffer back to a pool.
+ *
+ * The buffer can then be reused by takeBuffer. A buffer not kept by the
+ * pool is released.
+ *
+ * @param[in] bp is the pool the buffer was taken from. If it is NULL the
+ * buffer is released.
+ * @param[in] buf is the buffer returned by takeBuffer. Can be NULL.
+ */
+void            giveBuffer(BufPool * bp, void *buf);
+
+/**
+ * \brief Number of buffers allocated by a pool.
+ *
+ * Counts the calls to takeBuffer that could not reuse a buffer, so it
+ * does not grow while a series of images of the same size is processed.
+ *
+ * @param[in] bp is the pool. Can be NULL.
+ * \return the number of allocations since the pool was created, 0 if bp
+ * is NULL.
+ */
+long            poolAllocations(BufPool * bp);
+
+/**
+ * \brief Number of bytes allocated by a pool.
+ *
+ * The total size of the buffers counted by poolAllocations, rounded up
+ * to their size class.
+ *
+ * @param[in] bp is the pool. Can be NULL.
+ * \return the bytes allocated since the pool was created, 0 if bp is
+ * NULL.
+ */
+unsigned long   poolBytes(BufPool * bp);
+
+/**
+ * \brief Buffers currently kept by a pool.
+ *
+ * @param[in] bp is the pool. Can be NULL (nothing kept).
+ * @param[out] kept is the number of buffers kept (in use or free).
+ * @param[out] busy is the number of them that are in use.
+ * @param[out] bytes is the total size of the buffers kept.
+ */
+void            poolUsage(BufPool * bp, int *kept, int *busy,
+                          unsigned long *bytes);
+
+/**
+ * \brief Releases a pool and all its buffers.
+ *
+ * @param[in] bp is the pool. Can be NULL.
+ * \pre every buffer taken from the pool was given back.
+ */
+void            freeBufPool(BufPool * bp);
+
+#endif
+/*
+ * bufpool.h ends here
+ */
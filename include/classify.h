@@ -0,0 +1,152 @@
+/**
+ * @file classify.h
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 15:10
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * @section DESCRIPTION
+ * Pixel classification kernels. Cuts rows of a sky picture with a mask
+ * and classifies their pixels as outside, sky or cloud with the integer
+ * R/B test of the compiled classifier. Every kernel has a portable
+ * scalar version and SSE4.1, AVX2 and AVX-512 versions; the widest one
+ * supported by the processor is chosen at run time, and all of them give
+ * the same results.
+ */
+#ifndef CLASSIFY_H
+#define CLASSIFY_H
+
+/**
+ * Pixel classes produced by the kernels. A flip between sky and cloud is
+ * CLSSKY + CLSCLD - c.
+ */
+#define CLSOUT 0
+#define CLSSKY 1
+#define CLSCLD 2
+
+/**
+ * Kernel sets, from the narrowest to the widest vectors.
+ */
+enum CLSKERNEL {
+  /** Portable C code */
+  KERNSCALAR = 0,
+  /** SSE4.1, 4 pixels per vector */
+  KERNSSE41,
+  /** AVX2, 8 pixels per vector */
+  KERNAVX2,
+  /** AVX-512 (foundation), 16 pixels per vector */
+  KERNAVX512,
+  /** Number of kernel sets */
+  NUMKERNELS
+};
+
+/**
+ * \brief Chooses the kernel set used by the classification functions.
+ *
+ * The kernel set used is the widest one that is not wider than the one
+ * requested and is supported by the processor (and compiled in). The
+ * functions of this library select NUMKERNELS - 1 (the best available)
+ * the first time they are called, but a program that uses threads must
+ * call this function (or classifyKernel) before starting them.
+ *
+ * @param[in] kernel is the widest kernel set allowed, in enum CLSKERNEL.
+ * \return the kernel set selected.
+ */
+int             selectClassifyKernel(int kernel);
+
+/**
+ * \brief Kernel set currently used.
+ *
+ * \return the kernel set in use, selecting the best one if none has been
+ * selected yet.
+ */
+int             classifyKernel();
+
+/**
+ * \brief Name of a kernel set.
+ *
+ * @param[in] kernel is the kernel set, in enum CLSKERNEL.
+ * \return its name ("scalar", "sse4.1", "avx2" or "avx512"), or "?" if
+ * kernel is out of range.
+ */
+const char     *classifyKernelName(int kernel);
+
+/**
+ * \brief Cuts a row of pixels with a mask.
+ *
+ * @param[in] msk is the row of the mask, in ARGB format.
+ * @param[in] img is the row of the image, in ARGB format.
+ * @param[in] n is the number of pixels.
+ * @param[out] cut is the trimmed row, msk AND img.
+ */
+void            cutRow(const unsigned int *msk, const unsigned int *img,
+                       int n, unsigned int *cut);
+
+/**
+ * \brief Cuts and classifies a row of pixels in ARGB format.
+ *
+ * The trimmed pixel is p = msk AND img. It is outside the interest region
+ * if its color is black, otherwise it is sky if R * rbden < rbnum * B
+ * (see compileClassifier in segment.h), and cloud in other case.
+ *
+ * @param[in] msk is the row of the mask, in ARGB format.
+ * @param[in] img is the row of the image, in ARGB format.
+ * @param[in] n is the number of pixels.
+ * @param[in] rbnum is the numerator of the R/B treshold, in [0, 256].
+ * @param[in] rbden is the denominator of the R/B treshold, in [1, 255].
+ * @param[out] cls is the row of pixel classes (CLSOUT, CLSSKY or CLSCLD).
+ * @param[out] cut is the trimmed row, not stored if NULL.
+ */
+void            classifyARGB(const unsigned int *msk,
+                             const unsigned int *img, int n, int rbnum,
+                             int rbden, unsigned char *cls,
+                             unsigned int *cut);
+
+/**
+ * \brief Cuts and classifies a row of pixels in separate color planes.
+ *
+ * Each plane is cut with the respective channel of the mask, and the
+ * pixels are classified as in classifyARGB. The trimmed pixel is built
+ * in ARGB format with the alpha channel of the mask.
+ *
+ * @param[in] msk is the row of the mask, in ARGB format.
+ * @param[in] red is the row of the red plane.
+ * @param[in] green is the row of the green plane.
+ * @param[in] blue is the row of the blue plane.
+ * @param[in] n is the number of pixels.
+ * @param[in] rbnum is the numerator of the R/B treshold, in [0, 256].
+ * @param[in] rbden is the denominator of the R/B treshold, in [1, 255].
+ * @param[out] cls is the row of pixel classes (CLSOUT, CLSSKY or CLSCLD).
+ * @param[out] cut is the trimmed row, not stored if NULL.
+ */
+void            classifyPlanar(const unsigned int *msk,
+                               const unsigned char *red,
+                               const unsigned char *green,
+                               const unsigned char *blue, int n, int rbnum,
+                               int rbden, unsigned char *cls,
+                               unsigned int *cut);
+
+#endif
+/*
+ * classify.h ends here
+ */
@@ -44,12 +44,31 @@
 #define ERR_WSFIL "Error: Segmented image file cannot be written\n"
 #define ERR_GINFO "Error: reading geographic point location data\n"
 #define ERR_IINFO "Error: reading EXIF data from image file\n"
+#define ERR_MSKFL "Error: reading mask image file\n"
+#define ERR_RDIMG "Error: reading pixels from image file\n"
+#define ERR_SPOOL "Error: Spool directory cannot be watched\n"
+#define ERR_FNLEN "Error: File name too long\n"
+#define ERR_SPMOV "Error: %s cannot be moved out of spool\n"
+#define ERR_LSFIL "Error: Input list file unreadable\n"
+#define ERR_INDIR "Error: Input directory unreadable\n"
+#define ERR_OUDIR "Error: Output directory unwritable\n"
+#define ERR_NOINP "Error: No input image files\n"
+#define ERR_NOMEM "Error: Not enough memory for the input images\n"
+#define ERR_NWORK "Error: Invalid number of workers\n"
+#define ERR_NTHRD "Error: Invalid number of threads per image\n"
+#define ERR_SCALE "Error: Invalid quick-look scale (2, 4 or 8)\n"
+#define ERR_MTFIL "Error: Metrics file cannot be written\n"
+#define ERR_FRMAT "Error: Invalid output format (text, csv or jsonl)\n"
+#define ERR_OUTPT "Error: Output records cannot be written\n"
+#define ERR_CACHE "Warning: Result cache cannot be used, ignored\n"
+#define ERR_SWEEP "Error: Invalid treshold sweep (tresholds or from:to:step)\n"
 
 /* Operation messages */
 #define MSG_WTFIL "Trimmed image file written\n"
 #define MSG_WSFIL "Segmented image file written\n"
 #define MSG_CCI1 "Calculating CCI\n"
 #define MSG_CCI2 "CCI calculation done\n"
+#define MSG_CACHE "CCI found in the result cache\n"
 
 /* More error messages */
 char             *diagmsg[15] = {
@@ -70,103 +89,47 @@ char             *diagmsg[15] = {
    "Geographic location file is unreadable\x0"
 };
 
-/**
- * Number of categories in which the radial distance in the interest area
- * is divided.
- */
-#define NUMCAT 36
+/* Daemon mode: subdirectories of spool and notification buffer size */
+#define SPLDONE "done"
+#define SPLFAIL "failed"
+#define SPLBUFSZ 8192
 
-/**
- * The pixels in the image interest region are classified according to the
- * square of its distance to the image center. This is used to perform a
- * correction of area, since the lens used deforms the image in fuction of
- * the radial distance. Therefore, given the square of the radial distance
- * of some pixel, perform a search of such value in the array
- * below. Retrieve the first index greater or equal to the given value. The
- * index obtained could be used as index in the factors array (defined
- * below), to obtain the weight factor used for that pixel.
- */
-const int categories[NUMCAT] = {
-    4225,
-    44944,
-    88209,
-    133956,
-    184900,
-    242064,
-    308025,
-    386884,
-    492804,
-    929296,
-    1028196,
-    1102500,
-    1162084,
-    1212201,
-    1258884,
-    1299600,
-    1336336,
-    1371241,
-    1401856,
-    1432809,
-    1461681,
-    1488400,
-    1512900,
-    1537600,
-    1560001,
-    1582564,
-    1602756,
-    1623076,
-    1640961,
-    1661521,
-    1679616,
-    1695204,
-    1713481,
-    1729225,
-    1745041,
-    1750329
-};
+/* Pooled buffers of each image: file contents, color planes, trimmed and
+   segmented images */
+#define BUFSPERIMG 4
 
-/**
- * Array of correction factor used to weight eah pixel according to its
- * radial distance to the image center.
- */
-const double factors[NUMCAT] = {
-    1.00,
-    0.99,
-    0.98,
-    0.97,
-    0.96,
-    0.95,
-    0.94,
-    0.93,
-    0.92,
-    0.91,
-    1.00,
-    0.99,
-    0.98,
-    0.97,
-    0.96,
-    0.95,
-    0.94,
-    0.93,
-    0.92,
-    1.01,
-    1.02,
-    1.03,
-    1.04,
-    1.05,
-    1.06,
-    1.07,
-    1.08,
-    1.09,
-    1.10,
-    1.11,
-    1.12,
-    1.13,
-    1.14,
-    1.15,
-    1.16,
-    1.17
- };
+/* Phases of each image measured with --profile: file reading, EXIF data,
+   decoding of the mask box, segmentation and CCI, and the writing of the
+   trimmed and segmented images */
+#define PRF_READ 0
+#define PRF_EXIF 1
+#define PRF_DECODE 2
+#define PRF_SEGMENT 3
+#define PRF_WRITECUT 4
+#define PRF_WRITESEG 5
+#define NPHASES 6
+/* Length of a profile line */
+#define PRFLEN 1024
+
+/* Causes of the image failures counted in the metrics: unreadable file,
+   EXIF data or pixels */
+#define FAIL_READ 0
+#define FAIL_EXIF 1
+#define FAIL_DECODE 2
+#define NFAILS 3
+/* Seconds between two writes of the metrics file */
+#define METRICSPERIOD 10
+
+/* Fields of the CSV and JSON Lines output records */
+#define NRECFIELDS 21
+
+/* Entries of a new result cache file */
+#define CACHEENTRIES 8192
+/* Values of an image result stored in the cache */
+#define NCACHEVALS 10
+
+/* Maximum number of tresholds of a sweep */
+#define MAXSWEEP 256
 
 #define FALSE 0
 #define TRUE  1
@@ -35,6 +35,7 @@
 #ifndef IMAGEINFO_H
 #define IMAGEINFO_H
 
+#include<stddef.h>
 #include<libexif/exif-data.h>
 #include<libexif/exif-ifd.h>
 
@@ -167,6 +168,8 @@ typedef struct {
  * - -3 NULL struct pointer (imin or casi).
  * - -4 azimuth out of range.
  * - -5 time zone offset out of range.
+ * - -6 EXIF data cannot be read, or it lacks the image dimensions or the
+ * date and time.
  *
  * \pre file must be readable and JPEG + EXIF format.
  * \pre az: must be non-negative value in [0, 360).
@@ -209,6 +212,38 @@ typedef struct {
 int             getImgInfo(char *fname, double az, char *utcoff,
                            ImageInfo * imin, CamAndShotInfo * casi);
 
+/**
+ * \brief Gets the EXIF metadata from a JPEG file already read.
+ *
+ * Like getImgInfo, but the signature and the EXIF data are taken from
+ * the file contents in memory, so the file is not opened again. Used
+ * with readFileData and openMemJPGReader (see imageio.h) to read each
+ * image file only once.
+ *
+ * @param[in] fname is the name of jpeg file (only its name is stored).
+ * @param[in] data is the contents of the file.
+ * @param[in] size is the number of bytes of data.
+ * @param[in] az is the azimuth, as in getImgInfo.
+ * @param[in] utcoff is the time zone, as in getImgInfo.
+ * @param[out] imin is the ImageInfo structure where the image data
+ * will be stored.
+ * @param[out] casi is the CamAndShotInfo structure where the camera
+ * and specific shoting information will be stored.
+ *
+ * \return the same codes of getImgInfo, except -1.
+ */
+int             getImgInfoData(char *fname, const unsigned char *data,
+                               size_t size, double az, char *utcoff,
+                               ImageInfo * imin, CamAndShotInfo * casi);
+
+/**
+ * \brief Releases the strings allocated by getImgInfo.
+ *
+ * @param[in] imin is the ImageInfo structure filled by getImgInfo.
+ * @param[in] casi is the CamAndShotInfo structure filled by getImgInfo.
+ */
+void            freeImgInfo(ImageInfo * imin, CamAndShotInfo * casi);
+
 #endif
 /*
  * imageinfo.h ends here
@@ -40,6 +40,7 @@
 
 #include<jpeglib.h>
 #include<png.h>
+#include"bufpool.h"
 
 /**
  * \brief Reads a JPEG image from file.
@@ -74,6 +75,171 @@
  */
 unsigned int  **readJPGImage(char *fname, int *width, int *height);
 
+/**
+ * \brief Reads a whole file in memory.
+ *
+ * The file is opened once and read with a single call, which is much
+ * cheaper than several opens and small reads on a network file system.
+ *
+ * @param[in] bp is the pool the buffer is taken from (NULL to allocate
+ * it).
+ * @param[in] fname is the name of the file.
+ * @param[out] size is the number of bytes read.
+ * \return the file contents, which must be given back with
+ * giveBuffer(bp, ...), or NULL if the file cannot be read or is empty.
+ */
+unsigned char  *readFileData(BufPool * bp, char *fname, size_t *size);
+
+/**
+ * Image stored in separate color planes of 8 bits per pixel. The pixel in
+ * row i, column j of each plane is at offset i * width + j.
+ */
+typedef struct {
+  /** Red plane */
+  unsigned char  *red;
+  /** Green plane, NULL if not required */
+  unsigned char  *green;
+  /** Blue plane */
+  unsigned char  *blue;
+  /** Number of columns */
+  int             width;
+  /** Number of rows */
+  int             height;
+  /** Pool the planes were taken from, NULL if they were allocated */
+  BufPool        *pool;
+} PlanarImage;
+
+/**
+ * Incremental JPEG reader, used to process the image rows as soon as
+ * they are decompressed, without storing the whole image.
+ */
+typedef struct jpgreader JPGReader;
+
+/**
+ * \brief Opens a JPEG file to read its rows one by one.
+ *
+ * Reads the image header and prepares the decompression. The rows are
+ * read, from top to bottom, with readJPGRow. Has the same restrictions
+ * of readJPGImage (3 channels, no rescaling).
+ *
+ * @param[in] fname is the name of file which contains the image.
+ * @param[out] width is the image width.
+ * @param[out] height is the image height
+ * \return the reader, or NULL if the file cannot be read.
+ */
+JPGReader      *openJPGReader(char *fname, int *width, int *height);
+
+/**
+ * \brief Opens a JPEG file to read its rows one by one, at a reduced
+ * scale.
+ *
+ * Like openJPGReader, but the decompressor scales the image down by
+ * 1 / scale, which is much cheaper than the full size decompression. The
+ * width and height are the ones of the reduced image (rounded up).
+ *
+ * @param[in] fname is the name of file which contains the image.
+ * @param[in] scale is the reduction denominator: 1, 2, 4 or 8.
+ * @param[out] width is the reduced image width.
+ * @param[out] height is the reduced image height
+ * \return the reader, or NULL if the file cannot be read.
+ */
+JPGReader      *openScaledJPGReader(char *fname, int scale, int *width,
+                                    int *height);
+
+/**
+ * \brief Opens a JPEG image stored in memory to read its rows one by
+ * one, at a reduced scale.
+ *
+ * Like openScaledJPGReader, but the compressed image is read from a
+ * buffer, usually filled by readFileData, so a file that is also used
+ * for other purposes (as its EXIF data) is read only once. The buffer
+ * must not be released before closeJPGReader is called.
+ *
+ * @param[in] data is the compressed image.
+ * @param[in] size is the number of bytes of data.
+ * @param[in] scale is the reduction denominator: 1, 2, 4 or 8.
+ * @param[out] width is the reduced image width.
+ * @param[out] height is the reduced image height
+ * \return the reader, or NULL if the data cannot be decompressed (or
+ * the library cannot read from memory).
+ */
+JPGReader      *openMemJPGReader(const unsigned char *data, size_t size,
+                                 int scale, int *width, int *height);
+
+/**
+ * \brief Reads the next row of a JPEG file.
+ *
+ * Decompresses the next image row and stores it in ARGB format, as
+ * readJPGImage does.
+ *
+ * @param[in] jr is the reader returned by openJPGReader.
+ * @param[out] row is the buffer for the row pixels (image width).
+ * \return 1 if success, 0 if the data is corrupted or there are no more
+ * rows.
+ */
+int             readJPGRow(JPGReader * jr, unsigned int *row);
+
+/**
+ * \brief Reads the next row of a JPEG file in separate color planes.
+ *
+ * Like readJPGRow, but each channel is stored in its own array of
+ * bytes. This is the layout needed by per channel computations (as the
+ * R/B ratio), which read a quarter or a half of the memory used by the
+ * packed ARGB format.
+ *
+ * @param[in] jr is the reader returned by openJPGReader.
+ * @param[out] red is the buffer for the red channel (image width).
+ * @param[out] green is the buffer for the green channel, or NULL if it
+ * is not required.
+ * @param[out] blue is the buffer for the blue channel.
+ * \return 1 if success, 0 if the data is corrupted or there are no more
+ * rows.
+ */
+int             readJPGPlanes(JPGReader * jr, unsigned char *red,
+                              unsigned char *green, unsigned char *blue);
+
+/**
+ * \brief Restricts the decompression to a range of columns.
+ *
+ * Must be called before the first row is read. Then readJPGRow only
+ * decompresses and stores the columns xoffset, ..., xoffset + width - 1.
+ * The library can only crop at block boundaries, so the range is
+ * enlarged as needed and the actual one is returned. If the library
+ * cannot crop, the range is the whole row.
+ *
+ * @param[in] jr is the reader returned by openJPGReader.
+ * @param[in,out] xoffset is the first column required; the first column
+ * actually decompressed on return.
+ * @param[in,out] width is the number of columns required; the number of
+ * columns actually decompressed on return.
+ * \return 1 if success, 0 if the range is not inside the image or the
+ * rows are already being read.
+ */
+int             cropJPGReader(JPGReader * jr, int *xoffset, int *width);
+
+/**
+ * \brief Skips rows of a JPEG file.
+ *
+ * The next nrows rows are discarded. If the library supports it, they
+ * are not fully decompressed.
+ *
+ * @param[in] jr is the reader returned by openJPGReader.
+ * @param[in] nrows is the number of rows to be skipped.
+ * \return 1 if success, 0 if the data is corrupted or there are not so
+ * many rows.
+ */
+int             skipJPGRows(JPGReader * jr, int nrows);
+
+/**
+ * \brief Finishes the reading of a JPEG file.
+ *
+ * Releases the decompressor and closes the file. The rows not yet read
+ * are discarded.
+ *
+ * @param[in] jr is the reader returned by openJPGReader. Can be NULL.
+ */
+void            closeJPGReader(JPGReader * jr);
+
 /**
  * \brief Reads a PNG image from file.
  *
@@ -92,6 +258,8 @@ unsigned int  **readJPGImage(char *fname, int *width, int *height);
  *
  * The most significant byte corresponds to the alpha channel, the
  * next bytes correspond to the R, G and B channels.
+ * Palette, gray and RGB images (as the ones written by writePNGPalette)
+ * are expanded to ARGB, with the transparency of their tRNS chunk.
  * If some problem occurs then the function returns NULL.
  *
  * @param[in] fname is the name of file which contains the image.
@@ -128,6 +296,134 @@ unsigned int  **readPNGImage(char *fname, int *width, int *height);
 int             writePNGImage(unsigned int **img, char *fname, int width,
                               int height);
 
+/**
+ * \brief Writes an image to a PNG file, compressed by several threads.
+ *
+ * Same as writePNGImage, but the image is divided in nthreads horizontal
+ * stripes that are filtered and deflated at the same time, each one by
+ * its own thread (in the way of pigz). The compressed stripes are pieces
+ * of a single zlib stream, written one per IDAT chunk, so the file is a
+ * standard PNG, only a little larger than the one of writePNGImage.
+ *
+ * @param[in] img is the image row array.
+ * @param[in] fname is the name of the file where tha image will be writen.
+ * @param[in] width is the image width.
+ * @param[in] height is the image height
+ * @param[in] nthreads is the number of threads, 1 is the same as
+ * writePNGImage.
+ * \return 1 if success, a negative number otherwise (the same codes of
+ * writePNGImage).
+ */
+int             writeParallelPNGImage(unsigned int **img, char *fname,
+                                      int width, int height, int nthreads);
+
+/**
+ * Function that gives the row i of an image to be written, in ARGB
+ * format. It can return a row it already has, or build the row in buf
+ * (of the image width) and return buf.
+ */
+typedef const unsigned int *(*PNGRowFunc) (void *arg, int i,
+                                            unsigned int *buf);
+
+/**
+ * \brief Writes an image to a PNG file, row by row.
+ *
+ * Same as writePNGImage, but the image rows are asked for one at a time
+ * while the file is written, so the whole image does not need to be
+ * stored in ARGB format.
+ *
+ * @param[in] fname is the name of the file where tha image will be writen.
+ * @param[in] width is the image width.
+ * @param[in] height is the image height.
+ * @param[in] getrow is the function that gives each row.
+ * @param[in] arg is the first argument of getrow.
+ * \return 1 if success, a negative number otherwise (the same codes of
+ * writePNGImage).
+ */
+int             writePNGRows(char *fname, int width, int height,
+                             PNGRowFunc getrow, void *arg);
+
+/**
+ * \brief Writes an image to a PNG file, row by row, compressed by
+ * several threads.
+ *
+ * Same as writePNGRows, but compressed in stripes as writeParallelPNGImage
+ * does. The rows of different stripes are asked for at the same time, so
+ * getrow must be safe to call from several threads (each call with its
+ * own buf), and some rows are asked for twice.
+ *
+ * @param[in] fname is the name of the file where tha image will be writen.
+ * @param[in] width is the image width.
+ * @param[in] height is the image height.
+ * @param[in] getrow is the function that gives each row.
+ * @param[in] arg is the first argument of getrow.
+ * @param[in] nthreads is the number of threads.
+ * \return 1 if success, a negative number otherwise (the same codes of
+ * writePNGImage).
+ */
+int             writeParallelPNGRows(char *fname, int width, int height,
+                                     PNGRowFunc getrow, void *arg,
+                                     int nthreads);
+
+/**
+ * Function that gives the row i of a palette image to be written, packed
+ * as the PNG format requires: with depth bits per pixel, the leftmost
+ * pixel in the most significant bits of the first byte. It can return a
+ * row it already has, or build the row in buf ((width * depth + 7) / 8
+ * bytes) and return buf.
+ */
+typedef const unsigned char *(*PNGIndexFunc) (void *arg, int i,
+                                              unsigned char *buf);
+
+/**
+ * \brief Writes a palette image to a PNG file, row by row.
+ *
+ * Images with a few colors (as the segmented ones) are stored with 1, 2,
+ * 4 or 8 bits per pixel instead of the 32 of the ARGB format, so the
+ * file is much smaller and faster to compress. The alpha of the palette
+ * colors is stored in the tRNS chunk.
+ *
+ * @param[in] fname is the name of the file where tha image will be writen.
+ * @param[in] width is the image width.
+ * @param[in] height is the image height.
+ * @param[in] depth is the number of bits per pixel: 1, 2, 4 or 8.
+ * @param[in] palette is the color (ARGB) of each index.
+ * @param[in] ncolors is the number of colors, at most 2^depth.
+ * @param[in] getrow is the function that gives each packed row.
+ * @param[in] arg is the first argument of getrow.
+ * \return 1 if success, a negative number otherwise (the same codes of
+ * writePNGImage).
+ */
+int             writePNGPalette(char *fname, int width, int height,
+                                int depth, const unsigned int *palette,
+                                int ncolors, PNGIndexFunc getrow, void *arg);
+
+/**
+ * \brief Writes a palette image to a PNG file, row by row, compressed by
+ * several threads.
+ *
+ * Same as writePNGPalette, but compressed in stripes as
+ * writeParallelPNGImage does (getrow with the same requirements of
+ * writeParallelPNGRows).
+ *
+ * @param[in] fname is the name of the file where tha image will be writen.
+ * @param[in] width is the image width.
+ * @param[in] height is the image height.
+ * @param[in] depth is the number of bits per pixel: 1, 2, 4 or 8.
+ * @param[in] palette is the color (ARGB) of each index.
+ * @param[in] ncolors is the number of colors, at most 2^depth.
+ * @param[in] getrow is the function that gives each packed row.
+ * @param[in] arg is the first argument of getrow.
+ * @param[in] nthreads is the number of threads.
+ * \return 1 if success, a negative number otherwise (the same codes of
+ * writePNGImage).
+ */
+int             writeParallelPNGPalette(char *fname, int width, int height,
+                                        int depth,
+                                        const unsigned int *palette,
+                                        int ncolors, PNGIndexFunc getrow,
+                                        void *arg, int nthreads);
+
 /**
  * \brief Writes an image to a JPG file.
  *
@@ -150,6 +446,101 @@ int             writePNGImage(unsigned int **img, char *fname, int width,
 int             writeJPGImage(unsigned int **img, char *fname, int width,
                               int height);
 
+/**
+ * \brief Releases the memory of an image buffer.
+ *
+ * Frees the pixel block and the row array of an image buffer returned
+ * by readJPGImage or readPNGImage (or any buffer allocated in the same
+ * way: a single block of pixels pointed by the first row).
+ *
+ * @param[in] img is the image row array. Can be NULL.
+ */
+void            freeImage(unsigned int **img);
+
+/**
+ * \brief Allocates an image buffer.
+ *
+ * The buffer is allocated in the same way of readJPGImage and
+ * readPNGImage: a single block of pixels pointed by the first row, so
+ * it can be released with freeImage. The pixels are not initialized.
+ *
+ * @param[in] width is the image width.
+ * @param[in] height is the image height.
+ * \return the image row array, or NULL if there is not enough memory.
+ */
+unsigned int  **newImage(int width, int height);
+
+/**
+ * \brief Takes an image buffer from a pool.
+ *
+ * Like newImage, but the row array and the pixels are a single buffer
+ * taken from the pool, so a series of images of the same size reuses
+ * the same memory. The buffer must be given back with releaseImage, not
+ * with freeImage.
+ *
+ * @param[in] bp is the pool (NULL to allocate the buffer).
+ * @param[in] width is the image width.
+ * @param[in] height is the image height.
+ * \return the image row array, or NULL if there is not enough memory.
+ */
+unsigned int  **newPooledImage(BufPool * bp, int width, int height);
+
+/**
+ * \brief Gives an image buffer back to its pool.
+ *
+ * @param[in] bp is the pool given to newPooledImage.
+ * @param[in] img is the image returned by newPooledImage. Can be NULL.
+ */
+void            releaseImage(BufPool * bp, unsigned int **img);
+
+/**
+ * \brief Allocates a planar image.
+ *
+ * @param[in] width is the image width.
+ * @param[in] height is the image height.
+ * @param[in] withgreen is non zero if the green plane is required.
+ * \return the planar image (pixels not initialized), or NULL if there
+ * is not enough memory. It must be released with freePlanarImage.
+ */
+PlanarImage    *newPlanarImage(int width, int height, int withgreen);
+
+/**
+ * \brief Takes a planar image from a pool.
+ *
+ * Like newPlanarImage, but the planes are taken from the pool;
+ * freePlanarImage gives them back.
+ *
+ * @param[in] bp is the pool (NULL to allocate the planes).
+ * @param[in] width is the image width.
+ * @param[in] height is the image height.
+ * @param[in] withgreen is non zero if the green plane is required.
+ * \return the planar image (pixels not initialized), or NULL if there
+ * is not enough memory. It must be released with freePlanarImage.
+ */
+PlanarImage    *newPooledPlanarImage(BufPool * bp, int width, int height,
+                                     int withgreen);
+
+/**
+ * \brief Releases a planar image.
+ *
+ * The planes are given back to the pool they were taken from.
+ *
+ * @param[in] pi is the planar image. Can be NULL.
+ */
+void            freePlanarImage(PlanarImage * pi);
+
+/**
+ * \brief Reads a JPEG image from file in separate color planes.
+ *
+ * Same restrictions of readJPGImage, but the red, blue and (optionally)
+ * green channels are stored in separate planes.
+ *
+ * @param[in] fname is the name of file which contains the image.
+ * @param[in] withgreen is non zero if the green plane is required.
+ * \return the planar image, or NULL if the file cannot be read.
+ */
+PlanarImage    *readPlanarJPGImage(char *fname, int withgreen);
+
 #endif
 /*
  * imageio.h ends here
@@ -0,0 +1,141 @@
+/**
+ * @file metrics.h
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 18:20
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * @section DESCRIPTION
+ * Metrics in the Prometheus text exposition format. Counters and gauges
+ * are plain numbers kept by the program; latencies are kept in
+ * histograms of fixed buckets. The whole set of metrics is written to a
+ * file that is replaced atomically, so a collector (as the textfile
+ * collector of the node exporter) never reads half a file.
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+#include<stdio.h>
+
+/**
+ * Maximum number of bucket limits of a histogram.
+ */
+#define MAXBUCKETS 16
+
+/** Histogram of observed values */
+typedef struct {
+  /** Number of bucket limits */
+  int             nbounds;
+  /** Upper limits of the buckets, increasing */
+  double          bound[MAXBUCKETS];
+  /** Observations in each bucket (not cumulative), the last one is the
+      bucket beyond the last limit (+Inf) */
+  unsigned long   count[MAXBUCKETS + 1];
+  /** Sum of the observed values */
+  double          sum;
+  /** Number of observations */
+  unsigned long   total;
+} Histogram;
+
+/**
+ * \brief Initializes an empty histogram.
+ *
+ * @param[out] h is the histogram.
+ * @param[in] bounds are the upper limits of the buckets, increasing.
+ * @param[in] nbounds is the number of limits, at most MAXBUCKETS (the
+ * rest are ignored).
+ */
+void            initHistogram(Histogram * h, const double *bounds,
+                              int nbounds);
+
+/**
+ * \brief Adds an observation to a histogram.
+ *
+ * @param[in,out] h is the histogram.
+ * @param[in] v is the observed value. It is counted in the first bucket
+ * whose limit is greater than or equal to v.
+ */
+void            observeValue(Histogram * h, double v);
+
+/**
+ * \brief Writes the HELP and TYPE lines of a metric.
+ *
+ * @param[in] f is the output file.
+ * @param[in] name is the metric name.
+ * @param[in] type is the metric type: "counter", "gauge" or "histogram".
+ * @param[in] help is the description of the metric.
+ */
+void            writeMetricHeader(FILE * f, const char *name,
+                                  const char *type, const char *help);
+
+/**
+ * \brief Writes a sample of a metric.
+ *
+ * @param[in] f is the output file.
+ * @param[in] name is the metric name.
+ * @param[in] labels are the labels, as they go between the braces (for
+ * instance: reason="exif"), or NULL if there are none.
+ * @param[in] value is the value of the sample.
+ */
+void            writeSample(FILE * f, const char *name, const char *labels,
+                            double value);
+
+/**
+ * \brief Writes the samples of a histogram.
+ *
+ * The cumulative counts of the buckets (name_bucket, with the le label
+ * added to the given ones), the sum (name_sum) and the number of
+ * observations (name_count).
+ *
+ * @param[in] f is the output file.
+ * @param[in] name is the metric name.
+ * @param[in] labels are the labels of the histogram, or NULL.
+ * @param[in] h is the histogram.
+ */
+void            writeHistogram(FILE * f, const char *name,
+                               const char *labels, Histogram * h);
+
+/**
+ * Function that writes the metrics in an open file.
+ */
+typedef void    (*MetricsFunc) (FILE * f, void *arg);
+
+/**
+ * \brief Replaces a metrics file.
+ *
+ * The metrics are written in a temporary file (fname with ".tmp"
+ * appended) in the same directory, which is then renamed as fname, so
+ * the readers see either the old file or the new one.
+ *
+ * @param[in] fname is the name of the metrics file.
+ * @param[in] write is the function that writes the metrics.
+ * @param[in] arg is the second argument of write.
+ * \return 1 if success, 0 if the file cannot be written.
+ */
+int             writeMetricsFile(const char *fname, MetricsFunc write,
+                                 void *arg);
+
+#endif
+/*
+ * metrics.h ends here
+ */
@@ -0,0 +1,107 @@
+/**
+ * @file parallel.h
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 10:15
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * @section DESCRIPTION
+ * Parallel execution library. A thin layer over POSIX threads used to
+ * run the same function in several threads sharing a common argument,
+ * the partition of image rows among such threads, and the clocks used
+ * to measure them.
+ */
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+/**
+ * Maximum number of threads that can be run together.
+ */
+#define MAXTHREADS 256
+
+/**
+ * Function run by each thread. The first argument is the shared
+ * argument, the second one is the thread number in {0, ..., n - 1}.
+ */
+typedef void    (*ThreadFunc) (void *arg, int id);
+
+/**
+ * \brief Runs a function in several threads and waits for all of them.
+ *
+ * The function func is called n times concurrently, each call with the
+ * same shared argument and a different thread number. Thread number 0
+ * runs in the calling thread, so n = 1 means a plain function call. If
+ * some thread cannot be created, its call is done in the calling thread
+ * after the others, so every thread number is always run.
+ *
+ * @param[in] n is the number of threads, in {1, ..., MAXTHREADS}.
+ * @param[in] func is the function to be run.
+ * @param[in] arg is the argument shared by all the threads.
+ * \return n if success, or 0 if n is out of range.
+ * \post all the calls to func have returned.
+ */
+int             runThreads(int n, ThreadFunc func, void *arg);
+
+/**
+ * \brief Splits a sequence of rows in bands of similar weight.
+ *
+ * Given the weight (cost) of each row, the rows are divided in n
+ * consecutive bands whose total weights are as similar as possible.
+ * Band k contains the rows bounds[k], ..., bounds[k + 1] - 1. Some
+ * bands can be empty if the weights are concentrated in a few rows.
+ *
+ * @param[in] weight is the array of row weights (non negative).
+ * @param[in] nrows is the number of rows.
+ * @param[in] n is the number of bands.
+ * @param[out] bounds is the array of n + 1 band limits.
+ * \post bounds[0] = 0, bounds[n] = nrows, and bounds is non decreasing.
+ */
+void            partitionRows(const int *weight, int nrows, int n,
+                              int *bounds);
+
+/**
+ * \brief Number of processors currently online.
+ *
+ * \return the number of online processors, 1 if it cannot be determined.
+ */
+int             numProcessors();
+
+/**
+ * \brief Wall clock time, to measure time intervals.
+ *
+ * \return the seconds elapsed since an arbitrary origin, from a clock
+ * that is never set back.
+ */
+double          wallClock();
+
+/**
+ * \brief CPU time of the process, added over all its threads.
+ *
+ * \return the seconds of CPU used by the process since it started.
+ */
+double          cpuClock();
+
+#endif
+/*
+ * parallel.h ends here
+ */
@@ -0,0 +1,158 @@
+/**
+ * @file records.h
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 19:05
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * @section DESCRIPTION
+ * Buffered writer of result records, one per line, in plain text (fields
+ * separated by spaces), CSV (with a header line) or JSON Lines (an
+ * object per line, keys are the field names). The records are built in
+ * memory and written in blocks, not with a call per field.
+ */
+#ifndef RECORDS_H
+#define RECORDS_H
+
+#include<stdio.h>
+
+/**
+ * Formats of the records.
+ */
+#define FMT_TEXT 0
+#define FMT_CSV 1
+#define FMT_JSONL 2
+
+/**
+ * Size of the output buffer of a record writer.
+ */
+#define RECBUFSIZE 65536
+
+/** Structure of a buffered record writer */
+typedef struct {
+  /** Output file */
+  FILE           *out;
+  /** Format of the records (FMT_TEXT, FMT_CSV or FMT_JSONL) */
+  int             format;
+  /** Names of the fields (not copied), used in the CSV header and as
+      JSON keys */
+  const char    **names;
+  /** Number of names */
+  int             nfields;
+  /** Fields already put in the current record */
+  int             field;
+  /** Output buffer */
+  char           *buf;
+  /** Bytes in the buffer */
+  size_t          len;
+  /** 0 if a write failed */
+  int             ok;
+} RecordWriter;
+
+/**
+ * \brief Creates a record writer.
+ *
+ * In CSV format the header line (the field names) is the first one
+ * written.
+ *
+ * @param[in] out is the output file.
+ * @param[in] format is the format of the records.
+ * @param[in] names are the names of the fields. Not used in text format,
+ * where they can be NULL and the records can have any number of fields.
+ * @param[in] nfields is the number of names.
+ * \return the new writer, NULL if there is no memory.
+ */
+RecordWriter   *newRecordWriter(FILE * out, int format, const char **names,
+                                int nfields);
+
+/**
+ * \brief Gets the format with a given name.
+ *
+ * @param[in] name is "text", "csv" or "jsonl".
+ * \return the format, -1 if the name is unknown.
+ */
+int             recordFormat(const char *name);
+
+/**
+ * \brief Puts a string field in the current record.
+ *
+ * Strings are quoted in CSV (when they contain commas, quotes or line
+ * breaks) and in JSON, with the needed escapes.
+ *
+ * @param[in,out] rw is the writer.
+ * @param[in] s is the value of the field.
+ */
+void            putString(RecordWriter * rw, const char *s);
+
+/**
+ * \brief Puts an integer field in the current record.
+ *
+ * @param[in,out] rw is the writer.
+ * @param[in] v is the value of the field.
+ */
+void            putInt(RecordWriter * rw, int v);
+
+/**
+ * \brief Puts a real field in the current record.
+ *
+ * Written with six decimals; in JSON a value that is not finite is
+ * written as null.
+ *
+ * @param[in,out] rw is the writer.
+ * @param[in] v is the value of the field.
+ */
+void            putDouble(RecordWriter * rw, double v);
+
+/**
+ * \brief Ends the current record.
+ *
+ * The record stays in the buffer until it is full or flushRecords is
+ * called.
+ *
+ * @param[in,out] rw is the writer.
+ */
+void            endRecord(RecordWriter * rw);
+
+/**
+ * \brief Writes the buffered records in the output file.
+ *
+ * @param[in,out] rw is the writer.
+ * \return 1 if success, 0 if some write failed.
+ */
+int             flushRecords(RecordWriter * rw);
+
+/**
+ * \brief Writes the buffered records and frees a record writer.
+ *
+ * The output file is not closed.
+ *
+ * @param[in] rw is the writer.
+ * \return 1 if success, 0 if some write failed.
+ */
+int             freeRecordWriter(RecordWriter * rw);
+
+#endif
+/*
+ * records.h ends here
+ */
@@ -0,0 +1,173 @@
+/**
+ * @file rescache.h
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 19:40
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * @section DESCRIPTION
+ * Persistent cache of results in a local file, addressed by the content
+ * of the processed data (a hash of its bytes) and a hash of the
+ * parameters used to process it. The file has a fixed number of entries
+ * grouped in sets of CACHEWAYS; each key goes to a single set, where the
+ * least recently used entry is replaced. The sets are locked (fcntl
+ * record locks) while they are read or written, so several processes,
+ * and several threads of each one, can share the same file.
+ */
+#ifndef RESCACHE_H
+#define RESCACHE_H
+
+#include<stddef.h>
+#include<pthread.h>
+
+/**
+ * Entries in each set of the cache.
+ */
+#define CACHEWAYS 8
+
+/**
+ * Maximum length of a value stored in the cache.
+ */
+#define CACHEDATALEN 96
+
+/** Key of a cache entry */
+typedef struct {
+  /** Hash of the data (two independent 32 bit hashes) */
+  unsigned int    data[2];
+  /** Hash of the parameters used to process the data */
+  unsigned int    params[2];
+  /** Length of the data */
+  unsigned long   length;
+} CacheKey;
+
+/** Entry of the cache file */
+typedef struct {
+  /** Key of the entry */
+  CacheKey        key;
+  /** Time of the last use (seconds since the Epoch), 0 if empty */
+  double          lastuse;
+  /** Checksum of the key and the value, to detect damaged entries */
+  unsigned int    check;
+  /** Stored value */
+  unsigned char   value[CACHEDATALEN];
+} CacheEntry;
+
+/** Structure of an open cache */
+typedef struct {
+  /** Descriptor of the cache file */
+  int             fd;
+  /** Number of sets in the file */
+  int             nsets;
+  /** Serializes the threads of the process (record locks are owned by
+      the process, not by the thread) */
+  pthread_mutex_t lock;
+} ResultCache;
+
+/**
+ * \brief Calculates the hash of a block of bytes.
+ *
+ * Two independent 32 bit hashes (MurmurHash3 style mixing, a word at a
+ * time) are calculated in a single pass.
+ *
+ * @param[in] buf is the block.
+ * @param[in] len is its length in bytes.
+ * @param[out] hash are the two hashes.
+ */
+void            hashBytes(const void *buf, size_t len, unsigned int hash[2]);
+
+/**
+ * \brief Calculates the hash of the contents of a file.
+ *
+ * @param[in] fname is the file name.
+ * @param[out] hash are the two hashes, the same of hashBytes on the whole
+ * contents.
+ * \return 1 if success, 0 if the file cannot be read.
+ */
+int             hashFile(const char *fname, unsigned int hash[2]);
+
+/**
+ * \brief Builds the key of a block of data.
+ *
+ * @param[out] k is the key.
+ * @param[in] data is the block of data.
+ * @param[in] len is its length in bytes.
+ * @param[in] params is the hash of the parameters used to process it.
+ */
+void            makeCacheKey(CacheKey * k, const void *data, size_t len,
+                             const unsigned int params[2]);
+
+/**
+ * \brief Opens a cache file, or creates it if it does not exist.
+ *
+ * A new file is created with room for the given number of entries
+ * (rounded up to whole sets), and never grows. An existing file keeps
+ * its own size.
+ *
+ * @param[in] fname is the name of the cache file.
+ * @param[in] entries is the number of entries of a new file.
+ * \return the open cache, NULL if the file cannot be opened or created,
+ * or it is not a cache file of this version.
+ */
+ResultCache    *openResultCache(const char *fname, int entries);
+
+/**
+ * \brief Looks for a value in the cache.
+ *
+ * The entry found becomes the most recently used of its set.
+ *
+ * @param[in] rc is the cache.
+ * @param[in] k is the key.
+ * @param[out] value is where the value is copied.
+ * @param[in] len is the length of the value, at most CACHEDATALEN.
+ * \return 1 if the value was found, 0 otherwise.
+ */
+int             cacheLookup(ResultCache * rc, const CacheKey * k,
+                            void *value, size_t len);
+
+/**
+ * \brief Stores a value in the cache.
+ *
+ * The value replaces the one with the same key, or goes to an empty
+ * entry of the set, or to the least recently used one.
+ *
+ * @param[in] rc is the cache.
+ * @param[in] k is the key.
+ * @param[in] value is the value.
+ * @param[in] len is the length of the value, at most CACHEDATALEN.
+ * \return 1 if the value was stored, 0 otherwise.
+ */
+int             cacheStore(ResultCache * rc, const CacheKey * k,
+                           const void *value, size_t len);
+
+/**
+ * \brief Closes a cache.
+ *
+ * @param[in] rc is the cache (can be NULL).
+ */
+void            closeResultCache(ResultCache * rc);
+
+#endif
+/*
+ * rescache.h ends here
+ */
@@ -0,0 +1,653 @@
+/**
+ * @file segment.h
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 12:40
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * @section DESCRIPTION
+ * Sky segmentation library. Cuts the interest region of a whole sky
+ * picture with a mask, classifies its pixels as sky or cloud according
+ * to their R/B ratio, smooths the borderline between both classes with
+ * a voting (convolution) operator and calculates the Cloud Cover Index
+ * (CCI) as the weighted proportion of cloud pixels.
+ *
+ * Each stage is available as a separate function working on whole
+ * image buffers (readAndCut, filterRB, convolution, cloudcoverindex),
+ * and all of them are also fused in a single pass over the image
+ * (segmentImage) that does not need the intermediate images.
+ */
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include<stdio.h>
+#include"imageio.h"
+
+/**
+ * Number of categories in which the radial distance in the interest area
+ * is divided.
+ */
+#define NUMCAT 36
+
+/**
+ * Bins per unit of the R/B ratio in the threshold sweep histograms: the
+ * sweep is exact for the tresholds multiple of 1 / SWEEPSCALE.
+ */
+#define SWEEPSCALE 1000
+
+/**
+ * Largest R/B treshold of the sweep, the ratios above it share the last
+ * bin.
+ */
+#define SWEEPMAX 4
+
+/**
+ * Bins of each category in the sweep histograms.
+ */
+#define SWEEPBINS (SWEEPMAX * SWEEPSCALE + 1)
+
+/**
+ * Pixel values of the segmented images.
+ */
+enum SEGVALUES {
+  /** Outside the interest region: transparent black */
+  SEGOUT = 0X00000000,
+  /** Sky: opaque black */
+  SEGSKY = 0XFF000000,
+  /** Cloud: opaque white */
+  SEGCLD = 0XFFFFFFFF
+};
+
+/**
+ * The pixels in the image interest region are classified according to the
+ * square of its distance to the image center. This is used to perform a
+ * correction of area, since the lens used deforms the image in fuction of
+ * the radial distance. Therefore, given the square of the radial distance
+ * of some pixel, perform a search of such value in the array
+ * below. Retrieve the first index greater or equal to the given value. The
+ * index obtained could be used as index in the factors array (defined
+ * below), to obtain the weight factor used for that pixel.
+ */
+extern const int categories[NUMCAT];
+
+/**
+ * Array of correction factor used to weight eah pixel according to its
+ * radial distance to the image center.
+ */
+extern const double factors[NUMCAT];
+
+/** Structure to store the segmentation parameters */
+typedef struct {
+  /** Red/Blue treshold: r/b pix ratio < treshold -> sky */
+  double          rbtreshold;
+  /** Neighborhood side size in the convolution process (odd) */
+  int             neighbsize;
+  /** Number of votes needed to flip the pixel classification */
+  int             votes2flip;
+  /** R/B classifier built by compileClassifier: bit b of row r is set if
+      the pixel with red r and blue b is sky */
+  unsigned int    rbsky[256][8];
+  /** Numerator of the integer R/B test built by compileClassifier */
+  int             rbnum;
+  /** Denominator of the integer R/B test: sky if R * rbden < rbnum * B */
+  int             rbden;
+} SegParams;
+
+/** Structure to store the mask and the data derived from it */
+typedef struct {
+  /** Mask pixels (ARGB), opaque white inside the interest region */
+  unsigned int  **pix;
+  /** Mask width */
+  int             width;
+  /** Mask height */
+  int             height;
+  /** Reduction of the mask (and the images) with respect to full size */
+  int             scale;
+  /** Bounding box of the non transparent pixels: rows top, ..., bottom - 1
+      and columns left, ..., right - 1 */
+  int             top, bottom, left, right;
+  /** Number of bands of rows (one per thread) */
+  int             nbands;
+  /** nbands + 1 band limits, see partitionRows */
+  int            *bounds;
+  /** Spans of non transparent pixels, built by buildMaskSpans. The
+      spans of row top + k are rowspans[k], ..., rowspans[k + 1] - 1 */
+  int            *rowspans;
+  /** First column of each span */
+  int            *spanfrom;
+  /** Last column + 1 of each span */
+  int            *spanto;
+  /** Radial weight map, built by buildRadialMap: the pixels of each span
+      are divided in runs of consecutive pixels of the same weight
+      category. The runs of row top + k are rowruns[k], ...,
+      rowruns[k + 1] - 1 */
+  int            *rowruns;
+  /** First column of each run */
+  int            *runfrom;
+  /** Last column + 1 of each run */
+  int            *runto;
+  /** Weight category of each run (index of categories and factors), or
+      NUMCAT beyond the last category limit */
+  int            *runcat;
+} SkyMask;
+
+/** Structure to store the result of weighted pixel counting */
+typedef struct {
+  /** Cloud Cover Index */
+  double          ccindex;
+  /** Total weighted area of interest region */
+  double          totalarea;
+  /** Total number of pixels in interest region */
+  int             totalpels;
+  /** Seconds spent by the single pass processes (segmentImage,
+      segmentRegion and segmentStream) in the cut and classification of
+      the rows (their decoding too, in streaming mode), in the votes, and
+      in the pixel counting, added over the threads. 0 for
+      cloudcoverindex */
+  double          classifytime, votetime, counttime;
+} CCIResult;
+
+/** Histogram of the R/B ratios of the interest region of an image, by
+    weight category, used to get the CCI for many tresholds */
+typedef struct {
+  /** Pixels of the interest region in category c (NUMCAT + 1 of them,
+      the last one beyond the category limits, weight 0) whose R/B bin
+      is lower than k: below[c * (SWEEPBINS + 1) + k], k in [0,
+      SWEEPBINS]. The bin of a pixel is SWEEPSCALE * R / B rounded down,
+      or the last bin if it is larger or B = 0 */
+  long           *below;
+} RBHistogram;
+
+/**
+ * Pixels in each word of a bit plane.
+ */
+#define SEGBITS ((int) (8 * sizeof(unsigned long)))
+
+/** Structure to store a segmented image as two bit planes (2 bits per
+    pixel instead of the 32 of the ARGB format) */
+typedef struct {
+  /** Image width */
+  int             width;
+  /** Image height */
+  int             height;
+  /** Number of words in each row of a plane */
+  int             words;
+  /** Pixels inside the interest region (sky or cloud): the pixel in row
+      i, column j is the bit j % SEGBITS of the word i * words + j /
+      SEGBITS */
+  unsigned long  *inside;
+  /** Cloud pixels, in the same order */
+  unsigned long  *cloud;
+  /** Pool the planes were taken from, NULL if they were allocated */
+  BufPool        *pool;
+} SegImage;
+
+/**
+ * \brief Allocates an empty segmented image.
+ *
+ * @param[in] width is the image width.
+ * @param[in] height is the image height.
+ * \return the new image, every pixel outside the interest region, or
+ * NULL if there is not enough memory.
+ */
+SegImage       *newSegImage(int width, int height);
+
+/**
+ * \brief Takes an empty segmented image from a pool.
+ *
+ * Like newSegImage, but the planes are taken from the pool; freeSegImage
+ * gives them back.
+ *
+ * @param[in] bp is the pool (NULL to allocate the planes).
+ * @param[in] width is the image width.
+ * @param[in] height is the image height.
+ * \return the new image, every pixel outside the interest region, or
+ * NULL if there is not enough memory.
+ */
+SegImage       *newPooledSegImage(BufPool * bp, int width, int height);
+
+/**
+ * \brief Releases the memory used by a segmented image.
+ *
+ * The planes are given back to the pool they were taken from.
+ *
+ * @param[in] seg is the image, can be NULL.
+ */
+void            freeSegImage(SegImage * seg);
+
+/**
+ * \brief Value of a pixel of a segmented image.
+ *
+ * @param[in] seg is the image.
+ * @param[in] i is the pixel row.
+ * @param[in] j is the pixel column.
+ * \return SEGOUT, SEGSKY or SEGCLD.
+ */
+unsigned int    segPixel(SegImage * seg, int i, int j);
+
+/**
+ * \brief Converts a segmented image to the ARGB format.
+ *
+ * @param[in] seg is the image.
+ * \return the same image as returned by convolution.
+ */
+unsigned int  **segToImage(SegImage * seg);
+
+/**
+ * \brief Writes a segmented image to a PNG file.
+ *
+ * The image is written as a 2 bits per pixel palette PNG, packed
+ * directly from the bit planes: index 0 is SEGOUT (transparent), 1 is
+ * SEGSKY and 2 is SEGCLD. Read back with readPNGImage it gives the
+ * same pixels of segToImage, but the file is much smaller and faster to
+ * write than the ARGB one.
+ *
+ * @param[in] seg is the image.
+ * @param[in] fname is the file name.
+ * \return 1 if success, a negative number otherwise (see writePNGImage).
+ */
+int             writeSegImage(SegImage * seg, char *fname);
+
+/**
+ * \brief Writes a segmented image to a PNG file, compressed by several
+ * threads.
+ *
+ * Same as writeSegImage, but compressed in stripes as
+ * writeParallelPNGPalette does.
+ *
+ * @param[in] seg is the image.
+ * @param[in] fname is the file name.
+ * @param[in] nthreads is the number of threads.
+ * \return 1 if success, a negative number otherwise (see writePNGImage).
+ */
+int             writeParallelSegImage(SegImage * seg, char *fname,
+                                      int nthreads);
+
+/**
+ * \brief Builds the R/B classifier for the treshold of the parameters.
+ *
+ * The classification of every pair (red, blue) is computed once and
+ * stored as a table of 256 x 256 bits (8 KB), so the classification of
+ * each pixel needs no division and no floating point. A pixel is sky if
+ * red / blue < rbtreshold; a pixel with blue = 0 is cloud (its ratio is
+ * infinite, or undefined if red is also 0). The same classification is
+ * given by the integer test R * rbden < rbnum * B, used by the vector
+ * kernels (see classify.h). Must be called every time rbtreshold
+ * changes, before segmenting any image; the parameters can then be
+ * shared by all the images and threads.
+ *
+ * @param[in,out] sp are the segmentation parameters, rbtreshold is read
+ * and rbsky, rbnum and rbden are built.
+ */
+void            compileClassifier(SegParams * sp);
+
+/** 1 if the pixel with red r and blue b is sky, according to the
+    classifier compiled in the segmentation parameters sp */
+#define ISSKY(sp, r, b) (((sp)->rbsky[r][(b) >> 5] >> ((b) & 31)) & 1)
+
+/**
+ * \brief Tells if the vote can change the class of some pixel.
+ *
+ * A pixel is flipped when votes2flip or more of its neighborhood (of
+ * neighbsize x neighbsize pixels) are not of its class, so the vote does
+ * nothing if votes2flip is larger than the neighbors.
+ *
+ * @param[in] sp are the segmentation parameters.
+ * \return 1 if some pixel can be flipped, 0 otherwise.
+ */
+int             votesFlip(SegParams * sp);
+
+/**
+ * \brief Reads the mask from a PNG file.
+ *
+ * Reads the mask and divides its rows in nbands bands with a similar
+ * number of pixels inside the interest region (the middle rows of the
+ * sky circle contain much more pixels than the top and bottom ones).
+ * Band k is processed by thread k in the functions of this library.
+ *
+ * @param[in] fname is the name of the PNG file (ARGB, 8 bits per channel).
+ * @param[in] nbands is the number of threads used to process each image.
+ * @param[out] sm is the SkyMask structure where the mask is stored.
+ * \return 1 if success, 0 otherwise.
+ */
+int             loadSkyMask(char *fname, int nbands, SkyMask * sm);
+
+/**
+ * \brief Builds a reduced copy of a mask.
+ *
+ * Used to process images decoded at a reduced scale (quick-look). Each
+ * pixel of the reduced mask takes the value of the center of the
+ * corresponding scale x scale block, and the bands are rebuilt for the
+ * same number of threads. The radial weights of the reduced mask are
+ * taken at the full size distance, so the categories are the same. The
+ * weighted area is measured in pixels of the reduced image.
+ *
+ * @param[in] src is the full size mask.
+ * @param[in] scale is the reduction denominator.
+ * @param[out] dst is the SkyMask structure where the reduced mask is
+ * stored. It must be released with freeSkyMask.
+ * \return 1 if success, 0 if the mask is too small for the scale.
+ */
+int             scaleSkyMask(SkyMask * src, int scale, SkyMask * dst);
+
+/**
+ * \brief Releases the memory used by a mask.
+ *
+ * @param[in] sm is the SkyMask structure filled by loadSkyMask.
+ */
+void            freeSkyMask(SkyMask * sm);
+
+/**
+ * \brief Determines the weight factor used for a given pixel.
+ *
+ * Given the radial distance between some pixel and the image center, this
+ * function gets the index that must be used in the factors array to weight
+ * that pixel in the pixel counting.
+ * @param[in] t target to be search (a squared distance, as a double so
+ * that large images do not overflow an int).
+ * @param[in] carr is the array where the search must be performed (in our
+ * case the categories array must be used.
+ * @param[in] low minimum index in the carr array to be used for search
+ * (inclusive).
+ * @param[in] upp maximum index in the carr array to be used for search
+ * (inclusive).
+ * \return the index in the carra array where the first value greater or
+ * equal to the given value (t) is stored. This is the index that must be
+ * used in the factors array.
+ */
+int             catsearch(double t, const int carr[], int low, int upp);
+
+/**
+ * \brief Builds the spans of a mask.
+ *
+ * Each row of the mask bounding box is compiled into the list of its
+ * spans, the maximal runs of consecutive non transparent pixels. The
+ * image pixels out of the spans are always outside the interest region,
+ * so every stage works only on the spans, without testing the mask pixel
+ * by pixel. loadSkyMask and scaleSkyMask call this function; it must be
+ * called again, followed by buildRadialMap, if the pixels or the
+ * bounding box of the mask are changed by hand.
+ *
+ * @param[in,out] sm is the mask; rowspans, spanfrom and spanto are built.
+ * \return 1 if success, 0 if there is not enough memory.
+ */
+int             buildMaskSpans(SkyMask * sm);
+
+/**
+ * \brief Builds the radial weight map of a mask.
+ *
+ * The weight category of every pixel of the mask spans (see
+ * buildMaskSpans) is computed once (from the squared distance to the
+ * center, in pixels of the full size image), so the pixel counting only
+ * increments integer counters per category. Pixels farther than the last
+ * category limit are in the category NUMCAT: they are counted in the
+ * interest region but their weight is 0. loadSkyMask and scaleSkyMask
+ * call this function; it must be called again if the spans or the scale
+ * of the mask are changed by hand.
+ *
+ * @param[in,out] sm is the mask; rowruns, runfrom, runto and runcat are
+ * built.
+ * \return 1 if success, 0 if there is not enough memory.
+ */
+int             buildRadialMap(SkyMask * sm);
+
+/**
+ * \brief Read an image from a JPEG file and cuts it to the size of a given
+ * mask.
+ *
+ * Given a mask, whose size is enough to contain, exactly, the interest
+ * region of the images, this function reads and crop an original image to
+ * get only the interest region.
+ *
+ * @param[in] fname is the name of the file which contains the original
+ * JPEG RGB EXIF image to be processed for the program.
+ * @param[in] sm is the mask used to filter only the interest region of
+ * the whole original image.
+ * @param[out] wd is the width of interest region and, therefore, the width
+ * of resulting buffer image returned by the function. It's set from the
+ * width of mask.
+ * @param[out] hg is the height of interest region and, therefore, the height
+ * of resulting buffer image returned by the function. It's set from the
+ * height of mask.
+ * \return a 2-dimensional buffer with the data of image interest
+ * region. The data of pixel in row i, column j of such region is stored as
+ * the integer in the position [i][j] of the buffer returned by the
+ * function. The most significant byte is the A (alpha) component
+ * (transparency) of the pixel, followed by the R (red) component, the next
+ * one is the G (green), the least significant bye is the B (blue)
+ * component. Thus the integer (hex format) is AARRGGBB. NULL if the image
+ * cannot be read, is smaller than the mask or there is not enough
+ * memory.
+ */
+unsigned int  **readAndCut(char *fname, SkyMask * sm, int *wd, int *hg);
+
+/**
+ * \brief Classify the image pixels in two different cathegories (sky and
+ * cloud).
+ *
+ * Uses the R/B criteria for pixel classification. If the ratio R/B of
+ * pixel is below the threshold the pixel is classified as sky, if is above
+ * or equal the threshold, is classified as cloud pixel. Black pixels are
+ * outside the interest region. The rows are divided among the threads
+ * given by the mask bands.
+ * @param[in] thr is the threshold used to classify.
+ * @param[in] img is the input image (already cut).
+ * @param[in] sm is the mask, its size is the image size.
+ * \return the new segmented image. Black opaque pixels = Sky. White opaque
+ * pixels = Cloud. Transparent pixels = outside.
+ */
+unsigned int  **filterRB(double thr, unsigned int **img, SkyMask * sm);
+
+/**
+ * \brief Convolution operator to smooth borderline.
+ *
+ * Given the segmented image, this function smooth the borderline between
+ * the two diferent classes. A pixel changes its class if at least mv
+ * pixels in its neighborhood are in a different class (or outside the
+ * interest region). Pixels closer than sdsz / 2 to the border are left
+ * outside the interest region. The rows are divided among the threads
+ * given by the mask bands.
+ * @param[in] sdsz side size of neighborhood. This must be an odd integer.
+ * @param[in] mv minimum number of votes in the neighborhood needed to
+ * change the central pixel value.
+ * @param[in] img is the image to be convolved.
+ * @param[in] sm is the mask, its size is the image size.
+ * \return A new image buffer with the resulting convolved image.
+ */
+unsigned int  **convolution(int sdsz, int mv, unsigned int **img,
+                            SkyMask * sm);
+
+/**
+ * \brief Calculate the Cloud Cover Index.
+ *
+ * Performs the calculation of CCI (Cloud Cover Index) in the segmentes
+ * image. A correction factor is used given that the lens used deforms
+ * areas in diferent way according to the radial distance of pixel.
+ * The rows are divided among the threads given by the mask bands. The
+ * pixels are counted with integer counters per weight category (see
+ * buildRadialMap) and weighted at the end, so the result does not
+ * depend on the number of threads nor on the order of the pixels.
+ *
+ * @param[in] img is the image where the CCI will be calculated.
+ * @param[in] sm is the mask, its size is the image size.
+ * @param[out] ccr is the structure where the CCI, the total weighted area
+ * in the image interest region (whole sky area) and the total number of
+ * pixels in the interest region are stored.
+ * \return the proportion of image covered by clouds, according to the
+ * segmented image (white pixels proportion in the interest region)
+ */
+double          cloudcoverindex(unsigned int **img, SkyMask * sm,
+                                CCIResult * ccr);
+
+/**
+ * \brief Cuts, classifies, smooths and counts the pixels of an image in a
+ * single pass.
+ *
+ * Equivalent to readAndCut + filterRB + convolution + cloudcoverindex,
+ * but each row is processed by all the stages while it is in cache, and
+ * only a rolling window of neighbsize + 1 classified rows is kept (two
+ * bits per pixel). The trimmed and segmented images are built only if
+ * requested. The result is exactly the same of the separate stages, for
+ * any number of threads.
+ *
+ * @param[in] img is the whole original image (ARGB).
+ * @param[in] wi is the image width.
+ * @param[in] hi is the image height.
+ * @param[in] sm is the mask, centered in the image.
+ * @param[in] sp are the segmentation parameters.
+ * @param[out] cut is a buffer of the mask size where the trimmed image is
+ * stored, or NULL if not required.
+ * @param[out] seg is a segmented image of the mask size where the result
+ * is stored, or NULL if not required.
+ * @param[out] ccr is the structure where the CCI, the total weighted area
+ * and the total number of pixels of the interest region are stored.
+ * \return 1 if success, 0 if the image is smaller than the mask or there
+ * is not enough memory.
+ */
+int             segmentImage(unsigned int **img, int wi, int hi,
+                             SkyMask * sm, SegParams * sp,
+                             unsigned int **cut, SegImage * seg,
+                             CCIResult * ccr);
+
+/**
+ * \brief Reads only the part of an image inside the mask bounding box.
+ *
+ * The rows above the box are skipped and the columns out of it are
+ * cropped by the decompressor (when the JPEG library supports it), so
+ * most of the pixels thrown away by the mask are never decompressed.
+ *
+ * @param[in] jr is the reader of the original image, no row read yet.
+ * @param[in] wi is the image width.
+ * @param[in] hi is the image height.
+ * @param[in] sm is the mask, centered in the image.
+ * @param[in] bp is the pool the planes are taken from (NULL to allocate
+ * them).
+ * \return the box pixels in separate color planes (the classification
+ * only reads the channels it needs): row i, column j is the pixel under
+ * the mask pixel in row top + i, column left + j. The green plane is kept
+ * because black pixels are outside the interest region. NULL if the image
+ * cannot be read or is smaller than the mask.
+ */
+PlanarImage    *readMaskRegion(JPGReader * jr, int wi, int hi,
+                               SkyMask * sm, BufPool * bp);
+
+/**
+ * \brief Cuts, classifies, smooths and counts the pixels of the mask
+ * bounding box of an image.
+ *
+ * Same process of segmentImage, but the image is the buffer returned
+ * by readMaskRegion. The result is exactly the same.
+ *
+ * @param[in] reg is the box of the original image.
+ * @param[in] sm is the mask.
+ * @param[in] sp are the segmentation parameters.
+ * @param[out] cut is a buffer of the mask size where the trimmed image is
+ * stored, or NULL if not required.
+ * @param[out] seg is a segmented image of the mask size where the result
+ * is stored, or NULL if not required.
+ * @param[out] ccr is the structure where the CCI, the total weighted area
+ * and the total number of pixels of the interest region are stored.
+ * \return 1 if success, 0 if there is not enough memory (ccr is not
+ * changed).
+ */
+int             segmentRegion(PlanarImage * reg, SkyMask * sm,
+                              SegParams * sp, unsigned int **cut,
+                              SegImage * seg, CCIResult * ccr);
+
+/**
+ * \brief Cuts, classifies, smooths and counts the pixels of an image
+ * while it is read.
+ *
+ * Same process of segmentImage, but the image rows are taken from the
+ * JPEG decompressor as soon as they are available, so the whole image is
+ * never stored: only a row of the image and the rolling window of
+ * neighbsize classified rows are kept. As in readMaskRegion, only the
+ * mask bounding box is decompressed. The rows are processed by a
+ * single thread (the mask bands are not used). The result is exactly
+ * the same of segmentImage.
+ *
+ * @param[in] jr is the reader of the original image, no row read yet.
+ * @param[in] wi is the image width.
+ * @param[in] hi is the image height.
+ * @param[in] sm is the mask, centered in the image.
+ * @param[in] sp are the segmentation parameters.
+ * @param[out] cut is a buffer of the mask size where the trimmed image is
+ * stored, or NULL if not required.
+ * @param[out] seg is a segmented image of the mask size where the result
+ * is stored, or NULL if not required.
+ * @param[out] ccr is the structure where the CCI, the total weighted area
+ * and the total number of pixels of the interest region are stored.
+ * \return 1 if success, 0 if the image is smaller than the mask, -1 if
+ * the image data is corrupted or there is not enough memory.
+ */
+int             segmentStream(JPGReader * jr, int wi, int hi,
+                              SkyMask * sm, SegParams * sp,
+                              unsigned int **cut, SegImage * seg,
+                              CCIResult * ccr);
+
+/**
+ * \brief Builds the R/B ratio histogram of the mask bounding box of an
+ * image.
+ *
+ * The pixels counted are the ones that segmentRegion counts: inside the
+ * interest region and at least neighbsize / 2 pixels away from the
+ * borders of the mask image. The bands of the mask are processed by
+ * separate threads.
+ *
+ * @param[in] reg is the box of the original image (see readMaskRegion).
+ * @param[in] sm is the mask.
+ * @param[in] neighbsize is the neighborhood side size of the vote.
+ * \return the histogram, NULL if there is not enough memory. It must be
+ * released with freeRBHistogram.
+ */
+RBHistogram    *ratioHistogram(PlanarImage * reg, SkyMask * sm,
+                               int neighbsize);
+
+/**
+ * \brief Calculates the Cloud Cover Index without vote for a R/B
+ * treshold.
+ *
+ * Only the histogram is read, so the cost does not depend on the image
+ * size. The treshold is rounded to the nearest multiple of 1 /
+ * SWEEPSCALE in [0, SWEEPMAX]; for those tresholds the result is exactly
+ * the one of segmentRegion when the vote flips no pixel (see votesFlip).
+ *
+ * @param[in] rh is the histogram of the image.
+ * @param[in,out] thr is the treshold, rounded as it was used.
+ * @param[out] ccr is the structure where the CCI, the total weighted area
+ * and the total number of pixels of the interest region are stored.
+ * \return the CCI.
+ */
+double          sweepIndex(RBHistogram * rh, double *thr, CCIResult * ccr);
+
+/**
+ * \brief Releases a R/B ratio histogram.
+ *
+ * @param[in] rh is the histogram (can be NULL).
+ */
+void            freeRBHistogram(RBHistogram * rh);
+
+#endif
+/*
+ * segment.h ends here
+ */
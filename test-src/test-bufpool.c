@@ -0,0 +1,205 @@
+/**
+ * @file test-bufpool.c
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 16:40
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * @section DESCRIPTION
+ * Unit test for bufpool
+ *
+ */
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"bufpool.h"
+#include"parallel.h"
+
+#define NSIZES 3
+#define NWORKERS 4
+#define NROUNDS 200
+
+/*
+ * Sizes of the buffers of an image (file, small, planes), the exact
+ * sizes of their classes
+ */
+size_t          sizes[NSIZES] = { 3145728, 768, 20971520 };
+
+/*
+ * A worker that processes a series of images: the buffers are taken in
+ * an order that changes from one image to the next, and the file size
+ * changes inside its class
+ */
+void
+imageWorker(void *arg, int id)
+{
+    BufPool        *bp = (BufPool *) arg;
+    void           *bufs[NSIZES];
+    size_t          size;
+    int             i, k, n;
+
+    for (k = 0; k < NROUNDS; k++) {
+        for (n = 0; n < NSIZES; n++) {
+            i = (n + k + id) % NSIZES;
+            size = (i == 0) ? sizes[0] - 1000 * ((k + id) % 7) : sizes[i];
+            bufs[i] = takeBuffer(bp, size);
+            memset(bufs[i], id, 64);
+        }
+        for (n = 0; n < NSIZES; n++)
+            giveBuffer(bp, bufs[(n + id) % NSIZES]);
+    }
+}
+
+int
+main()
+{
+    BufPool        *bp;
+    void           *a, *b, *c, *d, *e, *f, *g, *bufs[NSIZES];
+    int             success = 0, total = 10;
+    int             i, k;
+    long            allocs = 0;
+    unsigned long   bytes;
+
+    /*
+     * without a pool the buffers are just allocated
+     */
+    a = takeBuffer(NULL, 100);
+    memset(a, 1, 100);
+    giveBuffer(NULL, a);
+    giveBuffer(NULL, NULL);
+    if (a != NULL)
+        success++;
+    else
+        fprintf(stderr, "takeBuffer test failed, no pool\n");
+
+    /*
+     * 1000 and 900 are in the class of 1024, 5000 and 4900 in the one of
+     * 5120
+     */
+    bp = newBufPool(3);
+    a = takeBuffer(bp, 1000);
+    b = takeBuffer(bp, 5000);
+    giveBuffer(bp, a);
+    giveBuffer(bp, b);
+    if ((takeBuffer(bp, 4900) == b) && (takeBuffer(bp, 900) == a) &&
+        (poolAllocations(bp) == 2))
+        success++;
+    else
+        fprintf(stderr, "takeBuffer test failed, buffers not reused\n");
+    /*
+     * a small request does not take a free buffer of a larger class
+     */
+    giveBuffer(bp, a);
+    giveBuffer(bp, b);
+    c = takeBuffer(bp, 500);
+    if ((c != a) && (c != b) && (poolAllocations(bp) == 3))
+        success++;
+    else
+        fprintf(stderr, "takeBuffer test failed, larger class used\n");
+    giveBuffer(bp, c);
+    d = takeBuffer(bp, 6000);
+    if ((d != a) && (d != b) && (poolAllocations(bp) == 4))
+        success++;
+    else
+        fprintf(stderr, "takeBuffer test failed, small buffer used\n");
+    /*
+     * the pool is full: the free buffers too small are replaced, and when
+     * every buffer is busy the new ones are not kept
+     */
+    e = takeBuffer(bp, 8000);
+    f = takeBuffer(bp, 8000);
+    g = takeBuffer(bp, 8000);
+    giveBuffer(bp, g);
+    giveBuffer(bp, d);
+    if ((d != NULL) && (e != NULL) && (f != NULL) && (g != NULL) &&
+        (poolAllocations(bp) == 7) && (takeBuffer(bp, 6000) == d))
+        success++;
+    else
+        fprintf(stderr, "takeBuffer test failed, full pool\n");
+    giveBuffer(bp, d);
+    giveBuffer(bp, e);
+    giveBuffer(bp, f);
+    freeBufPool(bp);
+
+    /*
+     * a series of images: no allocation after the first one
+     */
+    bp = newBufPool(NSIZES);
+    for (k = 0; k < 10; k++) {
+        for (i = 0; i < NSIZES; i++)
+            bufs[i] = takeBuffer(bp, sizes[i]);
+        for (i = 0; i < NSIZES; i++)
+            giveBuffer(bp, bufs[i]);
+        if (k == 0)
+            allocs = poolAllocations(bp);
+    }
+    if ((allocs == NSIZES) && (poolAllocations(bp) == NSIZES) &&
+        (poolAllocations(NULL) == 0))
+        success++;
+    else
+        fprintf(stderr, "takeBuffer test failed, %ld allocations\n",
+                poolAllocations(bp));
+    if ((poolBytes(bp) == sizes[0] + sizes[1] + sizes[2]) &&
+        (poolBytes(NULL) == 0))
+        success++;
+    else
+        fprintf(stderr, "poolBytes test failed, %lu bytes\n",
+                poolBytes(bp));
+    bufs[0] = takeBuffer(bp, sizes[0]);
+    poolUsage(bp, &i, &k, &bytes);
+    giveBuffer(bp, bufs[0]);
+    if ((i == NSIZES) && (k == 1) &&
+        (bytes == sizes[0] + sizes[1] + sizes[2]))
+        success++;
+    else
+        fprintf(stderr, "poolUsage test failed, %d kept %d busy\n", i, k);
+    freeBufPool(bp);
+    /*
+     * several workers share a pool of NSIZES buffers each: after the
+     * first images no buffer is allocated
+     */
+    bp = newBufPool(NSIZES * NWORKERS);
+    runThreads(NWORKERS, imageWorker, bp);
+    allocs = poolAllocations(bp);
+    runThreads(NWORKERS, imageWorker, bp);
+    if ((allocs <= NSIZES * NWORKERS) && (poolAllocations(bp) == allocs))
+        success++;
+    else
+        fprintf(stderr, "takeBuffer test failed, %ld allocations with %d "
+                "workers\n", poolAllocations(bp), NWORKERS);
+    freeBufPool(bp);
+    freeBufPool(NULL);
+    bp = newBufPool(0);
+    a = takeBuffer(bp, 10);
+    giveBuffer(bp, a);
+    if ((bp != NULL) && (a != NULL) && (poolAllocations(bp) == 1))
+        success++;
+    else
+        fprintf(stderr, "newBufPool test failed, empty pool\n");
+    freeBufPool(bp);
+    fprintf(stderr, " %d successful of %d tests \n", success, total);
+    if (success == total)
+      return 1;
+    else
+      return 0;
+}/* test-bufpool.c ends here */
@@ -0,0 +1,210 @@
+/**
+ * @file test-classify.c
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 15:40
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * @section DESCRIPTION
+ * Unit test for classify
+ *
+ */
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"classify.h"
+
+/*
+ * Row length: not a multiple of the vector sizes, and the rows start one
+ * pixel after the allocated blocks, so they are not aligned
+ */
+#define ROWLEN 1013
+#define NTRESH 5
+
+/*
+ * Tresholds (numerator, denominator) tried
+ */
+static const int tresh[NTRESH][2] = {
+    {4, 5}, {1, 3}, {0, 1}, {256, 1}, {255, 254}
+};
+
+/*
+ * Deterministic pseudo random numbers
+ */
+static unsigned long seed = 4321;
+
+unsigned int
+nextRandom()
+{
+    seed = seed * 1103515245 + 12345;
+    return (unsigned int) (seed >> 16) & 0X7FFF;
+}
+
+/*
+ * Row buffers of a test
+ */
+unsigned int    mskb[ROWLEN + 1], imgb[ROWLEN + 1];
+unsigned char   redb[ROWLEN + 1], greenb[ROWLEN + 1], blueb[ROWLEN + 1];
+unsigned int   *msk = mskb + 1, *img = imgb + 1;
+unsigned char  *red = redb + 1, *green = greenb + 1, *blue = blueb + 1;
+
+/*
+ * Random rows: mask with opaque, transparent and partial pixels, image
+ * with dark pixels and similar red and blue values
+ */
+void
+randomRows()
+{
+    unsigned int    r, g, b, k;
+    int             j;
+
+    for (j = 0; j < ROWLEN; j++) {
+        k = nextRandom() % 8;
+        msk[j] = (k < 5) ? 0XFFFFFFFF : (k < 7) ? 0 :
+            ((nextRandom() << 17) ^ nextRandom());
+        b = nextRandom() % 256;
+        r = (nextRandom() % 2) ? b - (b > 0) : nextRandom() % 256;
+        g = nextRandom() % 256;
+        if (nextRandom() % 10 == 0)
+            r = g = b = 0;
+        if (nextRandom() % 10 == 0)
+            b = 0;
+        red[j] = r;
+        green[j] = g;
+        blue[j] = b;
+        img[j] = (nextRandom() << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+/*
+ * Compares the results of the current kernel set with the scalar one
+ */
+int
+sameAsScalar(int kernel)
+{
+    unsigned char   cls0[ROWLEN], cls1[ROWLEN];
+    unsigned int    cut0[ROWLEN], cut1[ROWLEN];
+    int             t, num, den, good = 1;
+
+    for (t = 0; t < NTRESH; t++) {
+        randomRows();
+        num = tresh[t][0];
+        den = tresh[t][1];
+        selectClassifyKernel(KERNSCALAR);
+        classifyARGB(msk, img, ROWLEN, num, den, cls0, cut0);
+        selectClassifyKernel(kernel);
+        memset(cls1, 0XAA, ROWLEN);
+        memset(cut1, 0XAA, sizeof(cut1));
+        classifyARGB(msk, img, ROWLEN, num, den, cls1, cut1);
+        good = good && !memcmp(cls0, cls1, ROWLEN) &&
+            !memcmp(cut0, cut1, sizeof(cut0));
+        memset(cls1, 0XAA, ROWLEN);
+        classifyARGB(msk, img, ROWLEN, num, den, cls1, NULL);
+        good = good && !memcmp(cls0, cls1, ROWLEN);
+        memset(cut1, 0XAA, sizeof(cut1));
+        cutRow(msk, img, ROWLEN, cut1);
+        good = good && !memcmp(cut0, cut1, sizeof(cut0));
+
+        selectClassifyKernel(KERNSCALAR);
+        classifyPlanar(msk, red, green, blue, ROWLEN, num, den, cls0, cut0);
+        selectClassifyKernel(kernel);
+        memset(cls1, 0XAA, ROWLEN);
+        memset(cut1, 0XAA, sizeof(cut1));
+        classifyPlanar(msk, red, green, blue, ROWLEN, num, den, cls1, cut1);
+        good = good && !memcmp(cls0, cls1, ROWLEN) &&
+            !memcmp(cut0, cut1, sizeof(cut0));
+    }
+    return good;
+}
+
+int
+main()
+{
+    unsigned int    m[4] = { 0XFFFFFFFF, 0XFFFFFFFF, 0XFF00FFFF, 0 };
+    unsigned int    p[4] = { 0XFF7F00FF, 0XFF800100, 0XFF7F00FF, 0XFF102030 };
+    unsigned char   r[4] = { 0X7F, 0X80, 0X7F, 0X10 };
+    unsigned char   g[4] = { 0X00, 0X01, 0X00, 0X20 };
+    unsigned char   b[4] = { 0XFF, 0X00, 0XFF, 0X30 };
+    unsigned char   cls[4];
+    unsigned int    cut[4];
+    int             success = 0, total = 6;
+    int             k, sel;
+
+    /*
+     * portable kernels: 127/255 < 1/2 is sky, blue = 0 is cloud, red cut
+     * by the mask is sky, outside the mask is outside
+     */
+    selectClassifyKernel(KERNSCALAR);
+    classifyARGB(m, p, 4, 1, 2, cls, cut);
+    if ((cls[0] == CLSSKY) && (cls[1] == CLSCLD) && (cls[2] == CLSSKY) &&
+        (cls[3] == CLSOUT) && (cut[2] == 0XFF0000FF) && (cut[3] == 0))
+        success++;
+    else
+        fprintf(stderr, "classifyARGB test failed\n");
+    memset(cut, 0XAA, sizeof(cut));
+    classifyPlanar(m, r, g, b, 4, 1, 2, cls, cut);
+    if ((cls[0] == CLSSKY) && (cls[1] == CLSCLD) && (cls[2] == CLSSKY) &&
+        (cls[3] == CLSOUT) && (cut[0] == 0XFF7F00FF) &&
+        (cut[1] == 0XFF800100) && (cut[2] == 0XFF0000FF) && (cut[3] == 0))
+        success++;
+    else
+        fprintf(stderr, "classifyPlanar test failed\n");
+
+    /*
+     * selection: never wider than requested, scalar always available
+     */
+    sel = selectClassifyKernel(NUMKERNELS + 3);
+    if ((sel >= KERNSCALAR) && (sel < NUMKERNELS) &&
+        (classifyKernel() == sel) &&
+        (selectClassifyKernel(KERNSCALAR) == KERNSCALAR) &&
+        !strcmp(classifyKernelName(KERNSCALAR), "scalar") &&
+        !strcmp(classifyKernelName(NUMKERNELS), "?"))
+        success++;
+    else
+        fprintf(stderr, "selectClassifyKernel test failed\n");
+
+    /*
+     * every vector kernel set supported gives the same results
+     */
+    for (k = KERNSSE41; k < NUMKERNELS; k++) {
+        if (selectClassifyKernel(k) != k) {
+            fprintf(stderr, "%s kernels not supported, not tested\n",
+                    classifyKernelName(k));
+            success++;
+        } else if (sameAsScalar(k))
+            success++;
+        else
+            fprintf(stderr, "%s kernels test failed\n",
+                    classifyKernelName(k));
+    }
+
+    fprintf(stderr, " %d successful of %d tests \n", success, total);
+    if (success == total)
+        return 1;
+    else
+        return 0;
+}
+
+/*
+ * test-classify.c ends here
+ */
@@ -38,11 +38,22 @@
 int
 main()
 {
-    ImageInfo       imginfo;
-    CamAndShotInfo  caminfo;
-    int             totaltests = 21;
+    ImageInfo       imginfo, meminfo;
+    CamAndShotInfo  caminfo, memcam;
+    int             totaltests = 24;
     int             success = 0;
     char            cad[30];
+    FILE           *file;
+    unsigned char  *data;
+    long            size;
+    /*
+     * JPEG + EXIF header whose EXIF block has an empty IFD
+     */
+    unsigned char   noexif[] = {
+        0xFF, 0xD8, 0xFF, 0xE1, 0x00, 0x16, 'E', 'x', 'i', 'f', 0x00, 0x00,
+        'I', 'I', 0x2A, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0xFF, 0xD9
+    };
 
     fprintf(stderr, "Testing EXIF information retrieval... %d tests\n",
             totaltests);
@@ -155,6 +166,38 @@ main()
         success++;
     if (!strcmp(caminfo.aperture, "7.00 EV (f/11.3)"))
         success++;
+
+    /*
+     * the same data from the file contents in memory
+     */
+    file = fopen("Imgs/11841.jpg", "rb");
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data = (unsigned char *) malloc(size);
+    size = fread(data, 1, size, file);
+    fclose(file);
+    if ((getImgInfoData("Imgs/11841.jpg", data, size, 235.4, "UTC-05:00",
+                        &meminfo, &memcam) == 1) &&
+        !strcmp(meminfo.filename, imginfo.filename) &&
+        (meminfo.year == imginfo.year) && (meminfo.UTChr == imginfo.UTChr) &&
+        (meminfo.UTCsec == imginfo.UTCsec) &&
+        !strcmp(memcam.model, caminfo.model))
+        success++;
+    else
+        fprintf(stderr, "EXIF from memory test failed\n");
+    freeImgInfo(&meminfo, &memcam);
+    if (getImgInfoData("Imgs/11841.jpg", data, 3, 235.4, "UTC-05:00",
+                       &meminfo, &memcam) == -2)
+        success++;
+    else
+        fprintf(stderr, "EXIF from memory test failed, short data\n");
+    if (getImgInfoData("empty.jpg", noexif, sizeof(noexif), 235.4,
+                       "UTC-05:00", &meminfo, &memcam) == -6)
+        success++;
+    else
+        fprintf(stderr, "EXIF from memory test failed, no tags\n");
+    free(data);
 #ifdef DEBUG
      fprintf(stderr, "************** EXIF Data ****************\n");
      fprintf(stderr, "Filename: %s Format: %d Colormode: %d Exif: %s\n",
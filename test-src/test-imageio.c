@@ -31,6 +31,7 @@
  */
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
 #include"imageio.h"
 
 #define ROJO  0XFFFF0000
@@ -138,6 +139,55 @@ compareBuffers(unsigned int **b1, unsigned int **b2, int ancho, int alto)
     return good;
 }
 
+/**
+ * \brief Compare a buffer with a planar image.
+ *
+ * @param[in] b is the buffer (ARGB).
+ * @param[in] pi is the planar image, the green plane can be missing.
+ * @param[in] ancho is the buffer width.
+ * @param[in] alto is the buffer height.
+ * \return 1 is both images coincide pixel per pixel, 0 otherwise.
+ */
+int
+comparePlanes(unsigned int **b, PlanarImage * pi, int ancho, int alto)
+{
+    int             good = (pi != NULL) && (pi->width == ancho) &&
+        (pi->height == alto);
+    int             i, j, k;
+
+    for (i = 0; (i < alto) && good; i++) {
+        for (j = 0; (j < ancho) && good; j++) {
+            k = i * ancho + j;
+            good = (pi->red[k] == ((b[i][j] >> 16) & 0XFF)) &&
+                (pi->blue[k] == (b[i][j] & 0XFF)) &&
+                ((pi->green == NULL) ||
+                 (pi->green[k] == ((b[i][j] >> 8) & 0XFF)));
+        }
+    }
+    return good;
+}
+
+/**
+ * \brief Packed row of a 1 bit image with vertical stripes of 3 pixels:
+ * index 1 in the columns j with j / 3 odd.
+ *
+ * @param[in] arg is the image width (int).
+ * @param[in] i is the row number (unused).
+ * @param[out] buf is the buffer where the row is packed.
+ * \return buf.
+ */
+const unsigned char *
+stripesRow(void *arg, int i, unsigned char *buf)
+{
+    int             j, width = *((int *) arg);
+
+    memset(buf, 0, (width + 7) / 8);
+    for (j = 0; j < width; j++)
+        if ((j / 3) % 2)
+            buf[j / 8] |= 0X80 >> (j % 8);
+    return buf;
+}
+
 /**
  * \brief Testing program. Performs tha unit testing for each
  * functions in the imageio library.
@@ -148,9 +198,15 @@ main()
     int             ancho, alto;
     unsigned int  **imagen;
     unsigned int  **im2;
+    PlanarImage    *planes;
+    JPGReader      *reader;
+    unsigned char  *data;
+    size_t          size;
+    int             w, h, i, good;
 
     int             success = 0;
-    int             totaltests = 14;
+    int             totaltests = 20;
+    unsigned int    palette[2] = { TRANSP_ROJO, AZUL };
 
     /*
      * ==========================================================================
@@ -308,6 +364,109 @@ main()
     }
     else
         fprintf(stderr, "Wrong!!\n");
+
+    /*
+     * Reading a JPG in separate color planes, with and without green
+     */
+    imagen = readJPGImage("Imgs/11841.jpg", &ancho, &alto);
+    planes = readPlanarJPGImage("Imgs/11841.jpg", 1);
+    fprintf(stderr, "JPG reading RGB planes: \t");
+    if (comparePlanes(imagen, planes, ancho, alto)) {
+        fprintf(stderr, "OK\n");
+        success++;
+    }
+    else
+        fprintf(stderr, "Wrong!!\n");
+    freePlanarImage(planes);
+    planes = readPlanarJPGImage("Imgs/11841.jpg", 0);
+    fprintf(stderr, "JPG reading R/B planes: \t");
+    if (comparePlanes(imagen, planes, ancho, alto) && (planes->green == NULL)) {
+        fprintf(stderr, "OK\n");
+        success++;
+    }
+    else
+        fprintf(stderr, "Wrong!!\n");
+    freePlanarImage(planes);
+
+    /*
+     * Reading a JPG from the file contents in memory
+     */
+    data = readFileData(NULL, "Imgs/11841.jpg", &size);
+    reader = openMemJPGReader(data, size, 1, &w, &h);
+    fprintf(stderr, "JPG reading from memory: \t");
+    good = (reader != NULL) && (w == ancho) && (h == alto);
+    im2 = newImage(ancho, alto);
+    for (i = 0; good && (i < alto); i++)
+        good = readJPGRow(reader, im2[i]);
+    closeJPGReader(reader);
+    free(data);
+    if (good && compareBuffers(imagen, im2, ancho, alto)) {
+        fprintf(stderr, "OK\n");
+        success++;
+    }
+    else
+        fprintf(stderr, "Wrong!!\n");
+    freeImage(im2);
+
+    /*
+     * Writing a PNG compressed in stripes by several threads
+     */
+    fprintf(stderr, "Testing parallel PNG write...\t");
+    good = (writeParallelPNGImage(imagen, "test.png", ancho, alto, 4) == 1);
+    im2 = good ? readPNGImage("test.png", &w, &h) : NULL;
+    if ((im2 != NULL) && (w == ancho) && (h == alto) &&
+        compareBuffers(imagen, im2, ancho, alto)) {
+        fprintf(stderr, "OK\n");
+        success++;
+    }
+    else
+        fprintf(stderr, "Wrong!!\n");
+    freeImage(im2);
+    freeImage(imagen);
+
+    /*
+     * Writing a 1 bit palette image, read back as ARGB
+     */
+    w = 37;
+    h = 5;
+    fprintf(stderr, "Testing PNG palette write...\t");
+    good = (writePNGPalette("test.png", w, h, 1, palette, 2, stripesRow,
+                            &w) == 1);
+    im2 = good ? readPNGImage("test.png", &ancho, &alto) : NULL;
+    good = (im2 != NULL) && (ancho == w) && (alto == h);
+    for (i = 0; good && (i < w * h); i++)
+        good = (im2[i / w][i % w] == palette[((i % w) / 3) % 2]);
+    if (good) {
+        fprintf(stderr, "OK\n");
+        success++;
+    }
+    else
+        fprintf(stderr, "Wrong!!\n");
+    freeImage(im2);
+
+    /*
+     * The same palette image in 3 stripes (more threads than rows are
+     * reduced to one per row)
+     */
+    fprintf(stderr, "Testing parallel palette write...\t");
+    good = (writeParallelPNGPalette("test.png", w, h, 1, palette, 2,
+                                    stripesRow, &w, 3) == 1) &&
+        (writeParallelPNGPalette("test2.png", w, h, 1, palette, 2,
+                                 stripesRow, &w, 8) == 1);
+    im2 = good ? readPNGImage("test.png", &ancho, &alto) : NULL;
+    imagen = good ? readPNGImage("test2.png", &ancho, &alto) : NULL;
+    good = (im2 != NULL) && (imagen != NULL) && (ancho == w) && (alto == h);
+    for (i = 0; good && (i < w * h); i++)
+        good = (im2[i / w][i % w] == palette[((i % w) / 3) % 2]) &&
+            (imagen[i / w][i % w] == im2[i / w][i % w]);
+    if (good) {
+        fprintf(stderr, "OK\n");
+        success++;
+    }
+    else
+        fprintf(stderr, "Wrong!!\n");
+    freeImage(im2);
+    freeImage(imagen);
     fprintf(stderr, "%d / %d tests passed\n", success, totaltests);
     if (success == totaltests) {
         fprintf(stderr, "\n imageio COMPLETE TEST SUCCESSFUL!\n");
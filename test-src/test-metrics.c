@@ -0,0 +1,131 @@
+/**
+ * @file test-metrics.c
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 18:45
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * @section DESCRIPTION
+ * Unit test for metrics
+ *
+ */
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"metrics.h"
+
+#define NBOUNDS 3
+
+/*
+ * Expected contents of the metrics file
+ */
+const char     *expected =
+    "# HELP test_images_total Images processed.\n"
+    "# TYPE test_images_total counter\n"
+    "test_images_total 42\n"
+    "test_failures_total{reason=\"exif\"} 2\n"
+    "# HELP test_latency_seconds Latency.\n"
+    "# TYPE test_latency_seconds histogram\n"
+    "test_latency_seconds_bucket{stage=\"read\",le=\"0.1\"} 2\n"
+    "test_latency_seconds_bucket{stage=\"read\",le=\"0.5\"} 3\n"
+    "test_latency_seconds_bucket{stage=\"read\",le=\"1\"} 3\n"
+    "test_latency_seconds_bucket{stage=\"read\",le=\"+Inf\"} 4\n"
+    "test_latency_seconds_sum{stage=\"read\"} 2.85\n"
+    "test_latency_seconds_count{stage=\"read\"} 4\n"
+    "test_latency_seconds_bucket{le=\"0.1\"} 0\n"
+    "test_latency_seconds_bucket{le=\"0.5\"} 0\n"
+    "test_latency_seconds_bucket{le=\"1\"} 0\n"
+    "test_latency_seconds_bucket{le=\"+Inf\"} 0\n"
+    "test_latency_seconds_sum 0\n"
+    "test_latency_seconds_count 0\n";
+
+/*
+ * Histograms written by the test
+ */
+Histogram       hread, hempty;
+
+void
+writeTest(FILE * f, void *arg)
+{
+    writeMetricHeader(f, "test_images_total", "counter",
+                      "Images processed.");
+    writeSample(f, "test_images_total", NULL, 42);
+    writeSample(f, "test_failures_total", "reason=\"exif\"", 2);
+    writeMetricHeader(f, "test_latency_seconds", "histogram", "Latency.");
+    writeHistogram(f, "test_latency_seconds", "stage=\"read\"", &hread);
+    writeHistogram(f, "test_latency_seconds", NULL, &hempty);
+}
+
+int
+main()
+{
+    double          bounds[NBOUNDS] = { 0.1, 0.5, 1.0 };
+    char            buf[2048];
+    FILE           *f;
+    size_t          n;
+    int             success = 0, total = 4;
+
+    initHistogram(&hread, bounds, NBOUNDS);
+    initHistogram(&hempty, bounds, NBOUNDS);
+    observeValue(&hread, 0.05);
+    observeValue(&hread, 0.1);
+    observeValue(&hread, 0.2);
+    observeValue(&hread, 2.5);
+    if ((hread.count[0] == 2) && (hread.count[1] == 1) &&
+        (hread.count[2] == 0) && (hread.count[3] == 1) &&
+        (hread.total == 4))
+        success++;
+    else
+        fprintf(stderr, "observeValue test failed, wrong buckets\n");
+
+    if (writeMetricsFile("test.prom", writeTest, NULL))
+        success++;
+    else
+        fprintf(stderr, "writeMetricsFile test failed, not written\n");
+    f = fopen("test.prom", "r");
+    n = (f != NULL) ? fread(buf, 1, sizeof(buf) - 1, f) : 0;
+    buf[n] = '\0';
+    if (f != NULL)
+        fclose(f);
+    if (strcmp(buf, expected) == 0)
+        success++;
+    else
+        fprintf(stderr, "writeMetricsFile test failed, contents:\n%s", buf);
+    /*
+     * the temporary file is renamed, and an unwritable file is reported
+     */
+    f = fopen("test.prom.tmp", "r");
+    if ((f == NULL) &&
+        !writeMetricsFile("no-such-dir/test.prom", writeTest, NULL))
+        success++;
+    else
+        fprintf(stderr, "writeMetricsFile test failed, temporary file\n");
+    if (f != NULL)
+        fclose(f);
+    remove("test.prom");
+    fprintf(stderr, " %d successful of %d tests \n", success, total);
+    if (success == total)
+      return 1;
+    else
+      return 0;
+}/* test-metrics.c ends here */
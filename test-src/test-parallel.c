@@ -0,0 +1,125 @@
+/**
+ * @file test-parallel.c
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 11:02
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * @section DESCRIPTION
+ * Unit test for parallel
+ *
+ */
+#include<stdio.h>
+#include<stdlib.h>
+#include"parallel.h"
+
+#define NTHR 8
+#define NROWS 100
+
+/*
+ * Each thread marks its own slot
+ */
+void
+mark(void *arg, int id)
+{
+    int            *slots = (int *) arg;
+
+    slots[id]++;
+}
+
+int
+main()
+{
+    int             slots[NTHR];
+    int             weight[NROWS], bounds[NTHR + 1];
+    int             success = 0, total = 8;
+    int             i, k, sum, good;
+    double          t0, c0, x;
+
+    for (i = 0; i < NTHR; i++)
+        slots[i] = 0;
+    if (runThreads(NTHR, mark, slots) == NTHR)
+        success++;
+    else
+        fprintf(stderr, "runThreads test failed, wrong return value\n");
+    for (i = 0, good = 1; i < NTHR; i++)
+        good = good && (slots[i] == 1);
+    if (good)
+        success++;
+    else
+        fprintf(stderr, "runThreads test failed, thread not run once\n");
+    if (runThreads(0, mark, slots) == 0)
+        success++;
+    else
+        fprintf(stderr, "runThreads test failed, zero threads accepted\n");
+    /*
+     * triangular weights: heavy rows in the middle, as in the sky circle
+     */
+    for (i = 0; i < NROWS; i++)
+        weight[i] = (i < NROWS / 2) ? i : NROWS - i;
+    partitionRows(weight, NROWS, NTHR, bounds);
+    if ((bounds[0] == 0) && (bounds[NTHR] == NROWS))
+        success++;
+    else
+        fprintf(stderr, "partitionRows test failed, limits %d %d\n",
+                bounds[0], bounds[NTHR]);
+    /*
+     * every band weight close to 1/NTHR of total (2500), middle bands are
+     * narrower than outer bands
+     */
+    for (k = 0, good = 1; k < NTHR; k++) {
+        for (i = bounds[k], sum = 0; i < bounds[k + 1]; i++)
+            sum += weight[i];
+        good = good && (sum >= 2500 / NTHR - NROWS / 2)
+            && (sum <= 2500 / NTHR + NROWS / 2);
+    }
+    if (good)
+        success++;
+    else
+        fprintf(stderr, "partitionRows test failed, unbalanced bands\n");
+    if ((bounds[NTHR / 2 + 1] - bounds[NTHR / 2]) < (bounds[1] - bounds[0]))
+        success++;
+    else
+        fprintf(stderr, "partitionRows test failed, bands by row count\n");
+    if (numProcessors() >= 1)
+        success++;
+    else
+        fprintf(stderr, "numProcessors test failed %d\n", numProcessors());
+    /*
+     * both clocks advance while the process works
+     */
+    t0 = wallClock();
+    c0 = cpuClock();
+    for (i = 0, x = 0.0; (wallClock() - t0 < 0.05) || (cpuClock() == c0);
+         i++)
+        x += i * 0.5;
+    if ((wallClock() > t0) && (cpuClock() > c0) && (x >= 0.0))
+        success++;
+    else
+        fprintf(stderr, "wallClock / cpuClock test failed\n");
+    fprintf(stderr, " %d successful of %d tests \n", success, total);
+    if (success == total)
+      return 1;
+    else
+      return 0;
+}/* test-parallel.c ends here */
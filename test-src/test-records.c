@@ -0,0 +1,143 @@
+/**
+ * @file test-records.c
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 19:05
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * @section DESCRIPTION
+ * Unit test for records
+ *
+ */
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"records.h"
+
+#define NFIELDS 3
+#define MANY 10000
+
+/*
+ * Names of the fields of the test records
+ */
+const char     *names[NFIELDS] = { "file", "cci", "pixels" };
+
+/*
+ * Expected output in each format
+ */
+const char     *expected[3] = {
+    "a.jpg 0.295244 120\n"
+        "b,\"c\".jpg -1.500000 0\n",
+    "file,cci,pixels\n"
+        "a.jpg,0.295244,120\n"
+        "\"b,\"\"c\"\".jpg\",-1.500000,0\n",
+    "{\"file\":\"a.jpg\",\"cci\":0.295244,\"pixels\":120}\n"
+        "{\"file\":\"b,\\\"c\\\".jpg\",\"cci\":-1.500000,\"pixels\":0}\n"
+};
+
+/*
+ * Writes the test records in a temporary file and reads them back;
+ * before the flush the file must be empty
+ */
+int
+writeTest(int format, char *buf, size_t size)
+{
+    RecordWriter   *rw;
+    FILE           *f = tmpfile();
+    size_t          n;
+    int             buffered;
+
+    if (f == NULL)
+        return 0;
+    rw = newRecordWriter(f, format, names, NFIELDS);
+    putString(rw, "a.jpg");
+    putDouble(rw, 0.295244);
+    putInt(rw, 120);
+    endRecord(rw);
+    putString(rw, "b,\"c\".jpg");
+    putDouble(rw, -1.5);
+    putInt(rw, 0);
+    endRecord(rw);
+    fseek(f, 0, SEEK_END);
+    buffered = (ftell(f) == 0);
+    if (!freeRecordWriter(rw))
+        buffered = 0;
+    rewind(f);
+    n = fread(buf, 1, size - 1, f);
+    buf[n] = '\0';
+    fclose(f);
+    return buffered;
+}
+
+int
+main()
+{
+    const char     *fmtname[3] = { "text", "csv", "jsonl" };
+    char            buf[1024];
+    RecordWriter   *rw;
+    FILE           *f;
+    long            size;
+    int             k, success = 0, total = 6;
+
+    for (k = FMT_TEXT; k <= FMT_JSONL; k++) {
+        if (writeTest(k, buf, sizeof(buf)) && (strcmp(buf, expected[k]) == 0))
+            success++;
+        else
+            fprintf(stderr, "%s records test failed, output:\n%s",
+                    fmtname[k], buf);
+    }
+    if ((recordFormat("csv") == FMT_CSV) &&
+        (recordFormat("jsonl") == FMT_JSONL) && (recordFormat("xml") == -1))
+        success++;
+    else
+        fprintf(stderr, "recordFormat test failed\n");
+    /*
+     * more records than the buffer holds
+     */
+    f = tmpfile();
+    rw = newRecordWriter(f, FMT_TEXT, NULL, 0);
+    for (k = 0; k < MANY; k++) {
+        putString(rw, "image.jpg");
+        putInt(rw, k % 10);
+        endRecord(rw);
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    if ((size > 0) && (size <= RECBUFSIZE))
+        success++;
+    else
+        fprintf(stderr, "buffer test failed, %ld bytes written\n", size);
+    freeRecordWriter(rw);
+    fseek(f, 0, SEEK_END);
+    if (ftell(f) == 12L * MANY)
+        success++;
+    else
+        fprintf(stderr, "flush test failed, %ld bytes\n", ftell(f));
+    fclose(f);
+    fprintf(stderr, " %d successful of %d tests \n", success, total);
+    if (success == total)
+      return 1;
+    else
+      return 0;
+}/* test-records.c ends here */
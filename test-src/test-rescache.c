@@ -0,0 +1,165 @@
+/**
+ * @file test-rescache.c
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 19:40
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * @section DESCRIPTION
+ * Unit test for rescache
+ *
+ */
+#include<stdio.h>
+#include<stddef.h>
+#include<stdlib.h>
+#include<string.h>
+#include"rescache.h"
+
+#define CACHEFILE "test-cache.bin"
+#define DATALEN 1001
+
+int
+main()
+{
+    unsigned char   data[DATALEN];
+    unsigned int    h[2], g[2], params[2] = { 1, 2 }, other[2] = { 1, 3 };
+    double          value = 0.295244, got;
+    ResultCache    *rc, *rc2;
+    CacheKey        k, k2, keys[CACHEWAYS + 1];
+    FILE           *f;
+    int             i, ok, success = 0, total = 8;
+
+    for (i = 0; i < DATALEN; i++)
+        data[i] = (unsigned char) (i * 7 + 3);
+    hashBytes(data, DATALEN, h);
+    hashBytes(data, DATALEN, g);
+    ok = (h[0] == g[0]) && (h[1] == g[1]) && (h[0] != h[1]);
+    data[DATALEN - 1] ^= 1;
+    hashBytes(data, DATALEN, g);
+    if (ok && (h[0] != g[0]) && (h[1] != g[1]))
+        success++;
+    else
+        fprintf(stderr, "hashBytes test failed\n");
+
+    f = fopen("test-hash.bin", "wb");
+    fwrite(data, 1, DATALEN, f);
+    fclose(f);
+    if (hashFile("test-hash.bin", h) && (h[0] == g[0]) && (h[1] == g[1]) &&
+        !hashFile("no-such-file", h))
+        success++;
+    else
+        fprintf(stderr, "hashFile test failed\n");
+    remove("test-hash.bin");
+
+    /*
+     * a new cache, a value stored and found, not with other parameters
+     */
+    remove(CACHEFILE);
+    rc = openResultCache(CACHEFILE, 64);
+    makeCacheKey(&k, data, DATALEN, params);
+    makeCacheKey(&k2, data, DATALEN, other);
+    if ((rc != NULL) && !cacheLookup(rc, &k, &got, sizeof(got)) &&
+        cacheStore(rc, &k, &value, sizeof(value)) &&
+        cacheLookup(rc, &k, &got, sizeof(got)) && (got == value))
+        success++;
+    else
+        fprintf(stderr, "cacheStore test failed\n");
+    if ((rc != NULL) && !cacheLookup(rc, &k2, &got, sizeof(got)))
+        success++;
+    else
+        fprintf(stderr, "cacheLookup test failed, other parameters\n");
+
+    /*
+     * another handle of the same file sees the value
+     */
+    rc2 = openResultCache(CACHEFILE, 8);
+    got = 0.0;
+    if ((rc2 != NULL) && (rc2->nsets == 64 / CACHEWAYS) &&
+        cacheLookup(rc2, &k, &got, sizeof(got)) && (got == value))
+        success++;
+    else
+        fprintf(stderr, "openResultCache test failed, shared file\n");
+    closeResultCache(rc);
+    closeResultCache(rc2);
+
+    /*
+     * a single set: the least recently used entry is replaced
+     */
+    remove(CACHEFILE);
+    rc = openResultCache(CACHEFILE, 1);
+    for (i = 0; i <= CACHEWAYS; i++) {
+        data[0] = (unsigned char) i;
+        makeCacheKey(&keys[i], data, DATALEN, params);
+    }
+    for (i = 0; (rc != NULL) && (i < CACHEWAYS); i++) {
+        value = i;
+        cacheStore(rc, &keys[i], &value, sizeof(value));
+    }
+    ok = (rc != NULL) && cacheLookup(rc, &keys[0], &got, sizeof(got));
+    value = CACHEWAYS;
+    ok = ok && cacheStore(rc, &keys[CACHEWAYS], &value, sizeof(value));
+    if (ok && cacheLookup(rc, &keys[0], &got, sizeof(got)) && (got == 0.0) &&
+        !cacheLookup(rc, &keys[1], &got, sizeof(got)) &&
+        cacheLookup(rc, &keys[CACHEWAYS], &got, sizeof(got)) &&
+        (got == CACHEWAYS))
+        success++;
+    else
+        fprintf(stderr, "cacheStore test failed, LRU eviction\n");
+    closeResultCache(rc);
+
+    /*
+     * a damaged entry is not returned
+     */
+    f = fopen(CACHEFILE, "r+b");
+    fseek(f, offsetof(CacheEntry, value) - (long) sizeof(CacheEntry),
+          SEEK_END);
+    fputc(0x55, f);
+    fclose(f);
+    rc = openResultCache(CACHEFILE, 1);
+    ok = 0;
+    for (i = 0; (rc != NULL) && (i <= CACHEWAYS); i++)
+        ok += cacheLookup(rc, &keys[i], &got, sizeof(got));
+    if (ok == CACHEWAYS - 1)
+        success++;
+    else
+        fprintf(stderr, "cacheLookup test failed, damaged entry\n");
+    closeResultCache(rc);
+
+    /*
+     * a file that is not a cache
+     */
+    f = fopen(CACHEFILE, "wb");
+    fputs("not a cache file, just text", f);
+    fclose(f);
+    if (openResultCache(CACHEFILE, 64) == NULL)
+        success++;
+    else
+        fprintf(stderr, "openResultCache test failed, wrong file\n");
+    remove(CACHEFILE);
+    fprintf(stderr, " %d successful of %d tests \n", success, total);
+    if (success == total)
+      return 1;
+    else
+      return 0;
+}/* test-rescache.c ends here */
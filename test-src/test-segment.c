@@ -0,0 +1,545 @@
+/**
+ * @file test-segment.c
+ *
+ * @author José Galaviz <jgc@fciencias.unam.mx>
+ * @version 1.0
+ * \date 17/Oct/2026 - 13:30
+ *
+ * Facultad de Ciencias,
+ * Universidad Nacional Autónoma de México, México.
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, visit the following URL:
+ * (http://www.gnu.org/licenses/gpl.html)
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * @section DESCRIPTION
+ * Unit test for segment
+ *
+ */
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"imageio.h"
+#include"parallel.h"
+#include"segment.h"
+
+#define IMGW 130
+#define IMGH 120
+#define MSKW 100
+#define MSKH 90
+#define RADIUS 42
+
+/*
+ * Deterministic pseudo random numbers
+ */
+static unsigned long seed = 12345;
+
+unsigned int
+nextRandom()
+{
+    seed = seed * 1103515245 + 12345;
+    return (unsigned int) (seed >> 16) & 0X7FFF;
+}
+
+/*
+ * Synthetic sky: blue pixels, white patches and some black pixels
+ */
+unsigned int  **
+syntheticImage()
+{
+    unsigned int  **img = newImage(IMGW, IMGH);
+    unsigned int    r, g, b;
+    int             i, j;
+
+    for (i = 0; i < IMGH; i++)
+        for (j = 0; j < IMGW; j++) {
+            b = 100 + nextRandom() % 156;
+            if (((i / 10) + (j / 15)) % 3 == 0)
+                r = b - nextRandom() % 40;      /* cloud like */
+            else
+                r = nextRandom() % 200;
+            g = nextRandom() % 256;
+            if (nextRandom() % 50 == 0)
+                r = g = b = 0;
+            img[i][j] = 0XFF000000 | (r << 16) | (g << 8) | b;
+        }
+    return img;
+}
+
+/*
+ * Circular mask with a transparent bar in its upper half (so some rows
+ * have two spans), and its bands for nbands threads
+ */
+void
+syntheticMask(SkyMask * sm, int nbands)
+{
+    int             i, j, di, dj;
+    int             weight[MSKH];
+
+    sm->pix = newImage(MSKW, MSKH);
+    sm->width = MSKW;
+    sm->height = MSKH;
+    sm->scale = 1;
+    for (i = 0; i < MSKH; i++) {
+        weight[i] = 0;
+        for (j = 0; j < MSKW; j++) {
+            di = i - MSKH / 2;
+            dj = j - MSKW / 2;
+            sm->pix[i][j] = (di * di + dj * dj <= RADIUS * RADIUS) ?
+                0XFFFFFFFF : 0X00000000;
+            if ((di < 0) && (dj >= 10) && (dj < 14))
+                sm->pix[i][j] = 0X00000000;
+            if (sm->pix[i][j])
+                weight[i]++;
+        }
+    }
+    sm->top = MSKH / 2 - RADIUS;
+    sm->bottom = MSKH / 2 + RADIUS + 1;
+    sm->left = MSKW / 2 - RADIUS;
+    sm->right = MSKW / 2 + RADIUS + 1;
+    sm->nbands = nbands;
+    sm->bounds = (int *) malloc((nbands + 1) * sizeof(int));
+    partitionRows(weight, MSKH, nbands, sm->bounds);
+    buildMaskSpans(sm);
+    buildRadialMap(sm);
+}
+
+int
+sameImage(unsigned int **a, unsigned int **b)
+{
+    return !memcmp(a[0], b[0], MSKW * MSKH * sizeof(unsigned int));
+}
+
+/*
+ * Same pixels in a segmented image and its ARGB version
+ */
+int
+sameSegImage(unsigned int **a, SegImage * b)
+{
+    int             i, j;
+
+    for (i = 0; i < MSKH; i++)
+        for (j = 0; j < MSKW; j++)
+            if (a[i][j] != segPixel(b, i, j))
+                return 0;
+    return 1;
+}
+
+/*
+ * Size of a file in bytes, -1 if it cannot be read
+ */
+long
+fileSize(char *fname)
+{
+    FILE           *f = fopen(fname, "rb");
+    long            n = -1;
+
+    if (f == NULL)
+        return -1;
+    if (fseek(f, 0, SEEK_END) == 0)
+        n = ftell(f);
+    fclose(f);
+    return n;
+}
+
+/*
+ * Vote by direct counting of the neighbors of each pixel
+ */
+void
+directVote(unsigned int **img, int sdsz, int mv, unsigned int **res)
+{
+    int             i, j, n, m, nv, nesi = sdsz / 2;
+
+    memset(res[0], 0, MSKW * MSKH * sizeof(unsigned int));
+    for (i = nesi; i < MSKH - nesi; i++)
+        for (j = nesi; j < MSKW - nesi; j++) {
+            if (img[i][j] == SEGOUT)
+                continue;
+            nv = 0;
+            for (n = i - nesi; n <= i + nesi; n++)
+                for (m = j - nesi; m <= j + nesi; m++)
+                    nv += (img[n][m] != img[i][j]);
+            res[i][j] = (nv >= mv) ? (0XFF000000 | ~img[i][j]) : img[i][j];
+        }
+}
+
+int
+main()
+{
+    SkyMask         sm, sm3, half;
+    SegParams       sp, novote;
+    CCIResult       ref, res, res3;
+    RBHistogram    *rh;
+    unsigned int  **img, **cut, **seg, **conv, **mycut, **myseg;
+    SegImage       *pseg, *refseg, *poolseg;
+    BufPool        *pool;
+    int             success = 0, total = 25;
+    unsigned int  **jpg;
+    PlanarImage    *reg;
+    JPGReader      *jr;
+    double          tresh[5] = { 0.5, 0.8, 1.0 / 3.0, 0.0, 1.0 };
+    double          sweep[5] = { 0.0, 0.5, 0.95, 1.234, 4.0 };
+    double          thr;
+    int             side[3] = { 4, 7, 11 };
+    int             i, j, k, mv, mh, wj, hj, wrong, in, spans;
+
+    /*
+     * compiled classifier, same as the red/blue ratio
+     */
+    wrong = 0;
+    for (k = 0; k < 5; k++) {
+        sp.rbtreshold = tresh[k];
+        compileClassifier(&sp);
+        for (i = 0; i < 256; i++)
+            for (j = 0; j < 256; j++)
+                if ((ISSKY(&sp, i, j) != ((j > 0) &&
+                                          ((double) i / (double) j <
+                                           tresh[k]))) ||
+                    (ISSKY(&sp, i, j) != (i * sp.rbden < sp.rbnum * j)))
+                    wrong++;
+    }
+    sp.rbtreshold = 0.5;
+    compileClassifier(&sp);
+    if ((wrong == 0) && !ISSKY(&sp, 0, 0) && ISSKY(&sp, 0, 1) &&
+        !ISSKY(&sp, 1, 2) && ISSKY(&sp, 1, 3))
+        success++;
+    else
+        fprintf(stderr, "compileClassifier test failed, %d errors\n", wrong);
+
+    sp.rbtreshold = 0.8;
+    sp.neighbsize = 5;
+    sp.votes2flip = 10;
+    compileClassifier(&sp);
+    img = syntheticImage();
+    syntheticMask(&sm, 1);
+    syntheticMask(&sm3, 3);
+
+    /*
+     * separate stages
+     */
+    cut = newImage(MSKW, MSKH);
+    mh = (IMGW - MSKW) / 2;
+    mv = (IMGH - MSKH) / 2;
+    for (i = 0; i < MSKH; i++)
+        for (j = 0; j < MSKW; j++)
+            cut[i][j] = sm.pix[i][j] & img[i + mv][j + mh];
+    seg = filterRB(sp.rbtreshold, cut, &sm);
+    conv = convolution(sp.neighbsize, sp.votes2flip, seg, &sm);
+    cloudcoverindex(conv, &sm, &ref);
+
+    /*
+     * single pass
+     */
+    mycut = newImage(MSKW, MSKH);
+    myseg = newImage(MSKW, MSKH);
+    pseg = newSegImage(MSKW, MSKH);
+    refseg = newSegImage(MSKW, MSKH);
+    if (segmentImage(img, IMGW, IMGH, &sm, &sp, mycut, pseg, &res))
+        success++;
+    else
+        fprintf(stderr, "segmentImage test failed, image rejected\n");
+    if (sameImage(cut, mycut))
+        success++;
+    else
+        fprintf(stderr, "segmentImage test failed, trimmed image\n");
+    if (sameSegImage(conv, pseg))
+        success++;
+    else
+        fprintf(stderr, "segmentImage test failed, segmented image\n");
+    if ((res.ccindex == ref.ccindex) && (res.totalarea == ref.totalarea) &&
+        (res.totalpels == ref.totalpels) && (ref.totalpels > 0))
+        success++;
+    else
+        fprintf(stderr, "segmentImage test failed, CCI %f vs %f\n",
+                res.ccindex, ref.ccindex);
+    if ((res.classifytime > 0.0) && (res.votetime > 0.0) &&
+        (res.counttime > 0.0) && (ref.classifytime == 0.0))
+        success++;
+    else
+        fprintf(stderr, "segmentImage test failed, stage times\n");
+
+    /*
+     * several threads, and no intermediate images
+     */
+    memset(pseg->inside, 0XAA, 2 * MSKH * pseg->words * sizeof(long));
+    segmentImage(img, IMGW, IMGH, &sm3, &sp, NULL, pseg, &res3);
+    if (sameSegImage(conv, pseg) && (res3.ccindex == ref.ccindex))
+        success++;
+    else
+        fprintf(stderr, "segmentImage test failed, 3 threads\n");
+    segmentImage(img, IMGW, IMGH, &sm3, &sp, NULL, NULL, &res3);
+    if ((res3.ccindex == ref.ccindex) && (res3.totalarea == ref.totalarea))
+        success++;
+    else
+        fprintf(stderr, "segmentImage test failed, no images\n");
+    if (!segmentImage(img, MSKW - 1, IMGH, &sm, &sp, NULL, NULL, &res))
+        success++;
+    else
+        fprintf(stderr, "segmentImage test failed, small image accepted\n");
+
+    /*
+     * streaming from a JPEG file, same result of the whole image
+     */
+    jpg = readJPGImage("Imgs/11841.jpg", &wj, &hj);
+    segmentImage(jpg, wj, hj, &sm3, &sp, NULL, refseg, &ref);
+    freeImage(conv);
+    conv = segToImage(refseg);
+    jr = openJPGReader("Imgs/11841.jpg", &wj, &hj);
+    if ((jr != NULL) &&
+        (segmentStream(jr, wj, hj, &sm, &sp, mycut, pseg, &res) == 1) &&
+        sameSegImage(conv, pseg) && (res.ccindex == ref.ccindex) &&
+        (res.totalarea == ref.totalarea))
+        success++;
+    else
+        fprintf(stderr, "segmentStream test failed\n");
+    closeJPGReader(jr);
+    jr = openJPGReader("Imgs/11841.jpg", &wj, &hj);
+    reg = readMaskRegion(jr, wj, hj, &sm3, NULL);
+    closeJPGReader(jr);
+    memset(pseg->inside, 0XAA, 2 * MSKH * pseg->words * sizeof(long));
+    k = 0;
+    if (reg != NULL) {
+        k = segmentRegion(reg, &sm3, &sp, NULL, pseg, &res);
+        freePlanarImage(reg);
+    }
+    if ((k == 1) && sameSegImage(conv, pseg) &&
+        (res.ccindex == ref.ccindex))
+        success++;
+    else
+        fprintf(stderr, "readMaskRegion test failed\n");
+    /*
+     * the same images with pooled buffers, reused by the second one
+     */
+    pool = newBufPool(2);
+    wrong = 0;
+    for (k = 0; k < 2; k++) {
+        jr = openJPGReader("Imgs/11841.jpg", &wj, &hj);
+        reg = readMaskRegion(jr, wj, hj, &sm3, pool);
+        closeJPGReader(jr);
+        poolseg = newPooledSegImage(pool, MSKW, MSKH);
+        if ((reg != NULL) && (poolseg != NULL)) {
+            segmentRegion(reg, &sm3, &sp, NULL, poolseg, &res);
+            wrong += !sameSegImage(conv, poolseg) ||
+                (res.ccindex != ref.ccindex);
+        }
+        else
+            wrong++;
+        freePlanarImage(reg);
+        freeSegImage(poolseg);
+    }
+    if ((wrong == 0) && (poolAllocations(pool) == 2))
+        success++;
+    else
+        fprintf(stderr, "readMaskRegion test failed, pooled buffers\n");
+    freeBufPool(pool);
+    /*
+     * threshold sweep: without flips, the same result of segmentRegion
+     * for the tresholds of the histogram grid
+     */
+    jr = openJPGReader("Imgs/11841.jpg", &wj, &hj);
+    reg = readMaskRegion(jr, wj, hj, &sm3, NULL);
+    closeJPGReader(jr);
+    rh = (reg != NULL) ? ratioHistogram(reg, &sm3, sp.neighbsize) : NULL;
+    novote = sp;
+    novote.votes2flip = sp.neighbsize * sp.neighbsize;
+    wrong = (rh == NULL) || !votesFlip(&sp) || votesFlip(&novote);
+    for (k = 0; (rh != NULL) && (k < 5); k++) {
+        novote.rbtreshold = thr = sweep[k];
+        compileClassifier(&novote);
+        segmentRegion(reg, &sm3, &novote, NULL, NULL, &res);
+        sweepIndex(rh, &thr, &res3);
+        wrong += (thr != sweep[k]) || (res3.ccindex != res.ccindex) ||
+            (res3.totalarea != res.totalarea) ||
+            (res3.totalpels != res.totalpels);
+    }
+    thr = 0.12345;
+    if (rh != NULL)
+        sweepIndex(rh, &thr, &res3);
+    if ((wrong == 0) && (thr == 0.123))
+        success++;
+    else
+        fprintf(stderr, "sweepIndex test failed\n");
+    freeRBHistogram(rh);
+    freePlanarImage(reg);
+    if (writeSegImage(pseg, "test-seg.png") == 1) {
+        freeImage(mycut);
+        mycut = readPNGImage("test-seg.png", &i, &j);
+    }
+    if ((mycut != NULL) && (i == MSKW) && (j == MSKH) &&
+        sameImage(conv, mycut))
+        success++;
+    else
+        fprintf(stderr, "writeSegImage test failed\n");
+    writePNGImage(conv, "test-argb.png", MSKW, MSKH);
+    if (fileSize("test-seg.png") < fileSize("test-argb.png"))
+        success++;
+    else
+        fprintf(stderr, "writeSegImage test failed, %ld vs %ld bytes\n",
+                fileSize("test-seg.png"), fileSize("test-argb.png"));
+    freeImage(mycut);
+    mycut = NULL;
+    if (writeParallelSegImage(pseg, "test-seg.png", 4) == 1)
+        mycut = readPNGImage("test-seg.png", &i, &j);
+    if ((mycut != NULL) && (i == MSKW) && (j == MSKH) &&
+        sameImage(conv, mycut))
+        success++;
+    else
+        fprintf(stderr, "writeParallelSegImage test failed\n");
+    jr = openJPGReader("Imgs/11841.jpg", &wj, &hj);
+    if (segmentStream(jr, MSKW - 1, hj, &sm, &sp, NULL, NULL, &res) == 0)
+        success++;
+    else
+        fprintf(stderr, "segmentStream test failed, small image accepted\n");
+    closeJPGReader(jr);
+    freeImage(jpg);
+
+    /*
+     * weight categories
+     */
+    if ((catsearch(0, categories, 0, NUMCAT - 1) == 0) &&
+        (catsearch(4225, categories, 0, NUMCAT - 1) == 0) &&
+        (catsearch(4226, categories, 0, NUMCAT - 1) == 1))
+        success++;
+    else
+        fprintf(stderr, "catsearch test failed\n");
+    if ((catsearch(1750330, categories, 0, NUMCAT - 1) == -1) &&
+        (catsearch(5.0e9, categories, 0, NUMCAT - 1) == -1))
+        success++;
+    else
+        fprintf(stderr, "catsearch test failed, out of range\n");
+    /*
+     * spans of the mask: the maximal runs of opaque pixels of each row
+     */
+    wrong = spans = 0;
+    for (i = sm.top; i < sm.bottom; i++) {
+        k = sm.rowspans[i - sm.top];
+        for (j = 0, in = 0; j < MSKW; j++) {
+            if ((sm.pix[i][j] != 0) && !in)
+                wrong += (k == sm.rowspans[i - sm.top + 1]) ||
+                    (sm.spanfrom[k] != j);
+            if ((sm.pix[i][j] == 0) && in)
+                wrong += (sm.spanto[k++] != j);
+            in = (sm.pix[i][j] != 0);
+        }
+        wrong += (k != sm.rowspans[i - sm.top + 1] - in);
+        spans += sm.rowspans[i - sm.top + 1] - sm.rowspans[i - sm.top];
+    }
+    if ((wrong == 0) && (spans > sm.bottom - sm.top) &&
+        (sm.pix[sm.top - 1][MSKW / 2] == 0) && (sm.pix[sm.top][MSKW / 2]))
+        success++;
+    else
+        fprintf(stderr, "buildMaskSpans test failed, %d errors\n", wrong);
+
+    /*
+     * radial map of the mask as if it were reduced 40 times, so it has
+     * many categories and pixels beyond the last one
+     */
+    wrong = spans = 0;
+    half = sm;
+    half.scale = 40;
+    buildRadialMap(&half);
+    for (i = half.top; i < half.bottom; i++)
+        for (k = half.rowruns[i - half.top];
+             k < half.rowruns[i - half.top + 1]; k++)
+            for (j = half.runfrom[k]; j < half.runto[k]; j++) {
+                mv = catsearch(((i - MSKH / 2) * (i - MSKH / 2) +
+                                (j - MSKW / 2) * (j - MSKW / 2)) * 1600.0,
+                               categories, 0, NUMCAT - 1);
+                wrong += (half.runcat[k] != ((mv < 0) ? NUMCAT : mv));
+                wrong += (half.pix[i][j] == 0);
+                spans++;
+            }
+    /*
+     * the runs cover every opaque pixel
+     */
+    for (i = 0; i < MSKH; i++)
+        for (j = 0; j < MSKW; j++)
+            spans -= (half.pix[i][j] != 0);
+    if ((wrong == 0) && (spans == 0) &&
+        (half.runcat[half.rowruns[0]] == NUMCAT) &&
+        (half.rowruns[half.bottom - half.top] > half.bottom - half.top))
+        success++;
+    else
+        fprintf(stderr, "buildRadialMap test failed, %d errors\n", wrong);
+    free(half.rowruns);
+    free(half.runfrom);
+    free(half.runto);
+    free(half.runcat);
+
+    /*
+     * sliding window vote, odd and even sides, against direct counting
+     */
+    wrong = 0;
+    for (k = 0; k < 3; k++) {
+        sp.neighbsize = side[k];
+        sp.votes2flip = side[k] * side[k] / 2;
+        freeImage(conv);
+        conv = convolution(sp.neighbsize, sp.votes2flip, seg, &sm3);
+        directVote(seg, sp.neighbsize, sp.votes2flip, myseg);
+        wrong += !sameImage(conv, myseg);
+        segmentImage(img, IMGW, IMGH, &sm3, &sp, NULL, pseg, &res);
+        wrong += !sameSegImage(myseg, pseg);
+    }
+    if (wrong == 0)
+        success++;
+    else
+        fprintf(stderr, "convolution test failed, %d errors\n", wrong);
+
+    /*
+     * quick-look: reduced mask and reduced decoding
+     */
+    if (scaleSkyMask(&sm3, 2, &half) && (half.width == MSKW / 2) &&
+        (half.height == MSKH / 2) && (half.scale == 2) &&
+        (half.nbands == 3) && (half.bounds[3] == half.height) &&
+        (half.pix[10][20] == sm3.pix[21][41]))
+        success++;
+    else
+        fprintf(stderr, "scaleSkyMask test failed\n");
+    freeSkyMask(&half);
+    jr = openScaledJPGReader("Imgs/11841.jpg", 8, &i, &j);
+    if ((jr != NULL) && (i == (wj + 7) / 8) && (j == (hj + 7) / 8))
+        success++;
+    else
+        fprintf(stderr, "openScaledJPGReader test failed\n");
+    closeJPGReader(jr);
+
+    freeSkyMask(&sm);
+    if (loadSkyMask("Imgs/red-transp.png", 4, &sm) && (sm.bounds[0] == 0)
+        && (sm.bounds[4] == sm.height))
+        success++;
+    else
+        fprintf(stderr, "loadSkyMask test failed\n");
+
+    freeSkyMask(&sm);
+    freeSkyMask(&sm3);
+    freeImage(img);
+    freeImage(cut);
+    freeImage(seg);
+    freeImage(conv);
+    freeImage(mycut);
+    freeImage(myseg);
+    freeSegImage(pseg);
+    freeSegImage(refseg);
+    fprintf(stderr, " %d successful of %d tests \n", success, total);
+    if (success == total)
+        return 1;
+    else
+        return 0;
+}
+
+/*
+ * test-segment.c ends here
+ */